@@ -2,8 +2,12 @@
 #include <arrayobject.h>
 
 #include "error.h"
+#include "threads.h"
 #include "dynamic_string.h"
+#include "io.h"
 #include "fields.h"
+#include "field_loading.h"
+#include "time_series.h"
 #include "transformation.h"
 #include "bricks.h"
 #include "view_aligned_planes.h"
@@ -20,8 +24,31 @@ static PyObject* vt_initialize(PyObject* self, PyObject* args);
 
 static PyObject* vt_set_brick_size_power_of_two(PyObject* self, PyObject* args);
 static PyObject* vt_set_minimum_sub_brick_size(PyObject* self, PyObject* args);
+static PyObject* vt_set_brick_caching(PyObject* self, PyObject* args);
+static PyObject* vt_set_brick_data_type(PyObject* self, PyObject* args);
+static PyObject* vt_set_constant_brick_tolerance(PyObject* self, PyObject* args);
+static PyObject* vt_set_lod_brick_creation(PyObject* self, PyObject* args);
+static PyObject* vt_set_adaptive_sub_brick_splitting(PyObject* self, PyObject* args);
+static PyObject* vt_set_field_data_release(PyObject* self, PyObject* args);
+
+static PyObject* vt_set_worker_thread_count(PyObject* self, PyObject* args);
+static PyObject* vt_set_file_reading_thread_count(PyObject* self, PyObject* args);
+static PyObject* vt_set_file_reading_chunk_size(PyObject* self, PyObject* args);
+static PyObject* vt_set_memory_mapped_field_loading(PyObject* self, PyObject* args);
+static PyObject* vt_set_streamed_field_loading(PyObject* self, PyObject* args);
 
 static PyObject* vt_set_field_from_bifrost_file(PyObject* self, PyObject* args);
+static PyObject* vt_set_field_region_from_bifrost_file(PyObject* self, PyObject* args);
+static PyObject* vt_set_field_preview_from_bifrost_file(PyObject* self, PyObject* args);
+static PyObject* vt_load_field_from_bifrost_file(PyObject* self, PyObject* args);
+static PyObject* vt_get_field_loading_state(PyObject* self, PyObject* args);
+static PyObject* vt_compress_bifrost_file(PyObject* self, PyObject* args);
+
+static PyObject* vt_set_time_series_prefetch_count(PyObject* self, PyObject* args);
+static PyObject* vt_start_time_series(PyObject* self, PyObject* args);
+static PyObject* vt_step_time_series(PyObject* self, PyObject* args);
+static PyObject* vt_get_time_series_status(PyObject* self, PyObject* args);
+static PyObject* vt_stop_time_series(PyObject* self, PyObject* args);
 
 static PyObject* vt_step(PyObject* self, PyObject* args);
 
@@ -54,6 +81,7 @@ static PyObject* vt_use_orthographic_camera_projection(PyObject* self, PyObject*
 
 static PyObject* vt_set_lower_visibility_threshold(PyObject* self, PyObject* args);
 static PyObject* vt_set_upper_visibility_threshold(PyObject* self, PyObject* args);
+static PyObject* vt_set_lod_pixel_threshold(PyObject* self, PyObject* args);
 
 static PyObject* vt_set_field_boundary_indicator_creation(PyObject* self, PyObject* args);
 static PyObject* vt_set_brick_boundary_indicator_creation(PyObject* self, PyObject* args);
@@ -65,11 +93,21 @@ static PyObject* vt_cleanup(PyObject* self, PyObject* args);
 
 
 static void maybe_refresh(int include_visibility);
+static void finish_pending_field_loading(void);
+static void discard_pending_field_loading(void);
+static void replace_single_field_rendering_bricked_field(BrickedField* bricked_field);
 
 
 static int is_initialized = 0;
 static int autorefresh = 1;
 
+// ID of the field being loaded in the background to replace the current field, or 0 if there is none
+static size_t pending_field_loading_id = 0;
+
+// IDs of the most recently started and finished background field loadings, or 0 if there are none
+static size_t last_started_field_loading_id = 0;
+static size_t last_finished_field_loading_id = 0;
+
 
 /*
 Method definition objects for the extension. The entries are:
@@ -86,7 +124,28 @@ static PyMethodDef vortek_method_definitions[] =
     {"initialize",                                        vt_initialize,                                   METH_VARARGS, NULL},
     {"set_brick_size_power_of_two",                       vt_set_brick_size_power_of_two,                  METH_VARARGS, NULL},
     {"set_minimum_sub_brick_size",                        vt_set_minimum_sub_brick_size,                   METH_VARARGS, NULL},
+    {"set_brick_caching",                                 vt_set_brick_caching,                            METH_VARARGS, NULL},
+    {"set_brick_data_type",                               vt_set_brick_data_type,                          METH_VARARGS, NULL},
+    {"set_constant_brick_tolerance",                      vt_set_constant_brick_tolerance,                 METH_VARARGS, NULL},
+    {"set_lod_brick_creation",                            vt_set_lod_brick_creation,                       METH_VARARGS, NULL},
+    {"set_adaptive_sub_brick_splitting",                  vt_set_adaptive_sub_brick_splitting,             METH_VARARGS, NULL},
+    {"set_field_data_release",                            vt_set_field_data_release,                       METH_VARARGS, NULL},
+    {"set_worker_thread_count",                           vt_set_worker_thread_count,                      METH_VARARGS, NULL},
+    {"set_file_reading_thread_count",                     vt_set_file_reading_thread_count,                METH_VARARGS, NULL},
+    {"set_file_reading_chunk_size",                       vt_set_file_reading_chunk_size,                  METH_VARARGS, NULL},
+    {"set_memory_mapped_field_loading",                   vt_set_memory_mapped_field_loading,              METH_VARARGS, NULL},
+    {"set_streamed_field_loading",                        vt_set_streamed_field_loading,                   METH_VARARGS, NULL},
     {"set_field_from_bifrost_file",                       vt_set_field_from_bifrost_file,                  METH_VARARGS, NULL},
+    {"set_field_region_from_bifrost_file",                vt_set_field_region_from_bifrost_file,           METH_VARARGS, NULL},
+    {"set_field_preview_from_bifrost_file",               vt_set_field_preview_from_bifrost_file,          METH_VARARGS, NULL},
+    {"load_field_from_bifrost_file",                      vt_load_field_from_bifrost_file,                 METH_VARARGS, NULL},
+    {"get_field_loading_state",                           vt_get_field_loading_state,                      METH_VARARGS, NULL},
+    {"compress_bifrost_file",                             vt_compress_bifrost_file,                        METH_VARARGS, NULL},
+    {"set_time_series_prefetch_count",                    vt_set_time_series_prefetch_count,               METH_VARARGS, NULL},
+    {"start_time_series",                                 vt_start_time_series,                            METH_VARARGS, NULL},
+    {"step_time_series",                                  vt_step_time_series,                             METH_VARARGS, NULL},
+    {"get_time_series_status",                            vt_get_time_series_status,                       METH_VARARGS, NULL},
+    {"stop_time_series",                                  vt_stop_time_series,                             METH_VARARGS, NULL},
     {"step",                                              vt_step,                                         METH_VARARGS, NULL},
     {"refresh_visibility",                                vt_refresh_visibility,                           METH_VARARGS, NULL},
     {"refresh_frame",                                     vt_refresh_frame,                                METH_VARARGS, NULL},
@@ -107,6 +166,7 @@ static PyMethodDef vortek_method_definitions[] =
     {"use_orthographic_camera_projection",                vt_use_orthographic_camera_projection,           METH_VARARGS, NULL},
     {"set_lower_visibility_threshold",                    vt_set_lower_visibility_threshold,               METH_VARARGS, NULL},
     {"set_upper_visibility_threshold",                    vt_set_upper_visibility_threshold,               METH_VARARGS, NULL},
+    {"set_lod_pixel_threshold",                           vt_set_lod_pixel_threshold,                      METH_VARARGS, NULL},
     {"set_field_boundary_indicator_creation",             vt_set_field_boundary_indicator_creation,        METH_VARARGS, NULL},
     {"set_brick_boundary_indicator_creation",             vt_set_brick_boundary_indicator_creation,        METH_VARARGS, NULL},
     {"set_sub_brick_boundary_indicator_creation",         vt_set_sub_brick_boundary_indicator_creation,    METH_VARARGS, NULL},
@@ -198,6 +258,197 @@ static PyObject* vt_set_minimum_sub_brick_size(PyObject* self, PyObject* args)
     Py_RETURN_NONE;
 }
 
+static PyObject* vt_set_brick_caching(PyObject* self, PyObject* args)
+{
+    // void vt_set_brick_caching(int state);
+
+    int state;
+
+    if (!PyArg_ParseTuple(args, "i", &state))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_brick_caching");
+
+    if (state != 0 && state != 1)
+        print_severe_message("Argument to function \"%s\" must be either 0 or 1.", "set_brick_caching");
+
+    // Field data is then only loaded if the bricks for the field cannot be loaded from the cache
+    set_bricked_field_caching(state);
+    set_deferred_field_loading(state);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_brick_data_type(PyObject* self, PyObject* args)
+{
+    // void vt_set_brick_data_type(int data_type);
+
+    int data_type;
+
+    if (!PyArg_ParseTuple(args, "i", &data_type))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_brick_data_type");
+
+    // 0: 32-bit float, 1: 16-bit unsigned integer, 2: 8-bit unsigned integer, 3: 16-bit float
+    if (data_type < 0 || data_type > 3)
+        print_severe_message("Brick data type specifier must be an integer in the range [0, 3].");
+
+    set_brick_data_type((enum brick_data_type)data_type);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_constant_brick_tolerance(PyObject* self, PyObject* args)
+{
+    // void vt_set_constant_brick_tolerance(float tolerance);
+
+    float tolerance;
+
+    if (!PyArg_ParseTuple(args, "f", &tolerance))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_constant_brick_tolerance");
+
+    // The tolerance applies to field values normalized to the range [0, 1]
+    if (tolerance < 0)
+        print_severe_message("Constant brick tolerance must be non-negative.");
+
+    set_constant_brick_tolerance(tolerance);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_lod_brick_creation(PyObject* self, PyObject* args)
+{
+    // void vt_set_lod_brick_creation(int state);
+
+    int state;
+
+    if (!PyArg_ParseTuple(args, "i", &state))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_lod_brick_creation");
+
+    if (state != 0 && state != 1)
+        print_severe_message("Argument to function \"%s\" must be either 0 or 1.", "set_lod_brick_creation");
+
+    set_lod_brick_creation(state);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_adaptive_sub_brick_splitting(PyObject* self, PyObject* args)
+{
+    // void vt_set_adaptive_sub_brick_splitting(int state);
+
+    int state;
+
+    if (!PyArg_ParseTuple(args, "i", &state))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_adaptive_sub_brick_splitting");
+
+    if (state != 0 && state != 1)
+        print_severe_message("Argument to function \"%s\" must be either 0 or 1.", "set_adaptive_sub_brick_splitting");
+
+    set_adaptive_sub_brick_splitting(state);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_field_data_release(PyObject* self, PyObject* args)
+{
+    // void vt_set_field_data_release(int state);
+
+    int state;
+
+    if (!PyArg_ParseTuple(args, "i", &state))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_field_data_release");
+
+    if (state != 0 && state != 1)
+        print_severe_message("Argument to function \"%s\" must be either 0 or 1.", "set_field_data_release");
+
+    set_field_data_release(state);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_worker_thread_count(PyObject* self, PyObject* args)
+{
+    // void vt_set_worker_thread_count(int n_threads);
+
+    int n_threads;
+
+    if (!PyArg_ParseTuple(args, "i", &n_threads))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_worker_thread_count");
+
+    if (n_threads < 1)
+        print_severe_message("Number of worker threads must be positive.");
+
+    set_worker_thread_count((unsigned int)n_threads);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_file_reading_thread_count(PyObject* self, PyObject* args)
+{
+    // void vt_set_file_reading_thread_count(int n_threads);
+
+    int n_threads;
+
+    if (!PyArg_ParseTuple(args, "i", &n_threads))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_file_reading_thread_count");
+
+    if (n_threads < 1)
+        print_severe_message("Number of file reading threads must be positive.");
+
+    set_binary_file_reading_thread_count((unsigned int)n_threads);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_file_reading_chunk_size(PyObject* self, PyObject* args)
+{
+    // void vt_set_file_reading_chunk_size(int chunk_size_in_bytes);
+
+    long chunk_size;
+
+    if (!PyArg_ParseTuple(args, "l", &chunk_size))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_file_reading_chunk_size");
+
+    if (chunk_size < 1)
+        print_severe_message("File reading chunk size must be positive.");
+
+    set_binary_file_reading_chunk_size((size_t)chunk_size);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_memory_mapped_field_loading(PyObject* self, PyObject* args)
+{
+    // void vt_set_memory_mapped_field_loading(int state);
+
+    int state;
+
+    if (!PyArg_ParseTuple(args, "i", &state))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_memory_mapped_field_loading");
+
+    if (state != 0 && state != 1)
+        print_severe_message("Argument to function \"%s\" must be either 0 or 1.", "set_memory_mapped_field_loading");
+
+    set_memory_mapped_field_loading(state);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_streamed_field_loading(PyObject* self, PyObject* args)
+{
+    // void vt_set_streamed_field_loading(int state);
+
+    int state;
+
+    if (!PyArg_ParseTuple(args, "i", &state))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_streamed_field_loading");
+
+    if (state != 0 && state != 1)
+        print_severe_message("Argument to function \"%s\" must be either 0 or 1.", "set_streamed_field_loading");
+
+    set_streamed_field_loading(state);
+
+    Py_RETURN_NONE;
+}
+
 static PyObject* vt_set_field_from_bifrost_file(PyObject* self, PyObject* args)
 {
     // void vt_set_field_from_bifrost_file(char* field_name, char* file_base_name);
@@ -211,6 +462,9 @@ static PyObject* vt_set_field_from_bifrost_file(PyObject* self, PyObject* args)
     DynamicString data_path = create_string("%s.raw", file_base_name);
     DynamicString header_path = create_string("%s.dat", file_base_name);
 
+    discard_pending_field_loading();
+    stop_time_series();
+
     Field* const existing_field = get_field_texture_field(get_single_field_rendering_texture_name());
     if (existing_field)
         destroy_field(existing_field->name.chars);
@@ -227,10 +481,270 @@ static PyObject* vt_set_field_from_bifrost_file(PyObject* self, PyObject* args)
     Py_RETURN_NONE;
 }
 
+static PyObject* vt_set_field_region_from_bifrost_file(PyObject* self, PyObject* args)
+{
+    // void vt_set_field_region_from_bifrost_file(char* field_name, char* file_base_name,
+    //                                            long start_x, long end_x,
+    //                                            long start_y, long end_y,
+    //                                            long start_z, long end_z);
+
+    char* field_name;
+    char* file_base_name;
+    long start_x, end_x, start_y, end_y, start_z, end_z;
+
+    if (!PyArg_ParseTuple(args, "ssllllll", &field_name, &file_base_name,
+                          &start_x, &end_x, &start_y, &end_y, &start_z, &end_z))
+        print_severe_message("Could not parse arguments to function \"%s\".", "set_field_region_from_bifrost_file");
+
+    if (start_x < 0 || end_x < 0 || start_y < 0 || end_y < 0 || start_z < 0 || end_z < 0)
+        print_severe_message("Region bounds passed to function \"%s\" cannot be negative.", "set_field_region_from_bifrost_file");
+
+    DynamicString data_path = create_string("%s.raw", file_base_name);
+    DynamicString header_path = create_string("%s.dat", file_base_name);
+
+    discard_pending_field_loading();
+    stop_time_series();
+
+    Field* const existing_field = get_field_texture_field(get_single_field_rendering_texture_name());
+    if (existing_field)
+        destroy_field(existing_field->name.chars);
+
+    set_single_field_rendering_field(create_field_region_from_bifrost_file(field_name, data_path.chars, header_path.chars,
+                                                                           (size_t)start_x, (size_t)end_x,
+                                                                           (size_t)start_y, (size_t)end_y,
+                                                                           (size_t)start_z, (size_t)end_z));
+
+    clear_string(&data_path);
+    clear_string(&header_path);
+
+    update_visibility_ratios(get_single_field_rendering_TF_name(),
+                             get_field_texture_bricked_field(get_single_field_rendering_texture_name()));
+    require_rendering();
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_set_field_preview_from_bifrost_file(PyObject* self, PyObject* args)
+{
+    // int vt_set_field_preview_from_bifrost_file(char* field_name, char* file_base_name, int stride);
+
+    char* field_name;
+    char* file_base_name;
+    int stride;
+
+    if (!PyArg_ParseTuple(args, "ssi", &field_name, &file_base_name, &stride))
+        print_severe_message("Could not parse arguments to function \"%s\".", "set_field_preview_from_bifrost_file");
+
+    if (stride < 1)
+        print_severe_message("Stride passed to function \"%s\" must be positive.", "set_field_preview_from_bifrost_file");
+
+    DynamicString data_path = create_string("%s.raw", file_base_name);
+    DynamicString header_path = create_string("%s.dat", file_base_name);
+
+    discard_pending_field_loading();
+    stop_time_series();
+
+    Field* const existing_field = get_field_texture_field(get_single_field_rendering_texture_name());
+    if (existing_field)
+        destroy_field(existing_field->name.chars);
+
+    set_single_field_rendering_field(create_decimated_field_from_bifrost_file(field_name, data_path.chars, header_path.chars,
+                                                                              (unsigned int)stride));
+
+    // The full resolution field replaces the preview in vt_step once it has been loaded
+    pending_field_loading_id = start_loading_bricked_field_from_bifrost_file(field_name, data_path.chars, header_path.chars);
+    last_started_field_loading_id = pending_field_loading_id;
+
+    clear_string(&data_path);
+    clear_string(&header_path);
+
+    update_visibility_ratios(get_single_field_rendering_TF_name(),
+                             get_field_texture_bricked_field(get_single_field_rendering_texture_name()));
+    require_rendering();
+
+    return Py_BuildValue("n", (Py_ssize_t)pending_field_loading_id);
+}
+
+static PyObject* vt_load_field_from_bifrost_file(PyObject* self, PyObject* args)
+{
+    // int vt_load_field_from_bifrost_file(char* field_name, char* file_base_name);
+
+    char* field_name;
+    char* file_base_name;
+
+    if (!PyArg_ParseTuple(args, "ss", &field_name, &file_base_name))
+        print_severe_message("Could not parse arguments to function \"%s\".", "load_field_from_bifrost_file");
+
+    DynamicString data_path = create_string("%s.raw", file_base_name);
+    DynamicString header_path = create_string("%s.dat", file_base_name);
+
+    discard_pending_field_loading();
+    stop_time_series();
+
+    // The current field keeps being rendered until the new one replaces it in vt_step
+    pending_field_loading_id = start_loading_bricked_field_from_bifrost_file(field_name, data_path.chars, header_path.chars);
+    last_started_field_loading_id = pending_field_loading_id;
+
+    clear_string(&data_path);
+    clear_string(&header_path);
+
+    return Py_BuildValue("n", (Py_ssize_t)pending_field_loading_id);
+}
+
+static PyObject* vt_get_field_loading_state(PyObject* self, PyObject* args)
+{
+    // int vt_get_field_loading_state(int loading_id);
+
+    /*
+    Returns 0 while the given loading is pending, 1 once its field has replaced
+    the current one and 2 if it was discarded before finishing. A loading
+    whose field has since been replaced by that of a later loading also counts
+    as discarded.
+    */
+
+    Py_ssize_t loading_id;
+
+    if (!PyArg_ParseTuple(args, "n", &loading_id))
+        print_severe_message("Could not parse argument to function \"%s\".", "get_field_loading_state");
+
+    if (loading_id < 1 || (size_t)loading_id > last_started_field_loading_id)
+        print_severe_message("Argument to function \"%s\" is not the ID of a started field loading.", "get_field_loading_state");
+
+    if ((size_t)loading_id == pending_field_loading_id)
+        return Py_BuildValue("i", 0);
+    else if ((size_t)loading_id == last_finished_field_loading_id)
+        return Py_BuildValue("i", 1);
+    else
+        return Py_BuildValue("i", 2);
+}
+
+static PyObject* vt_compress_bifrost_file(PyObject* self, PyObject* args)
+{
+    // bool vt_compress_bifrost_file(char* file_base_name, char* output_file_base_name);
+
+    char* file_base_name;
+    char* output_file_base_name;
+
+    if (!PyArg_ParseTuple(args, "ss", &file_base_name, &output_file_base_name))
+        print_severe_message("Could not parse arguments to function \"%s\".", "compress_bifrost_file");
+
+    DynamicString data_path = create_string("%s.raw", file_base_name);
+    DynamicString header_path = create_string("%s.dat", file_base_name);
+    DynamicString output_data_path = create_string("%s.raw", output_file_base_name);
+    DynamicString output_header_path = create_string("%s.dat", output_file_base_name);
+
+    int succeeded = compress_bifrost_file(data_path.chars, header_path.chars, output_data_path.chars);
+
+    // The compressed data is described by the same header as the original data
+    if (succeeded)
+    {
+        char* const header = read_text_file(header_path.chars);
+        succeeded = header && write_binary_file(output_header_path.chars, NULL, 0, header, strlen(header));
+        free(header);
+    }
+
+    clear_string(&data_path);
+    clear_string(&header_path);
+    clear_string(&output_data_path);
+    clear_string(&output_header_path);
+
+    if (succeeded)
+        Py_RETURN_TRUE;
+    else
+        Py_RETURN_FALSE;
+}
+
+static PyObject* vt_set_time_series_prefetch_count(PyObject* self, PyObject* args)
+{
+    // void vt_set_time_series_prefetch_count(int prefetch_count);
+
+    int prefetch_count;
+
+    if (!PyArg_ParseTuple(args, "i", &prefetch_count))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_time_series_prefetch_count");
+
+    if (prefetch_count < 1)
+        print_severe_message("Time series prefetch count must be positive.");
+
+    set_time_series_prefetch_count((unsigned int)prefetch_count);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_start_time_series(PyObject* self, PyObject* args)
+{
+    // void vt_start_time_series(char* field_name, char* file_base_name_pattern, int start_frame, int end_frame);
+
+    char* field_name;
+    char* file_base_name_pattern;
+    int start_frame;
+    int end_frame;
+
+    if (!PyArg_ParseTuple(args, "ssii", &field_name, &file_base_name_pattern, &start_frame, &end_frame))
+        print_severe_message("Could not parse arguments to function \"%s\".", "start_time_series");
+
+    if (start_frame < 0 || end_frame < 0)
+        print_severe_message("Time series frame numbers must be non-negative.");
+
+    discard_pending_field_loading();
+
+    // The first frame is shown by the first call to vt_step_time_series
+    start_time_series(field_name, file_base_name_pattern, (unsigned int)start_frame, (unsigned int)end_frame);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject* vt_step_time_series(PyObject* self, PyObject* args)
+{
+    // bool vt_step_time_series(int wait);
+
+    int wait;
+
+    if (!PyArg_ParseTuple(args, "i", &wait))
+        print_severe_message("Could not parse argument to function \"%s\".", "step_time_series");
+
+    BrickedField bricked_field;
+
+    if (!advance_time_series(&bricked_field, wait))
+        Py_RETURN_FALSE;
+
+    replace_single_field_rendering_bricked_field(&bricked_field);
+
+    Py_RETURN_TRUE;
+}
+
+static PyObject* vt_get_time_series_status(PyObject* self, PyObject* args)
+{
+    // (int, int, int, int, float) vt_get_time_series_status(void);
+
+    unsigned int n_ready_frames;
+    unsigned int n_loading_frames;
+    size_t n_stalled_steps;
+    double total_stall_time;
+
+    get_time_series_prefetch_status(&n_ready_frames, &n_loading_frames, &n_stalled_steps, &total_stall_time);
+
+    return Py_BuildValue("IIInd",
+                         get_current_time_series_frame(), n_ready_frames, n_loading_frames,
+                         (Py_ssize_t)n_stalled_steps, total_stall_time);
+}
+
+static PyObject* vt_stop_time_series(PyObject* self, PyObject* args)
+{
+    // void vt_stop_time_series(void);
+
+    stop_time_series();
+
+    Py_RETURN_NONE;
+}
+
 static PyObject* vt_step(PyObject* self, PyObject* args)
 {
     // void vt_step(void);
 
+    if (pending_field_loading_id > 0 && bricked_field_loading_has_finished(pending_field_loading_id))
+        finish_pending_field_loading();
+
     if (step_mainloop())
         Py_RETURN_TRUE;
     else
@@ -548,6 +1062,26 @@ static PyObject* vt_set_upper_visibility_threshold(PyObject* self, PyObject* arg
     Py_RETURN_NONE;
 }
 
+static PyObject* vt_set_lod_pixel_threshold(PyObject* self, PyObject* args)
+{
+    // void vt_set_lod_pixel_threshold(float threshold);
+
+    float threshold;
+
+    if (!PyArg_ParseTuple(args, "f", &threshold))
+        print_severe_message("Could not parse argument to function \"%s\".", "set_lod_pixel_threshold");
+
+    // Projected voxel sizes are in pixels, and a threshold of zero disables the LOD bricks when drawing
+    if (threshold < 0)
+        print_severe_message("LOD pixel threshold must be non-negative.");
+
+    set_lod_pixel_threshold(threshold);
+
+    maybe_refresh(0);
+
+    Py_RETURN_NONE;
+}
+
 static PyObject* vt_set_field_boundary_indicator_creation(PyObject* self, PyObject* args)
 {
     // void vt_set_field_boundary_indicator_creation(int state);
@@ -611,6 +1145,7 @@ static PyObject* vt_cleanup(PyObject* self, PyObject* args)
 {
     // void vt_cleanup(void);
 
+    discard_pending_field_loading();
     cleanup_renderer();
     cleanup_window();
     is_initialized = 0;
@@ -628,3 +1163,54 @@ static void maybe_refresh(int include_visibility)
         require_rendering();
     }
 }
+
+static void finish_pending_field_loading(void)
+{
+    assert(pending_field_loading_id > 0);
+
+    // The current field must be removed first, since the loaded field may have the same name
+    Field* const existing_field = get_field_texture_field(get_single_field_rendering_texture_name());
+    if (existing_field)
+        destroy_field(existing_field->name.chars);
+
+    BrickedField bricked_field;
+    finish_loading_bricked_field(pending_field_loading_id, &bricked_field);
+    last_finished_field_loading_id = pending_field_loading_id;
+    pending_field_loading_id = 0;
+
+    set_single_field_rendering_bricked_field(&bricked_field);
+
+    update_visibility_ratios(get_single_field_rendering_TF_name(),
+                             get_field_texture_bricked_field(get_single_field_rendering_texture_name()));
+    require_rendering();
+}
+
+static void discard_pending_field_loading(void)
+{
+    if (pending_field_loading_id == 0)
+        return;
+
+    discard_bricked_field_loading(pending_field_loading_id);
+    pending_field_loading_id = 0;
+}
+
+static void replace_single_field_rendering_bricked_field(BrickedField* bricked_field)
+{
+    assert(bricked_field);
+
+    // The current field is only destroyed after the new one has been transferred,
+    // so this requires the new field to have a different name
+    Field* const existing_field = get_field_texture_field(get_single_field_rendering_texture_name());
+    DynamicString existing_field_name = existing_field ? create_duplicate_string(&existing_field->name) : create_empty_string();
+
+    set_single_field_rendering_bricked_field(bricked_field);
+
+    if (existing_field_name.chars)
+        destroy_field(existing_field_name.chars);
+
+    clear_string(&existing_field_name);
+
+    update_visibility_ratios(get_single_field_rendering_TF_name(),
+                             get_field_texture_bricked_field(get_single_field_rendering_texture_name()));
+    require_rendering();
+}
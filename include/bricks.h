@@ -7,17 +7,63 @@
 #include "indicators.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 enum brick_orientation {ORIENTED_ZYX = 0, ORIENTED_XZY = 1, ORIENTED_YXZ = 2};
 enum region_visibility {REGION_VISIBLE, REGION_INVISIBLE, REGION_CLIPPED, UNDETERMINED_REGION_VISIBILITY};
 
+// Storage types for the normalized brick values. The integer types map [0, 1] onto their full range.
+enum brick_data_type {BRICK_DATA_FLOAT32 = 0, BRICK_DATA_UINT16 = 1, BRICK_DATA_UINT8 = 2, BRICK_DATA_FLOAT16 = 3};
+
+// LOD brick index of brick tree nodes that have no LOD brick
+#define NO_LOD_BRICK UINT32_MAX
+
+// Number of equally wide bins of the normalized value range [0, 1] in the value histograms of sub brick tree leaves
+#define VALUE_HISTOGRAM_BINS 256
+
 typedef struct BrickTreeNode BrickTreeNode;
 typedef struct SubBrickTreeNode SubBrickTreeNode;
 
+typedef struct BrickingConfiguration
+{
+    size_t requested_brick_size;
+    unsigned int kernel_size;
+    unsigned int sub_brick_size_limit;
+    int create_field_boundary_indicator;
+    int create_brick_boundary_indicator;
+    int create_sub_brick_boundary_indicator;
+    int use_brick_cache;
+    enum brick_data_type data_type;
+    float constant_brick_tolerance;
+    int create_lod_bricks;
+    int use_adaptive_sub_brick_splits;
+    int release_field_data;
+} BrickingConfiguration;
+
+/*
+The value histogram of a sub brick tree leaf only holds entries for its
+non-empty bins. A bin with more voxels than a single entry can count is
+covered by several entries. Most bins of a leaf hold few voxels, so an 8-bit
+count keeps entries at two bytes without padding, which is less than a voxel
+of most brick data types.
+*/
+typedef struct ValueHistogramEntry
+{
+    uint8_t count;
+    uint8_t bin;
+} ValueHistogramEntry;
+
 typedef struct Brick
 {
-    float* data;
+    void* data; // Element type given by the data type of the bricked field, or NULL if the brick is constant
+    int is_constant;
+    float constant_value; // Normalized value of all voxels in a constant brick
     SubBrickTreeNode* tree;
+    size_t n_tree_nodes;
+    float* visibility_ratios; // Visibility ratio of each sub brick tree node
+    uint32_t* histogram_starts; // Index of the first value histogram entry of each sub brick tree node
+    ValueHistogramEntry* histogram; // Value histogram entries of all the sub brick tree leaves, or NULL if the brick is constant
+    size_t n_histogram_entries;
     enum brick_orientation orientation;
     size_t offset_x;
     size_t offset_y;
@@ -32,48 +78,95 @@ typedef struct Brick
     GLuint texture_id;
 } Brick;
 
+/*
+An LOD (level of detail) brick holds a downsampled version of the region
+covered by a brick tree node, and can be drawn in place of all the bricks
+below the node. Each level halves the resolution along every axis. The data
+is laid out with x varying fastest, and includes enough surrounding voxels of
+the level to interpolate across the boundaries of the region.
+*/
+typedef struct LODBrick
+{
+    void* data; // Element type given by the data type of the bricked field
+    unsigned int level;
+    size_t offset[3]; // Offset of the data within the downsampled field of the level
+    size_t padded_size[3];
+    Vector3f texture_offset; // Texture coordinates of the lower corner of the region
+    Vector3f texture_extent; // Extent of the region in texture coordinates
+    GLuint texture_id;
+} LODBrick;
+
+/*
+The nodes of each tree are stored contiguously in depth-first order. The lower
+child of a node therefore directly follows it, and only the index of the upper
+child needs to be stored. An upper child index of zero marks a leaf node.
+
+The value limits of a node are the smallest and largest normalized values (as
+stored in the bricks) of the voxels in the region covered by the node.
+
+Data that is not needed to traverse the trees, like the visibility ratios,
+value histograms and LOD bricks of the nodes, is kept in separate arrays
+indexed like the nodes, so that the nodes stay small.
+*/
+
 typedef struct BrickTreeNode
 {
-    BrickTreeNode* lower_child;
-    BrickTreeNode* upper_child;
-    Brick* brick;
-    unsigned int split_axis;
-    size_t n_children;
     Vector3f spatial_offset;
     Vector3f spatial_extent;
-    float visibility_ratio;
-    enum region_visibility visibility;
+    uint32_t upper_child_idx;
+    uint32_t brick_idx;
+    float min_value;
+    float max_value;
+    uint8_t split_axis;
+    uint8_t visibility;
 } BrickTreeNode;
 
 typedef struct SubBrickTreeNode
 {
-    SubBrickTreeNode* lower_child;
-    SubBrickTreeNode* upper_child;
-    unsigned int split_axis;
-    size_t n_children;
-    size_t offset_x;
-    size_t offset_y;
-    size_t offset_z;
-    size_t size_x;
-    size_t size_y;
-    size_t size_z;
-    Vector3f spatial_offset;
-    Vector3f spatial_extent;
-    float visibility_ratio;
-    enum region_visibility visibility;
-    size_t indicator_idx;
+    uint16_t offset[3]; // Relative to the unpadded brick
+    uint16_t size[3];
+    uint32_t upper_child_idx;
+    uint32_t indicator_idx;
+    float min_value;
+    float max_value;
+    uint8_t split_axis;
+    uint8_t visibility;
 } SubBrickTreeNode;
 
 typedef struct BrickedField
 {
     Field* field;
     Brick* bricks;
+    size_t* brick_storage_order; // Brick indices in the order their data is stored, which is that of the brick tree leaves
     BrickTreeNode* tree;
+    size_t n_tree_nodes;
+    float* tree_visibility_ratios; // Visibility ratio of each brick tree node
+    uint32_t* tree_lod_brick_indices; // LOD brick index of each brick tree node, or NO_LOD_BRICK if the node has none
+    SubBrickTreeNode* sub_brick_tree_nodes;
+    size_t n_sub_brick_tree_nodes;
+    float* sub_brick_visibility_ratios; // Visibility ratio of each sub brick tree node
+    uint32_t* sub_brick_histogram_starts; // Index of the first value histogram entry of each sub brick tree node, followed by the total number of entries
+    ValueHistogramEntry* histogram_entries; // Value histogram entries of all the bricks, stored in brick storage order
+    size_t n_histogram_entries;
     size_t n_bricks;
     size_t n_bricks_x;
     size_t n_bricks_y;
     size_t n_bricks_z;
     size_t brick_size;
+    size_t pad_size;
+    enum brick_data_type data_type;
+    // Configuration the bricked field was built with, captured when the build starts
+    size_t sub_brick_size_limit;
+    float constant_brick_tolerance;
+    int uses_adaptive_sub_brick_splits;
+    int creates_lod_bricks;
+    void* data; // Data of all the non-constant bricks, stored contiguously
+    size_t data_length;
+    void* cache_mapping;
+    size_t cache_mapping_size;
+    LODBrick* lod_bricks;
+    size_t n_lod_bricks;
+    void* lod_data; // Data of all the LOD bricks, stored contiguously
     GLuint texture_unit;
     const char* field_boundary_indicator_name;
     const char* brick_boundary_indicator_name;
@@ -87,12 +180,33 @@ void reset_bricked_field(BrickedField* bricked_field);
 void set_brick_size_exponent(unsigned int brick_size_exponent);
 void set_bricked_field_kernel_size(unsigned int kernel_size);
 void set_min_sub_brick_size(unsigned int min_sub_brick_size);
+void set_bricked_field_caching(int state);
+void set_brick_data_type(enum brick_data_type data_type);
+void set_constant_brick_tolerance(float tolerance);
+void set_lod_brick_creation(int state);
+void set_adaptive_sub_brick_splitting(int state);
+void set_field_data_release(int state);
 
 void set_field_boundary_indicator_creation(int state);
 void set_brick_boundary_indicator_creation(int state);
 void set_sub_brick_boundary_indicator_creation(int state);
 
+BrickingConfiguration get_bricking_configuration(void);
+
 void create_bricked_field(BrickedField* bricked_field, Field* field);
+void build_bricked_field(BrickedField* bricked_field, Field* field, const BrickingConfiguration* bricking_configuration);
+void rebuild_bricked_field(BrickedField* bricked_field, const BrickedField* source_bricked_field);
+void create_bricked_field_indicators(BrickedField* bricked_field);
+
+size_t get_brick_data_type_size(enum brick_data_type data_type);
+void get_brick_data_strides(const Brick* brick, size_t strides[3]);
+float get_brick_data_value(const BrickedField* bricked_field, const Brick* brick, size_t idx);
+float* read_bricked_field_slab(const BrickedField* bricked_field, size_t start_z, size_t end_z);
+void get_sub_brick_tree_node_box(const BrickedField* bricked_field, const Brick* brick, const SubBrickTreeNode* node,
+                                 Vector3f* spatial_offset, Vector3f* spatial_extent);
+
+size_t find_bricks_in_value_range(const BrickedField* bricked_field, float lower_value, float upper_value, size_t* brick_indices);
+size_t find_sub_bricks_in_value_range(const Brick* brick, float lower_value, float upper_value, uint32_t* node_indices);
 
 void draw_field_boundary_indicator(const BrickedField* bricked_field, unsigned int reference_corner_idx, enum indicator_drawing_pass pass);
 void draw_brick_boundary_indicator(const BrickedField* bricked_field);
@@ -2,6 +2,7 @@
 #define EXTRA_MATH_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 extern const double PI;
 
@@ -21,6 +22,9 @@ int signum(float x);
 
 float clamp(float x, float lower, float upper);
 
+float half_to_float(uint16_t half);
+uint16_t float_to_half(float value);
+
 size_t pow2_size_t(unsigned int exponent);
 unsigned int floored_log2_size_t(size_t number);
 size_t closest_ge_pow2_size_t(size_t number);
@@ -0,0 +1,17 @@
+#ifndef FIELD_LOADING_H
+#define FIELD_LOADING_H
+
+#include "bricks.h"
+
+#include <stddef.h>
+
+void initialize_field_loading(void);
+
+size_t start_loading_bricked_field_from_bifrost_file(const char* field_name, const char* data_filename, const char* header_filename);
+int bricked_field_loading_has_finished(size_t loading_id);
+const char* finish_loading_bricked_field(size_t loading_id, BrickedField* bricked_field);
+void discard_bricked_field_loading(size_t loading_id);
+
+void cleanup_field_loading(void);
+
+#endif
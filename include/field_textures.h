@@ -12,6 +12,7 @@ void set_active_shader_program_for_field_textures(ShaderProgram* shader_program)
 const char* create_scalar_field_texture(void);
 
 void set_field_texture_field(const char* name, Field* field);
+void set_field_texture_bricked_field(const char* name, BrickedField* bricked_field);
 
 BrickedField* get_field_texture_bricked_field(const char* name);
 Field* get_field_texture_field(const char* name);
@@ -2,11 +2,19 @@
 #define FIELDS_H
 
 #include "dynamic_string.h"
+#include "io.h"
 
 #include <stddef.h>
 
 enum field_type {NULL_FIELD = 0, SCALAR_FIELD = 1, VECTOR_FIELD = 2};
 
+typedef struct FieldConfiguration
+{
+    int use_memory_mapping;
+    int use_streaming;
+    int use_deferral;
+} FieldConfiguration;
+
 typedef struct Field
 {
     DynamicString name;
@@ -24,14 +32,51 @@ typedef struct Field
     float physical_extent_scale;
     float min_value;
     float max_value;
+    float normalization_offset;
+    float normalization_scale;
+    int data_is_mapped;
+    int data_is_deferred; // Whether the data and value limits have yet to be loaded
+    DynamicString source_filename;
+    DynamicString source_header_filename;
+    size_t source_element_size;
+    int source_byte_order_is_swapped;
+    int source_is_column_major;
+    int source_is_compressed; // Compressed sources can only be loaded as a whole, not streamed
+    FieldConfiguration source_configuration; // Configuration that deferred data is loaded with
+    BinaryFileReadingConfiguration source_reading_configuration; // Configuration that the source file is read with
 } Field;
 
 void initialize_fields(void);
 
+void set_memory_mapped_field_loading(int state);
+void set_streamed_field_loading(int state);
+void set_deferred_field_loading(int state);
+FieldConfiguration get_field_configuration(void);
+
 const char* create_field_from_bifrost_file(const char* name, const char* data_filename, const char* header_filename);
+const char* create_field_region_from_bifrost_file(const char* name, const char* data_filename, const char* header_filename,
+                                                  size_t start_x, size_t end_x,
+                                                  size_t start_y, size_t end_y,
+                                                  size_t start_z, size_t end_z);
+const char* create_decimated_field_from_bifrost_file(const char* name, const char* data_filename, const char* header_filename,
+                                                     unsigned int stride);
+
+int compress_bifrost_file(const char* data_filename, const char* header_filename, const char* output_filename);
+
+void create_detached_field_from_bifrost_file(Field* field, const char* name, const char* data_filename, const char* header_filename,
+                                             const FieldConfiguration* field_configuration,
+                                             const BinaryFileReadingConfiguration* reading_configuration);
+const char* add_detached_field(Field* field);
+void clear_detached_field(Field* field);
 
 Field* get_field(const char* name);
 
+int field_values_can_be_read(const Field* field);
+float* read_field_slab(const Field* field, size_t start_z, size_t end_z);
+void load_deferred_field_data(Field* field);
+void set_field_value_limits(Field* field, float min_value, float max_value);
+void release_field_data(Field* field);
+
 void destroy_field(const char* name);
 void cleanup_fields(void);
 
@@ -2,12 +2,39 @@
 #define IO_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+typedef struct BinaryFileReadingConfiguration
+{
+    unsigned int n_reading_threads;
+    size_t reading_chunk_size;
+} BinaryFileReadingConfiguration;
+
+void set_binary_file_reading_thread_count(unsigned int n_threads);
+void set_binary_file_reading_chunk_size(size_t chunk_size);
+BinaryFileReadingConfiguration get_binary_file_reading_configuration(void);
 
 int is_little_endian(void);
 
 char* read_text_file(const char* filename);
-void* read_binary_file(const char* filename, size_t length, size_t element_size);
+void* read_binary_file(const char* filename, size_t length, size_t element_size, int swap_byte_order,
+                       const BinaryFileReadingConfiguration* reading_configuration);
+float* read_float_binary_file(const char* filename, size_t length, size_t element_size, int swap_byte_order,
+                              const BinaryFileReadingConfiguration* reading_configuration);
+float* read_float_binary_file_region(const char* filename, size_t element_size, int swap_byte_order,
+                                     const size_t file_shape[3], const size_t region_start[3],
+                                     const size_t region_shape[3], const size_t region_stride[3],
+                                     const BinaryFileReadingConfiguration* reading_configuration);
+int is_compressed_float_binary_file(const char* filename);
+int write_compressed_float_binary_file(const char* filename, const float* data, size_t length);
+float* read_compressed_float_binary_file(const char* filename, size_t length);
+void* map_binary_file(const char* filename, size_t length, size_t element_size);
+void unmap_binary_file(void* data, size_t length, size_t element_size);
+int write_binary_file(const char* filename, const void* header, size_t header_size, const void* data, size_t data_size);
+int write_binary_file_sections(const char* filename, const void* const* sections, const size_t* section_sizes, size_t n_sections);
+int get_file_size_and_modification_time(const char* filename, size_t* size, int64_t* modification_time);
 
+int has_entry_in_header(const char* header, const char* entry_name, const char* separator);
 int find_int_entry_in_header(const char* header, const char* entry_name, const char* separator);
 float find_float_entry_in_header(const char* header, const char* entry_name, const char* separator);
 char find_char_entry_in_header(const char* header, const char* entry_name, const char* separator);
@@ -2,6 +2,7 @@
 #define RENDERER_H
 
 #include "fields.h"
+#include "bricks.h"
 
 void initialize_renderer(void);
 void cleanup_renderer(void);
@@ -19,5 +20,6 @@ const char* get_single_field_rendering_texture_name(void);
 const char* get_single_field_rendering_TF_name(void);
 
 void set_single_field_rendering_field(const char* field_name);
+void set_single_field_rendering_bricked_field(BrickedField* bricked_field);
 
 #endif
@@ -0,0 +1,33 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+typedef void (*ParallelTask)(void* shared_data, size_t task_idx, unsigned int thread_idx);
+typedef void (*BackgroundTask)(void* data);
+
+typedef struct BackgroundThread
+{
+    pthread_t thread;
+    BackgroundTask task;
+    void* data;
+    int is_running;
+    int has_finished;
+} BackgroundThread;
+
+unsigned int get_available_processor_count(void);
+
+void set_worker_thread_count(unsigned int n_threads);
+unsigned int get_worker_thread_count(void);
+
+void run_parallel_tasks(ParallelTask task, void* shared_data, size_t n_tasks, unsigned int n_threads);
+
+void reset_background_thread(BackgroundThread* background_thread);
+void start_background_thread(BackgroundThread* background_thread, BackgroundTask task, void* data);
+int background_thread_has_finished(BackgroundThread* background_thread);
+void join_background_thread(BackgroundThread* background_thread);
+
+double get_wall_clock_time(void);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include "bricks.h"
+
+#include <stddef.h>
+
+void initialize_time_series(void);
+
+void set_time_series_prefetch_count(unsigned int prefetch_count);
+
+void start_time_series(const char* field_name, const char* base_name_pattern, unsigned int start_frame, unsigned int end_frame);
+int advance_time_series(BrickedField* bricked_field, int wait);
+int time_series_has_ended(void);
+unsigned int get_current_time_series_frame(void);
+void get_time_series_prefetch_status(unsigned int* n_ready_frames, unsigned int* n_loading_frames,
+                                     size_t* n_stalled_steps, double* total_stall_time);
+void stop_time_series(void);
+
+void cleanup_time_series(void);
+
+#endif
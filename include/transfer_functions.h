@@ -40,6 +40,8 @@ void set_transfer_function_lower_node_value(const char* name, enum transfer_func
 void set_transfer_function_upper_node_value(const char* name, enum transfer_function_component component, float value);
 
 void update_visibility_ratios(const char* transfer_function_name, BrickedField* bricked_field);
+void update_visibility_ratios_from_opacities(const float* opacities, float lower_limit, float upper_limit,
+                                             BrickedField* bricked_field);
 
 unsigned int texture_coordinate_to_nearest_transfer_function_node(float texture_coordinate);
 float transfer_function_node_to_texture_coordinate(unsigned int node);
@@ -43,6 +43,7 @@ const Vector3f* get_camera_position(void);
 
 float get_model_scale(unsigned int axis);
 float get_component_of_vector_from_model_point_to_camera(const Vector3f* point, unsigned int component);
+float get_projected_length_in_pixels(const Vector3f* model_point, float length);
 
 void enable_camera_control(void);
 void disable_camera_control(void);
@@ -14,6 +14,7 @@ void set_active_bricked_field(const BrickedField* bricked_field);
 
 void set_lower_visibility_threshold(float threshold);
 void set_upper_visibility_threshold(float threshold);
+void set_lod_pixel_threshold(float threshold);
 
 void toggle_field_outline_drawing(void);
 void toggle_brick_outline_drawing(void);
@@ -19,29 +19,148 @@
 #include "colors.h"
 #include "dynamic_string.h"
 #include "transformation.h"
+#include "io.h"
+#include "threads.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <math.h>
+#include <limits.h>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
 
 
 #define MIN_PADDED_BRICK_SIZE 8
 #define BOUNDARY_INDICATOR_ALPHA 0.15f
 
+// The version must be incremented whenever the layout of the cached brick data changes
+#define BRICK_CACHE_VERSION 10
+#define BRICK_CACHE_BYTE_ORDER_MARK 0x01020304
+// The brick data starts on a page boundary, so that it is page aligned when mapped
+#define BRICK_CACHE_PAGE_SIZE 4096
+// The other sections start on boundaries suitable for any of their elements
+#define BRICK_CACHE_SECTION_ALIGNMENT 8
+#define MAX_BRICK_CACHE_SECTIONS 32
+#define MAX_BRICK_CACHE_SOURCE_PATH_LENGTH 2048
+// Entry in the table of constant brick values for bricks that are not constant, which is outside the normalized range
+#define NON_CONSTANT_BRICK_MARKER -1.0f
+// Smallest reduction in the volume-weighted value range of a sub brick, relative to that of the whole sub brick, for
+// which an adaptive split is preferred over a midpoint split. Smaller reductions are mostly noise in the data.
+#define MIN_ADAPTIVE_SPLIT_GAIN 0.02f
+
 
 typedef struct NodeIndices
 {
     size_t idx[3];
 } NodeIndices;
 
-typedef struct Configuration
+typedef struct SlabRead
+{
+    const Field* field;
+    const BrickedField* source_bricked_field; // Read from instead of the source file of the field if not NULL
+    size_t start_z;
+    size_t end_z;
+    float* slab;
+} SlabRead;
+
+typedef struct BrickFilling
+{
+    const BrickedField* bricked_field;
+    const float* source_data;
+    size_t source_offset_z;
+    size_t first_brick_idx;
+    float** scratch_arrays; // One array per thread for bricks that are converted after being filled, otherwise NULL
+} BrickFilling;
+
+typedef struct LODLevel
+{
+    const BrickedField* bricked_field;
+    unsigned int level;
+    const float* source_data; // Downsampled field of the previous level, or NULL for the first level
+    size_t source_size[3];
+    float* data; // Downsampled field of this level
+    size_t size[3];
+} LODLevel;
+
+typedef struct SubBrickCells
+{
+    size_t size_limit; // Sub brick size limit and constant brick tolerance of the bricked field
+    float constant_brick_tolerance;
+    size_t cell_size;
+    size_t n_cells[3];
+    float* min_values; // Value limits of each cell of the brick, with x varying fastest
+    float* max_values;
+    float* layer_min_values[3]; // Value limits of each layer of cells along every axis within the current node
+    float* layer_max_values[3];
+    float* prefix_min_values; // Value limits of the layers preceding each layer along the current axis
+    float* prefix_max_values;
+} SubBrickCells;
+
+// Identifies the source file and the configuration that the cached bricks were built from
+typedef struct BrickCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t source_size;
+    int64_t source_modification_time;
+    uint32_t source_element_size;
+    uint8_t source_byte_order_is_swapped;
+    uint8_t source_is_column_major;
+    uint64_t field_size[3];
+    float field_half_extent[3]; // Half extent of the field in normalized units, which determines the spatial extents of the bricks
+    uint64_t brick_size;
+    uint32_t pad_size;
+    uint32_t data_type;
+    float constant_brick_tolerance;
+    uint32_t sub_brick_size_limit;
+    uint32_t uses_adaptive_sub_brick_splits;
+    uint32_t creates_lod_bricks;
+    uint64_t data_length; // Total length of the data of all bricks, including the constant ones
+    char source_path[MAX_BRICK_CACHE_SOURCE_PATH_LENGTH]; // Absolute path of the source file
+} BrickCacheHeader;
+
+// Follows the header in the cache, but depends on the field values rather than identifying the cache
+typedef struct BrickCacheContents
+{
+    float min_value;
+    float max_value;
+    float normalization_offset;
+    float normalization_scale;
+    uint64_t stored_data_length; // Length of the data of the non-constant bricks, which is what is stored
+    uint64_t n_sub_brick_tree_nodes;
+    uint64_t n_histogram_entries;
+    uint64_t n_lod_bricks;
+    uint64_t lod_data_length;
+} BrickCacheContents;
+
+// Byte offsets of the sections of the cache
+typedef struct BrickCacheLayout
 {
-    size_t requested_brick_size;
-    unsigned int kernel_size;
-    unsigned int sub_brick_size_limit;
-    int create_field_boundary_indicator;
-    int create_brick_boundary_indicator;
-    int create_sub_brick_boundary_indicator;
-} Configuration;
+    size_t constant_values_offset; // Constant value of each brick, or NON_CONSTANT_BRICK_MARKER
+    size_t sub_brick_tree_node_counts_offset; // Number of sub brick tree nodes of each brick, in brick storage order
+    size_t sub_brick_tree_nodes_offset; // Sub brick tree nodes of all bricks, in brick storage order
+    size_t histogram_starts_offset; // Index of the first value histogram entry of each sub brick tree node, and the total
+    size_t histogram_entries_offset; // Value histogram entries of all bricks, in brick storage order
+    size_t tree_nodes_offset; // Brick tree nodes
+    size_t tree_lod_brick_indices_offset; // LOD brick index of each brick tree node
+    size_t lod_bricks_offset; // LOD bricks, whose data pointers and texture IDs are not meaningful
+    size_t data_offset; // Data of the non-constant bricks, in brick storage order
+    size_t lod_data_offset; // Data of the LOD bricks
+    size_t size;
+} BrickCacheLayout;
+
+// Sections of the cache to write, including the padding between them
+typedef struct BrickCacheSections
+{
+    const void* data[MAX_BRICK_CACHE_SECTIONS]; // NULL for padding
+    size_t sizes[MAX_BRICK_CACHE_SECTIONS];
+    size_t n_sections;
+    size_t size;
+} BrickCacheSections;
 
 
 static void copy_subarray_with_cycled_layout(const float* full_input_array,
@@ -49,36 +168,112 @@ static void copy_subarray_with_cycled_layout(const float* full_input_array,
                                              size_t input_offset_x, size_t input_offset_y, size_t input_offset_z,
                                              float* output_array,
                                              size_t output_size_x, size_t output_size_y, size_t output_size_z,
-                                             unsigned int cycle);
-
-static void create_brick_tree(BrickedField* bricked_field);
-static BrickTreeNode* create_brick_tree_nodes(BrickedField* bricked_field, unsigned int level,
-                                              NodeIndices start_indices, NodeIndices end_indices);
-static BrickTreeNode* create_brick_tree_leaf_node(BrickedField* bricked_field, NodeIndices indices);
-
-static void create_sub_brick_tree(Brick* brick, const Field* field);
-static SubBrickTreeNode* create_sub_brick_tree_nodes(const Brick* brick, const Field* field, unsigned int level,
-                                                     NodeIndices start_indices, NodeIndices end_indices);
-static SubBrickTreeNode* create_sub_brick_tree_node(const Brick* brick, const Field* field,
-                                                    NodeIndices start_indices, NodeIndices end_indices);
-
-static void destroy_brick_tree(BrickedField* bricked_field);
-static void destroy_brick_tree_node(BrickTreeNode* node);
-
-static void destroy_sub_brick_tree(Brick* brick);
-static void destroy_sub_brick_tree_node(SubBrickTreeNode* node);
+                                             unsigned int cycle,
+                                             float zero_value, float scale);
+static void copy_transposed_plane(const float* input_plane, size_t input_row_stride,
+                                  float* output_plane, size_t output_row_stride,
+                                  size_t n_rows, size_t n_columns,
+                                  float zero_value, float scale);
+static void convert_values(const float* values, void* converted_values, size_t n_values, enum brick_data_type data_type);
+
+static int create_brick_cache_header(const BrickedField* bricked_field, size_t data_length, BrickCacheHeader* header);
+static void find_brick_cache_layout(const BrickedField* bricked_field, const BrickCacheContents* contents, BrickCacheLayout* layout);
+static size_t align_brick_cache_offset(size_t offset, size_t alignment);
+static int load_cached_bricked_field(BrickedField* bricked_field, size_t data_length);
+static void load_cached_brick_tree(BrickedField* bricked_field, const char* mapping,
+                                   const BrickCacheLayout* layout, const BrickCacheContents* contents);
+static void write_cached_bricked_field(const BrickedField* bricked_field, size_t data_length);
+static void add_brick_cache_section(BrickCacheSections* sections, size_t offset, const void* data, size_t size);
+
+static void fill_bricks(const BrickedField* bricked_field, const float* source_data, size_t source_offset_z,
+                        size_t first_brick_idx, size_t n_bricks);
+static void fill_brick(void* shared_data, size_t task_idx, unsigned int thread_idx);
+static void detect_constant_brick(const BrickedField* bricked_field, Brick* brick);
+static void compact_brick_data(BrickedField* bricked_field);
+static void build_bricked_field_from_source(BrickedField* bricked_field, Field* field, const BrickedField* source_bricked_field,
+                                            const BrickingConfiguration* build_configuration);
+static void fill_bricks_from_streamed_slabs(const BrickedField* bricked_field, const BrickedField* source_bricked_field);
+static void start_reading_brick_layer_slab(const BrickedField* bricked_field, const BrickedField* source_bricked_field, size_t layer_idx,
+                                           SlabRead* slab_read, BackgroundThread* slab_reading_thread);
+static void read_slab_in_background(void* slab_read_ptr);
+
+static size_t get_brick_tree_node_count(size_t n_bricks);
+static void create_brick_tree(BrickedField* bricked_field, int create_lod_bricks);
+static void allocate_brick_tree(BrickedField* bricked_field);
+static uint32_t create_brick_tree_nodes(BrickedField* bricked_field, unsigned int level, unsigned int parent_lod_level,
+                                        NodeIndices start_indices, NodeIndices end_indices, uint32_t* n_created_nodes);
+static int find_brick_split(unsigned int* level, NodeIndices start_indices, NodeIndices end_indices,
+                            unsigned int* split_axis, size_t* middle_idx);
+static void find_brick_storage_order(BrickedField* bricked_field, unsigned int level,
+                                     NodeIndices start_indices, NodeIndices end_indices, size_t* n_ordered_bricks);
+
+static unsigned int find_lod_level(const BrickedField* bricked_field, NodeIndices start_indices, NodeIndices end_indices,
+                                   size_t region_start[3], size_t region_end[3]);
+static void add_lod_brick(BrickedField* bricked_field, uint32_t node_idx, unsigned int level,
+                          const size_t region_start[3], const size_t region_end[3]);
+static size_t get_lod_brick_data_length(const LODBrick* lod_brick);
+static void create_lod_bricks(BrickedField* bricked_field);
+static void downsample_brick_to_first_lod_level(void* shared_data, size_t task_idx, unsigned int thread_idx);
+static void downsample_lod_level_slice(void* shared_data, size_t slice_idx, unsigned int thread_idx);
+static void fill_lod_brick(void* shared_data, size_t lod_brick_idx, unsigned int thread_idx);
+
+static void allocate_sub_brick_trees(BrickedField* bricked_field);
+static void set_sub_brick_tree_pointers(BrickedField* bricked_field);
+static void compact_sub_brick_trees(BrickedField* bricked_field);
+static void gather_sub_brick_histograms(BrickedField* bricked_field);
+static void create_sub_brick_histograms(const BrickedField* bricked_field, Brick* brick);
+static void add_region_to_value_histogram(const BrickedField* bricked_field, const Brick* brick,
+                                          NodeIndices start_indices, NodeIndices end_indices, uint32_t* counts);
+static void add_row_to_value_histogram(const BrickedField* bricked_field, const Brick* brick, size_t start_idx, size_t length, uint32_t* counts);
+static unsigned int find_value_histogram_bin(float value);
+static void create_sub_brick_tree(const BrickedField* bricked_field, Brick* brick);
+static int find_sub_brick_split(size_t size_limit, unsigned int* level, NodeIndices start_indices, NodeIndices end_indices,
+                                unsigned int* split_axis, size_t* middle_idx);
+static size_t count_sub_brick_tree_nodes(size_t size_limit, unsigned int level, NodeIndices start_indices, NodeIndices end_indices);
+static size_t count_max_adaptive_sub_brick_tree_nodes(const BrickedField* bricked_field, const Brick* brick);
+static SubBrickTreeNode* add_sub_brick_tree_node(Brick* brick, NodeIndices start_indices, NodeIndices end_indices, uint32_t* n_created_nodes);
+static uint32_t create_sub_brick_tree_nodes(const BrickedField* bricked_field, Brick* brick, unsigned int level,
+                                            NodeIndices start_indices, NodeIndices end_indices, uint32_t* n_created_nodes);
+static void create_sub_brick_cells(const BrickedField* bricked_field, const Brick* brick, SubBrickCells* cells);
+static void destroy_sub_brick_cells(SubBrickCells* cells);
+static uint32_t create_adaptive_sub_brick_tree_nodes(Brick* brick, SubBrickCells* cells, unsigned int level,
+                                                     NodeIndices start_indices, NodeIndices end_indices, uint32_t* n_created_nodes);
+static void find_cell_layer_value_limits(SubBrickCells* cells, const size_t start_cells[3], const size_t end_cells[3],
+                                         float* min_value, float* max_value);
+static int find_adaptive_sub_brick_split(SubBrickCells* cells, unsigned int level, NodeIndices start_indices, NodeIndices end_indices,
+                                         const size_t start_cells[3], const size_t end_cells[3], float value_range,
+                                         unsigned int* split_axis, size_t* split_idx);
+static void find_brick_region_value_limits(const BrickedField* bricked_field, const Brick* brick,
+                                           NodeIndices start_indices, NodeIndices end_indices, float* min_value, float* max_value);
+static size_t get_brick_region_memory_layout(const BrickedField* bricked_field, const Brick* brick,
+                                             NodeIndices start_indices, NodeIndices end_indices,
+                                             size_t memory_sizes[3], size_t memory_strides[3]);
+static void update_value_limits_for_row(const BrickedField* bricked_field, const Brick* brick, size_t start_idx, size_t length,
+                                        float* min_value, float* max_value);
+static void find_float_region_limits(const float* data, const size_t sizes[3], const size_t strides[3], float* min_value, float* max_value);
+
+static size_t find_brick_tree_nodes_in_value_range(const BrickedField* bricked_field, uint32_t node_idx,
+                                                   float lower_value, float upper_value, size_t* brick_indices, size_t n_found);
+static size_t find_sub_brick_tree_nodes_in_value_range(const Brick* brick, uint32_t node_idx,
+                                                       float lower_value, float upper_value, uint32_t* node_indices, size_t n_found);
+
+static void destroy_brick_trees(BrickedField* bricked_field);
 
 static void create_boundary_indicator_for_field(BrickedField* bricked_field);
 static void create_boundary_indicator_for_bricks(BrickedField* bricked_field);
 static void create_boundary_indicator_for_sub_bricks(BrickedField* bricked_field);
 
-static void set_sub_brick_boundary_indicator_data(Indicator* indicator, SubBrickTreeNode* node, size_t* running_vertex_idx, size_t* running_index_idx);
+static void set_sub_brick_boundary_indicator_data(Indicator* indicator, const BrickedField* bricked_field, Brick* brick,
+                                                  size_t* running_vertex_idx, size_t* running_index_idx);
+
+static void draw_brick_boundaries(const BrickedField* bricked_field, uint32_t node_idx);
+static void draw_sub_brick_boundaries(const Brick* brick, uint32_t node_idx);
 
-static void draw_brick_boundaries(const BrickTreeNode* node);
-static void draw_sub_brick_boundaries(const SubBrickTreeNode* node);
 
+static BrickingConfiguration configuration;
 
-static Configuration configuration;
+// For each brick orientation, the position of the x, y and z-axis in the order from fastest to slowest varying
+static const unsigned int brick_axis_permutations[3][3] = {{0, 1, 2}, {2, 0, 1}, {1, 2, 0}};
 
 // Sets of faces adjacent to each cube corner                      //    2----------5
 static const unsigned int adjacent_cube_faces[8][3] = {{0, 2, 4},  //   /|         /|
@@ -110,6 +305,12 @@ void initialize_bricks(void)
     configuration.create_field_boundary_indicator = 1;
     configuration.create_brick_boundary_indicator = 0;
     configuration.create_sub_brick_boundary_indicator = 0;
+    configuration.use_brick_cache = 0;
+    configuration.data_type = BRICK_DATA_FLOAT32;
+    configuration.constant_brick_tolerance = 0.0f;
+    configuration.create_lod_bricks = 1;
+    configuration.use_adaptive_sub_brick_splits = 1;
+    configuration.release_field_data = 0;
 
     field_boundary_color = create_standard_color(COLOR_WHITE, BOUNDARY_INDICATOR_ALPHA);
     brick_boundary_color = create_standard_color(COLOR_YELLOW, BOUNDARY_INDICATOR_ALPHA);
@@ -124,12 +325,35 @@ void reset_bricked_field(BrickedField* bricked_field)
 {
     bricked_field->field = NULL;
     bricked_field->bricks = NULL;
+    bricked_field->brick_storage_order = NULL;
     bricked_field->tree = NULL;
+    bricked_field->n_tree_nodes = 0;
+    bricked_field->tree_visibility_ratios = NULL;
+    bricked_field->tree_lod_brick_indices = NULL;
+    bricked_field->sub_brick_tree_nodes = NULL;
+    bricked_field->n_sub_brick_tree_nodes = 0;
+    bricked_field->sub_brick_visibility_ratios = NULL;
+    bricked_field->sub_brick_histogram_starts = NULL;
+    bricked_field->histogram_entries = NULL;
+    bricked_field->n_histogram_entries = 0;
     bricked_field->n_bricks = 0;
     bricked_field->n_bricks_x = 0;
     bricked_field->n_bricks_y = 0;
     bricked_field->n_bricks_z = 0;
     bricked_field->brick_size = 0;
+    bricked_field->pad_size = 0;
+    bricked_field->data_type = BRICK_DATA_FLOAT32;
+    bricked_field->sub_brick_size_limit = 0;
+    bricked_field->constant_brick_tolerance = 0;
+    bricked_field->uses_adaptive_sub_brick_splits = 0;
+    bricked_field->creates_lod_bricks = 0;
+    bricked_field->data = NULL;
+    bricked_field->data_length = 0;
+    bricked_field->cache_mapping = NULL;
+    bricked_field->cache_mapping_size = 0;
+    bricked_field->lod_bricks = NULL;
+    bricked_field->n_lod_bricks = 0;
+    bricked_field->lod_data = NULL;
     bricked_field->texture_unit = 0;
     bricked_field->field_boundary_indicator_name = NULL;
     bricked_field->brick_boundary_indicator_name = NULL;
@@ -171,29 +395,209 @@ void set_sub_brick_boundary_indicator_creation(int state)
     configuration.create_sub_brick_boundary_indicator = state;
 }
 
+void set_bricked_field_caching(int state)
+{
+    check(state == 0 || state == 1);
+    configuration.use_brick_cache = state;
+}
+
+void set_brick_data_type(enum brick_data_type data_type)
+{
+    check(data_type == BRICK_DATA_FLOAT32 || data_type == BRICK_DATA_UINT16 || data_type == BRICK_DATA_UINT8 || data_type == BRICK_DATA_FLOAT16);
+    configuration.data_type = data_type;
+}
+
+void set_constant_brick_tolerance(float tolerance)
+{
+    check(tolerance >= 0);
+    configuration.constant_brick_tolerance = tolerance;
+}
+
+void set_lod_brick_creation(int state)
+{
+    /*
+    LOD bricks take additional memory, both in main memory and as textures.
+    Each level halves the resolution of the previous one along every axis, so
+    the LOD bricks of level L hold about 1/8^L of the voxels of the field,
+    plus their padding. All levels together thus add about 1/7 of the voxels
+    of the field in the brick data type, including the regions covered by
+    constant bricks. The padding raises this to about 15% with the default
+    brick size of 64, and to about 25% with a brick size of 16. While they
+    are created, two consecutive levels are also held in single precision,
+    taking at most 9/64 of the size of the field in single precision.
+    */
+
+    check(state == 0 || state == 1);
+    configuration.create_lod_bricks = state;
+}
+
+void set_adaptive_sub_brick_splitting(int state)
+{
+    check(state == 0 || state == 1);
+    configuration.use_adaptive_sub_brick_splits = state;
+}
+
+void set_field_data_release(int state)
+{
+    check(state == 0 || state == 1);
+    configuration.release_field_data = state;
+}
+
+BrickingConfiguration get_bricking_configuration(void)
+{
+    /*
+    Returns a copy of the current bricking configuration, for bricking fields
+    on other threads (see build_bricked_field).
+    */
+
+    return configuration;
+}
+
 void create_bricked_field(BrickedField* bricked_field, Field* field)
 {
+    build_bricked_field(bricked_field, field, &configuration);
+    create_bricked_field_indicators(bricked_field);
+}
+
+void build_bricked_field(BrickedField* bricked_field, Field* field, const BrickingConfiguration* bricking_configuration)
+{
+    /*
+    Performs all the CPU work of creating a bricked field: subdividing the
+    field into bricks, copying the normalized field values into them and
+    building the brick trees, using the given bricking configuration. Since no
+    GL calls are made and the current configuration is not read, this can be
+    called from any thread, given a configuration copied on the main thread
+    (see get_bricking_configuration).
+
+    If the field has no data, its values are instead streamed from its source
+    file one layer of bricks at a time (see fill_bricks_from_streamed_slabs).
+    If field data release is enabled, the data of the field is released once
+    the bricks have been filled.
+    */
+
     check(bricked_field);
     check(field);
-    check(field->data);
+    check(field_values_can_be_read(field));
+    check(bricking_configuration);
+
+    build_bricked_field_from_source(bricked_field, field, NULL, bricking_configuration);
+}
+
+void rebuild_bricked_field(BrickedField* bricked_field, const BrickedField* source_bricked_field)
+{
+    /*
+    Like build_bricked_field, but bricks the field of the given existing
+    bricked field using the values stored in its bricks, so that the field
+    can be bricked anew with a different configuration after its data has
+    been released. The values are only as precise as the data type of the
+    existing bricks allows. The bricks are built with the current
+    configuration, so this must be called from the main thread.
+    */
+
+    check(bricked_field);
+    check(source_bricked_field);
+    check(source_bricked_field->field);
+    check(bricked_field != source_bricked_field);
+
+    build_bricked_field_from_source(bricked_field, source_bricked_field->field, source_bricked_field, &configuration);
+}
+
+float* read_bricked_field_slab(const BrickedField* bricked_field, size_t start_z, size_t end_z)
+{
+    /*
+    Reads the unnormalized values of the given z-range of the field from the
+    bricks into a newly allocated array with x varying fastest, like
+    read_field_slab does from the source file. Since only the bricks are
+    read, this can be called from any thread.
+    */
+
+    check(bricked_field);
+    check(bricked_field->bricks);
+
+    const Field* const field = bricked_field->field;
+    check(start_z < end_z && end_z <= field->size_z);
+
+    const size_t size_x = field->size_x;
+    const size_t size_y = field->size_y;
+
+    float* const slab = (float*)malloc(sizeof(float)*size_x*size_y*(end_z - start_z));
+    check(slab);
+
+    const size_t brick_size = bricked_field->brick_size;
+    const size_t pad_size = bricked_field->pad_size;
+    const float scale = 1.0f/field->normalization_scale;
+    const float offset = field->normalization_offset;
+
+    size_t brick_idx_x, brick_idx_y, brick_idx_z;
+    size_t i, j, k;
+    size_t strides[3];
+    size_t brick_start_z, brick_end_z, brick_end_y, brick_end_x;
+    size_t idx;
+    float* slab_row;
+
+    // Each voxel is read from the brick that covers it without padding
+    for (brick_idx_z = start_z/brick_size; brick_idx_z <= (end_z - 1)/brick_size; brick_idx_z++)
+    {
+        brick_start_z = max_size_t(brick_idx_z*brick_size, start_z);
+        brick_end_z = min_size_t((brick_idx_z + 1)*brick_size, end_z);
+
+        for (brick_idx_y = 0; brick_idx_y < bricked_field->n_bricks_y; brick_idx_y++)
+        {
+            brick_end_y = min_size_t((brick_idx_y + 1)*brick_size, size_y);
+
+            for (brick_idx_x = 0; brick_idx_x < bricked_field->n_bricks_x; brick_idx_x++)
+            {
+                brick_end_x = min_size_t((brick_idx_x + 1)*brick_size, size_x);
+
+                const Brick* const brick = bricked_field->bricks + (brick_idx_z*bricked_field->n_bricks_y + brick_idx_y)*bricked_field->n_bricks_x + brick_idx_x;
+                get_brick_data_strides(brick, strides);
+
+                for (k = brick_start_z; k < brick_end_z; k++)
+                    for (j = brick_idx_y*brick_size; j < brick_end_y; j++)
+                    {
+                        slab_row = slab + ((k - start_z)*size_y + j)*size_x;
+
+                        idx = (j + pad_size - brick->offset_y)*strides[1] + (k + pad_size - brick->offset_z)*strides[2];
+
+                        for (i = brick_idx_x*brick_size; i < brick_end_x; i++)
+                            slab_row[i] = get_brick_data_value(bricked_field, brick, idx + (i + pad_size - brick->offset_x)*strides[0])*scale + offset;
+                    }
+            }
+        }
+    }
+
+    return slab;
+}
+
+static void build_bricked_field_from_source(BrickedField* bricked_field, Field* field, const BrickedField* source_bricked_field,
+                                            const BrickingConfiguration* build_configuration)
+{
+    /*
+    Creates the bricked field for the given field, taking the field values
+    from the bricks of the given source bricked field if it is not NULL, and
+    otherwise from the field data or source file.
+    */
+
+    assert(bricked_field);
+    assert(field);
+    assert(build_configuration);
 
     if (field->type != SCALAR_FIELD)
         print_severe_message("Bricking is only supported for scalar fields.");
 
-    float* const field_data = field->data;
     const size_t field_size_x = field->size_x;
     const size_t field_size_y = field->size_y;
     const size_t field_size_z = field->size_z;
 
-    size_t pad_size = configuration.kernel_size - 1; // The number of voxels to pad on each side is one less than the size of the interpolation kernel
+    size_t pad_size = build_configuration->kernel_size - 1; // The number of voxels to pad on each side is one less than the size of the interpolation kernel
 
     // In the special case of using only one brick that exactly fits the field, no padding is needed
-    if (configuration.requested_brick_size == field_size_x &&
-        configuration.requested_brick_size == field_size_y &&
-        configuration.requested_brick_size == field_size_z)
+    if (build_configuration->requested_brick_size == field_size_x &&
+        build_configuration->requested_brick_size == field_size_y &&
+        build_configuration->requested_brick_size == field_size_z)
         pad_size = 0;
 
-    size_t padded_brick_size = max_size_t(configuration.requested_brick_size, MIN_PADDED_BRICK_SIZE);
+    size_t padded_brick_size = max_size_t(build_configuration->requested_brick_size, MIN_PADDED_BRICK_SIZE);
 
     // Make sure that the brick size without padding will never be smaller than the pad size
     if (padded_brick_size < 3*pad_size)
@@ -201,6 +605,9 @@ void create_bricked_field(BrickedField* bricked_field, Field* field)
 
     const size_t brick_size = padded_brick_size - 2*pad_size;
 
+    // Sub brick offsets and sizes within a brick are stored as 16-bit integers
+    check(brick_size <= UINT16_MAX);
+
     if (brick_size > field_size_x || brick_size > field_size_y || brick_size > field_size_z)
         print_severe_message("Brick dimensions (%d, %d, %d) exceed field dimensions of (%d, %d, %d).",
                              brick_size, brick_size, brick_size, field_size_x, field_size_y, field_size_z);
@@ -228,9 +635,36 @@ void create_bricked_field(BrickedField* bricked_field, Field* field)
     const size_t new_data_size_z = field_size_z + 2*pad_size*(n_bricks_z - 1);
     const size_t new_data_length = new_data_size_x*new_data_size_y*new_data_size_z;
 
-    // Values for all the bricks are stored in the same array, which will be the one pointed to by the first brick
-    float* const new_data = (float*)calloc(new_data_length, sizeof(float));
-    check(new_data);
+    const enum brick_data_type data_type = build_configuration->data_type;
+    const size_t data_type_size = get_brick_data_type_size(data_type);
+
+    bricked_field->field = field;
+
+    bricked_field->bricks = bricks;
+    bricked_field->n_bricks = n_bricks;
+    bricked_field->n_bricks_x = n_bricks_x;
+    bricked_field->n_bricks_y = n_bricks_y;
+    bricked_field->n_bricks_z = n_bricks_z;
+
+    bricked_field->brick_size = brick_size;
+    bricked_field->pad_size = pad_size;
+
+    bricked_field->data_type = data_type;
+    bricked_field->sub_brick_size_limit = build_configuration->sub_brick_size_limit;
+    bricked_field->constant_brick_tolerance = build_configuration->constant_brick_tolerance;
+    bricked_field->uses_adaptive_sub_brick_splits = build_configuration->use_adaptive_sub_brick_splits;
+    bricked_field->creates_lod_bricks = build_configuration->create_lod_bricks;
+
+    bricked_field->data = NULL;
+    bricked_field->data_length = 0;
+
+    // Only fields holding the complete content of a file can be cached, since the cache is identified by the file. Bricks
+    // filled from other bricks may have lost precision compared to the file, so they are neither cached nor loaded from cache.
+    const int use_brick_cache = build_configuration->use_brick_cache && field->source_filename.chars && !source_bricked_field;
+
+    bricked_field->lod_bricks = NULL;
+    bricked_field->n_lod_bricks = 0;
+    bricked_field->lod_data = NULL;
 
     size_t i, j, k;
     Brick* brick;
@@ -246,12 +680,8 @@ void create_bricked_field(BrickedField* bricked_field, Field* field)
     size_t padded_brick_size_x;
     size_t padded_brick_size_y;
     size_t padded_brick_size_z;
-    size_t field_offset_x;
-    size_t field_offset_y;
-    size_t field_offset_z;
-
-    const unsigned int permutations[3][3] = {{0, 1, 2}, {2, 0, 1}, {1, 2, 0}};
 
+    // The layout of all bricks is determined up front, so that their data can subsequently be filled in parallel
     for (k = 0; k < n_bricks_z; k++)
     {
         for (j = 0; j < n_bricks_y; j++)
@@ -261,7 +691,7 @@ void create_bricked_field(BrickedField* bricked_field, Field* field)
                 brick_idx = (k*n_bricks_y + j)*n_bricks_x + i;
                 brick = bricks + brick_idx;
 
-                brick->data = new_data + data_offset;
+                brick->data = NULL;
 
                 // This cycling of the brick orientation ensures that no direct neighbors have the same orientation
                 cycle = (i + j + k) % 3;
@@ -282,9 +712,9 @@ void create_bricked_field(BrickedField* bricked_field, Field* field)
                 padded_brick_size_z = unpadded_brick_size_z + (k > 0)*pad_size + (k < n_bricks_z - 1)*pad_size;
 
                 // The padded dimensions of the brick are listed from fastest to slowest varying
-                brick->padded_size[permutations[cycle][0]] = padded_brick_size_x;
-                brick->padded_size[permutations[cycle][1]] = padded_brick_size_y;
-                brick->padded_size[permutations[cycle][2]] = padded_brick_size_z;
+                brick->padded_size[brick_axis_permutations[cycle][0]] = padded_brick_size_x;
+                brick->padded_size[brick_axis_permutations[cycle][1]] = padded_brick_size_y;
+                brick->padded_size[brick_axis_permutations[cycle][2]] = padded_brick_size_z;
 
                 brick->offset_x = unpadded_brick_offset_x + (i == 0)*pad_size;
                 brick->offset_y = unpadded_brick_offset_y + (j == 0)*pad_size;
@@ -311,34 +741,106 @@ void create_bricked_field(BrickedField* bricked_field, Field* field)
 
                 data_offset += padded_brick_size_x*padded_brick_size_y*padded_brick_size_z;
 
-                // Decrease offset into the original data array to include the padding data (unless we are at a lower edge)
-                field_offset_x = unpadded_brick_offset_x - (i > 0)*pad_size;
-                field_offset_y = unpadded_brick_offset_y - (j > 0)*pad_size;
-                field_offset_z = unpadded_brick_offset_z - (k > 0)*pad_size;
+                brick->data = NULL;
+                brick->is_constant = 0;
+                brick->constant_value = 0;
+
+                brick->tree = NULL;
+                brick->n_tree_nodes = 0;
+                brick->visibility_ratios = NULL;
+                brick->histogram_starts = NULL;
 
-                copy_subarray_with_cycled_layout(field_data,
-                                                 field_size_x, field_size_y,
-                                                 field_offset_x, field_offset_y, field_offset_z,
-                                                 brick->data,
-                                                 padded_brick_size_x, padded_brick_size_y, padded_brick_size_z,
-                                                 cycle);
+                brick->histogram = NULL;
+                brick->n_histogram_entries = 0;
 
                 brick->texture_id = 0;
             }
         }
     }
 
-    bricked_field->field = field;
+    assert(data_offset == new_data_length);
 
-    bricked_field->bricks = bricks;
-    bricked_field->n_bricks = n_bricks;
-    bricked_field->n_bricks_x = n_bricks_x;
-    bricked_field->n_bricks_y = n_bricks_y;
-    bricked_field->n_bricks_z = n_bricks_z;
+    // The data of the bricks is stored in the order in which the brick tree visits them, so that bricks that are close
+    // in space are mostly also close in memory
+    bricked_field->brick_storage_order = (size_t*)malloc(sizeof(size_t)*n_bricks);
+    check(bricked_field->brick_storage_order);
 
-    bricked_field->brick_size = brick_size;
+    const NodeIndices start_brick_indices = {{0, 0, 0}};
+    const NodeIndices end_brick_indices = {{n_bricks_x, n_bricks_y, n_bricks_z}};
+
+    size_t n_ordered_bricks = 0;
+    find_brick_storage_order(bricked_field, 0, start_brick_indices, end_brick_indices, &n_ordered_bricks);
+    assert(n_ordered_bricks == n_bricks);
+
+    // If a valid cache exists, the data of the non-constant bricks is mapped directly from it and nothing needs to be copied,
+    // and the trees, value histograms and LOD bricks are loaded along with it. The field data is then never needed, so if its loading was
+    // deferred it is only loaded when there is no valid cache.
+    const int data_is_cached = use_brick_cache && load_cached_bricked_field(bricked_field, new_data_length);
+
+    if (!data_is_cached)
+    {
+        if (field->data_is_deferred)
+            load_deferred_field_data(field);
+
+        // Values for all the bricks are initially stored in the same array. Every value is written when the bricks are
+        // filled, so the array does not need to be cleared. Leaving its pages untouched until then also means that each
+        // page is first touched by the thread that fills it.
+        bricked_field->data = malloc(data_type_size*new_data_length);
+        check(bricked_field->data);
+        bricked_field->data_length = new_data_length;
+
+        data_offset = 0;
+
+        for (brick_idx = 0; brick_idx < n_bricks; brick_idx++)
+        {
+            brick = bricks + bricked_field->brick_storage_order[brick_idx];
+            brick->data = (char*)bricked_field->data + data_type_size*data_offset;
+            data_offset += brick->padded_size[0]*brick->padded_size[1]*brick->padded_size[2];
+        }
 
-    create_brick_tree(bricked_field);
+        allocate_sub_brick_trees(bricked_field);
+
+        // The sub brick tree of each brick is created when the brick has been filled, while its data is still in cache
+        if (field->data && !source_bricked_field)
+            fill_bricks(bricked_field, field->data, 0, 0, n_bricks);
+        else
+            fill_bricks_from_streamed_slabs(bricked_field, source_bricked_field);
+
+        // Constant bricks were detected while filling, and their data no longer needs to be kept
+        compact_brick_data(bricked_field);
+
+        // Adaptively split sub brick trees can end up with fewer nodes than were allocated for them
+        compact_sub_brick_trees(bricked_field);
+
+        // The value histograms of the bricks were built along with their sub brick trees
+        gather_sub_brick_histograms(bricked_field);
+
+        // The brick tree takes its value limits from the sub brick trees, so it is created last
+        create_brick_tree(bricked_field, bricked_field->creates_lod_bricks);
+
+        // The LOD bricks registered with the brick tree are downsampled from the bricks
+        create_lod_bricks(bricked_field);
+
+        if (use_brick_cache)
+            write_cached_bricked_field(bricked_field, new_data_length);
+    }
+
+    // All the values of the field are now available from the bricks
+    if (build_configuration->release_field_data && field->data)
+    {
+        release_field_data(field);
+        print_info_message("Released the data of field %s after bricking it.", field->name.chars);
+    }
+
+    bricked_field->field_boundary_indicator_name = NULL;
+    bricked_field->brick_boundary_indicator_name = NULL;
+    bricked_field->sub_brick_boundary_indicator_name = NULL;
+}
+
+void create_bricked_field_indicators(BrickedField* bricked_field)
+{
+    check(bricked_field);
+    check(bricked_field->tree);
 
     if (configuration.create_field_boundary_indicator)
         create_boundary_indicator_for_field(bricked_field);
@@ -356,6 +858,119 @@ void create_bricked_field(BrickedField* bricked_field, Field* field)
         bricked_field->sub_brick_boundary_indicator_name = NULL;
 }
 
+size_t get_brick_data_type_size(enum brick_data_type data_type)
+{
+    switch (data_type)
+    {
+        case BRICK_DATA_FLOAT32:
+            return sizeof(float);
+        case BRICK_DATA_UINT16:
+        case BRICK_DATA_FLOAT16:
+            return sizeof(uint16_t);
+        case BRICK_DATA_UINT8:
+            return sizeof(uint8_t);
+        default:
+            print_severe_message("Invalid brick data type.");
+            return 0;
+    }
+}
+
+void get_brick_data_strides(const Brick* brick, size_t strides[3])
+{
+    /*
+    Finds the distances in the brick data array between adjacent voxels along
+    the x, y and z-axis, which depend on the orientation of the brick.
+    */
+
+    check(brick);
+    check(strides);
+
+    const unsigned int* const permutation = brick_axis_permutations[brick->orientation];
+
+    size_t dim;
+
+    for (dim = 0; dim < 3; dim++)
+        strides[dim] = (permutation[dim] == 0) ? 1 :
+                       (permutation[dim] == 1) ? brick->padded_size[0] : brick->padded_size[0]*brick->padded_size[1];
+}
+
+float get_brick_data_value(const BrickedField* bricked_field, const Brick* brick, size_t idx)
+{
+    // Returns the normalized value at the given index in the brick data, regardless of how it is stored
+    assert(bricked_field);
+    assert(brick);
+
+    if (brick->is_constant)
+        return brick->constant_value;
+
+    switch (bricked_field->data_type)
+    {
+        case BRICK_DATA_UINT16:
+            return (float)((const uint16_t*)brick->data)[idx]*(1.0f/(float)UINT16_MAX);
+        case BRICK_DATA_UINT8:
+            return (float)((const uint8_t*)brick->data)[idx]*(1.0f/(float)UINT8_MAX);
+        case BRICK_DATA_FLOAT16:
+            return half_to_float(((const uint16_t*)brick->data)[idx]);
+        default:
+            return ((const float*)brick->data)[idx];
+    }
+}
+
+void get_sub_brick_tree_node_box(const BrickedField* bricked_field, const Brick* brick, const SubBrickTreeNode* node,
+                                 Vector3f* spatial_offset, Vector3f* spatial_extent)
+{
+    /*
+    Computes the spatial offset and extent of the region covered by the given
+    sub brick tree node, which are not stored in the node to keep it compact.
+    */
+
+    assert(bricked_field);
+    assert(brick);
+    assert(node);
+    assert(spatial_offset);
+    assert(spatial_extent);
+
+    const Field* const field = bricked_field->field;
+
+    set_vector3f_elements(spatial_offset,
+                          brick->spatial_offset.a[0] + (float)node->offset[0]*field->voxel_width,
+                          brick->spatial_offset.a[1] + (float)node->offset[1]*field->voxel_height,
+                          brick->spatial_offset.a[2] + (float)node->offset[2]*field->voxel_depth);
+
+    set_vector3f_elements(spatial_extent,
+                          (float)node->size[0]*field->voxel_width,
+                          (float)node->size[1]*field->voxel_height,
+                          (float)node->size[2]*field->voxel_depth);
+}
+
+size_t find_bricks_in_value_range(const BrickedField* bricked_field, float lower_value, float upper_value, size_t* brick_indices)
+{
+    /*
+    Finds the bricks containing values in the given range of normalized values,
+    using the value limits of the brick tree nodes to skip whole branches. The
+    indices of the bricks are written to the given array if it is not NULL, and
+    the number of bricks found is returned.
+    */
+
+    check(bricked_field);
+    check(bricked_field->tree);
+
+    return find_brick_tree_nodes_in_value_range(bricked_field, 0, lower_value, upper_value, brick_indices, 0);
+}
+
+size_t find_sub_bricks_in_value_range(const Brick* brick, float lower_value, float upper_value, uint32_t* node_indices)
+{
+    /*
+    Like find_bricks_in_value_range, but finds the leaf nodes of the sub brick
+    tree of the given brick.
+    */
+
+    check(brick);
+    check(brick->tree);
+
+    return find_sub_brick_tree_nodes_in_value_range(brick, 0, lower_value, upper_value, node_indices, 0);
+}
+
 void draw_field_boundary_indicator(const BrickedField* bricked_field, unsigned int reference_corner_idx, enum indicator_drawing_pass pass)
 {
     assert(bricked_field);
@@ -438,7 +1053,7 @@ void draw_sub_brick_boundary_indicator(const BrickedField* bricked_field)
     glBindVertexArray(indicator->vertex_array_object_id);
     abort_on_GL_error("Could not bind VAO for drawing indicator");
 
-    draw_brick_boundaries(bricked_field->tree);
+    draw_brick_boundaries(bricked_field, 0);
 
     glBindVertexArray(0);
 
@@ -458,12 +1073,24 @@ void destroy_bricked_field(BrickedField* bricked_field)
     if (bricked_field->sub_brick_boundary_indicator_name)
         destroy_indicator(bricked_field->sub_brick_boundary_indicator_name);
 
-    destroy_brick_tree(bricked_field);
+    destroy_brick_trees(bricked_field);
+
+    if (bricked_field->lod_bricks)
+        free(bricked_field->lod_bricks);
+
+    // LOD brick data loaded from the cache is part of the cache mapping
+    if (bricked_field->lod_data && !bricked_field->cache_mapping)
+        free(bricked_field->lod_data);
 
     if (bricked_field->bricks)
     {
-        if (bricked_field->bricks[0].data)
-            free(bricked_field->bricks[0].data);
+        if (bricked_field->cache_mapping)
+            unmap_binary_file(bricked_field->cache_mapping, bricked_field->cache_mapping_size, 1);
+        else if (bricked_field->data)
+            free(bricked_field->data);
+
+        if (bricked_field->brick_storage_order)
+            free(bricked_field->brick_storage_order);
 
         free(bricked_field->bricks);
     }
@@ -476,7 +1103,8 @@ static void copy_subarray_with_cycled_layout(const float* full_input_array,
                                              size_t input_offset_x, size_t input_offset_y, size_t input_offset_z,
                                              float* output_array,
                                              size_t output_size_x, size_t output_size_y, size_t output_size_z,
-                                             unsigned int cycle)
+                                             unsigned int cycle,
+                                             float zero_value, float scale)
 {
     /*
     This function copies data from an input array to an output array.
@@ -488,6 +1116,10 @@ static void copy_subarray_with_cycled_layout(const float* full_input_array,
     in memory. A cycle of 0 keeps the original layout with the x-dimension
     varying fastest (zyx). Cycle 1 cycles this order once so y varies fastest
     (xzy) and cycle 2 cycles it twice so z varies fastest (yxz).
+
+    Each copied value is normalized as (value - zero_value)*scale, so that
+    normalization of the field does not require a separate pass over the
+    input array.
     */
 
     check(full_input_array);
@@ -496,283 +1128,2856 @@ static void copy_subarray_with_cycled_layout(const float* full_input_array,
     check(cycle < 3);
 
     const size_t input_offset = (input_offset_z*full_input_size_y + input_offset_y)*full_input_size_x + input_offset_x;
+    const size_t input_plane_size = full_input_size_x*full_input_size_y;
 
+    const float* input_row;
+    float* output_row;
     size_t i, j, k;
-    size_t input_idx, output_idx;
 
     if (cycle == 0)
     {
         for (k = 0; k < output_size_z; k++)
             for (j = 0; j < output_size_y; j++)
-                for (i = 0; i < output_size_x; i++)
-                {
-                    input_idx = input_offset + (k*full_input_size_y + j)*full_input_size_x + i;
-                    output_idx = (k*output_size_y + j)*output_size_x + i;
+            {
+                input_row = full_input_array + input_offset + k*input_plane_size + j*full_input_size_x;
+                output_row = output_array + (k*output_size_y + j)*output_size_x;
 
-                    output_array[output_idx] = full_input_array[input_idx];
-                }
+                for (i = 0; i < output_size_x; i++)
+                    output_row[i] = (input_row[i] - zero_value)*scale;
+            }
     }
     else if (cycle == 1)
     {
-        for (i = 0; i < output_size_x; i++)
-            for (k = 0; k < output_size_z; k++)
-                for (j = 0; j < output_size_y; j++)
-                {
-                    input_idx = input_offset + (k*full_input_size_y + j)*full_input_size_x + i;
-                    output_idx = (i*output_size_z + k)*output_size_y + j;
-
-                    output_array[output_idx] = full_input_array[input_idx];
-                }
+        // The xy-plane at each z is transposed so that y varies fastest in the output
+        for (k = 0; k < output_size_z; k++)
+            copy_transposed_plane(full_input_array + input_offset + k*input_plane_size, full_input_size_x,
+                                  output_array + k*output_size_y, output_size_z*output_size_y,
+                                  output_size_y, output_size_x,
+                                  zero_value, scale);
     }
     else
     {
+        // The xz-plane at each y is transposed so that z varies fastest in the output
         for (j = 0; j < output_size_y; j++)
-            for (i = 0; i < output_size_x; i++)
-                for (k = 0; k < output_size_z; k++)
-                {
-                    input_idx = input_offset + (k*full_input_size_y + j)*full_input_size_x + i;
-                    output_idx = (j*output_size_x + i)*output_size_z + k;
-
-                    output_array[output_idx] = full_input_array[input_idx];
-                }
+            copy_transposed_plane(full_input_array + input_offset + j*full_input_size_x, input_plane_size,
+                                  output_array + j*output_size_x*output_size_z, output_size_z,
+                                  output_size_z, output_size_x,
+                                  zero_value, scale);
     }
 }
 
-static void create_brick_tree(BrickedField* bricked_field)
+static void copy_transposed_plane(const float* input_plane, size_t input_row_stride,
+                                  float* output_plane, size_t output_row_stride,
+                                  size_t n_rows, size_t n_columns,
+                                  float zero_value, float scale)
 {
-    assert(bricked_field);
+    /*
+    Writes the normalized transpose of a 2D input array with the given number
+    of rows and columns to a 2D output array. Rows of both arrays are separated
+    by the given strides. Blocks of 8x8 (AVX) or 4x4 (SSE) values are
+    transposed in registers, so that both arrays are accessed in contiguous
+    runs rather than one of them element by element with a large stride.
+    */
 
-    const NodeIndices start_indices = {{0, 0, 0}};
-    const NodeIndices end_indices = {{bricked_field->n_bricks_x, bricked_field->n_bricks_y, bricked_field->n_bricks_z}};
+    assert(input_plane);
+    assert(output_plane);
 
-    bricked_field->tree = create_brick_tree_nodes(bricked_field, 0, start_indices, end_indices);
-    check(bricked_field->tree);
-}
+    size_t row_idx = 0;
+    size_t column_idx;
+    size_t block_row_idx;
 
-static BrickTreeNode* create_brick_tree_nodes(BrickedField* bricked_field, unsigned int level,
-                                              NodeIndices start_indices, NodeIndices end_indices)
-{
-    assert(bricked_field);
+#if defined(__AVX__)
 
-    unsigned int axis = level % 3;
+    const __m256 zero_values = _mm256_set1_ps(zero_value);
+    const __m256 scales = _mm256_set1_ps(scale);
 
-    // Advance the level until a divisible axis is found or return a leaf node if none is found
-    if (end_indices.idx[axis] - start_indices.idx[axis] == 1)
-    {
-        level++;
-        axis = level % 3;
+    __m256 rows[8];
+    __m256 pairs[8];
+    __m256 quads[8];
 
-        if (end_indices.idx[axis] - start_indices.idx[axis] == 1)
+    for (; row_idx + 8 <= n_rows; row_idx += 8)
+    {
+        for (column_idx = 0; column_idx + 8 <= n_columns; column_idx += 8)
         {
-            level++;
-            axis = level % 3;
-
-            if (end_indices.idx[axis] - start_indices.idx[axis] == 1)
+            for (block_row_idx = 0; block_row_idx < 8; block_row_idx++)
+                rows[block_row_idx] = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(input_plane + (row_idx + block_row_idx)*input_row_stride + column_idx),
+                                                                  zero_values),
+                                                    scales);
+
+            pairs[0] = _mm256_unpacklo_ps(rows[0], rows[1]);
+            pairs[1] = _mm256_unpackhi_ps(rows[0], rows[1]);
+            pairs[2] = _mm256_unpacklo_ps(rows[2], rows[3]);
+            pairs[3] = _mm256_unpackhi_ps(rows[2], rows[3]);
+            pairs[4] = _mm256_unpacklo_ps(rows[4], rows[5]);
+            pairs[5] = _mm256_unpackhi_ps(rows[4], rows[5]);
+            pairs[6] = _mm256_unpacklo_ps(rows[6], rows[7]);
+            pairs[7] = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+            quads[0] = _mm256_shuffle_ps(pairs[0], pairs[2], _MM_SHUFFLE(1, 0, 1, 0));
+            quads[1] = _mm256_shuffle_ps(pairs[0], pairs[2], _MM_SHUFFLE(3, 2, 3, 2));
+            quads[2] = _mm256_shuffle_ps(pairs[1], pairs[3], _MM_SHUFFLE(1, 0, 1, 0));
+            quads[3] = _mm256_shuffle_ps(pairs[1], pairs[3], _MM_SHUFFLE(3, 2, 3, 2));
+            quads[4] = _mm256_shuffle_ps(pairs[4], pairs[6], _MM_SHUFFLE(1, 0, 1, 0));
+            quads[5] = _mm256_shuffle_ps(pairs[4], pairs[6], _MM_SHUFFLE(3, 2, 3, 2));
+            quads[6] = _mm256_shuffle_ps(pairs[5], pairs[7], _MM_SHUFFLE(1, 0, 1, 0));
+            quads[7] = _mm256_shuffle_ps(pairs[5], pairs[7], _MM_SHUFFLE(3, 2, 3, 2));
+
+            // Each output row combines the lower or upper 128-bit lanes of two quads
+            for (block_row_idx = 0; block_row_idx < 4; block_row_idx++)
             {
-                return create_brick_tree_leaf_node(bricked_field, start_indices);
+                _mm256_storeu_ps(output_plane + (column_idx + block_row_idx)*output_row_stride + row_idx,
+                                 _mm256_permute2f128_ps(quads[block_row_idx], quads[block_row_idx + 4], 0x20));
+
+                _mm256_storeu_ps(output_plane + (column_idx + block_row_idx + 4)*output_row_stride + row_idx,
+                                 _mm256_permute2f128_ps(quads[block_row_idx], quads[block_row_idx + 4], 0x31));
             }
         }
+
+        for (; column_idx < n_columns; column_idx++)
+            for (block_row_idx = row_idx; block_row_idx < row_idx + 8; block_row_idx++)
+                output_plane[column_idx*output_row_stride + block_row_idx] = (input_plane[block_row_idx*input_row_stride + column_idx] - zero_value)*scale;
     }
 
-    BrickTreeNode* node = (BrickTreeNode*)malloc(sizeof(BrickTreeNode));
-    node->brick = NULL;
-    node->visibility_ratio = 1.0f;
-    node->visibility = UNDETERMINED_REGION_VISIBILITY;
+#elif defined(__SSE__)
 
-    node->split_axis = axis;
+    const __m128 zero_values = _mm_set1_ps(zero_value);
+    const __m128 scales = _mm_set1_ps(scale);
 
-    // Subdivide along the current axis as close to the middle as possible
-    const size_t middle_idx = (size_t)(0.5f*(float)(start_indices.idx[axis] + end_indices.idx[axis] + 1));
-    assert(middle_idx > start_indices.idx[axis] && end_indices.idx[axis] > middle_idx);
+    __m128 rows[4];
 
-    // Create child node for the lower interval
-    NodeIndices new_end_indices = end_indices;
-    new_end_indices.idx[axis] = middle_idx;
-    node->lower_child = create_brick_tree_nodes(bricked_field, level + 1, start_indices, new_end_indices);
+    for (; row_idx + 4 <= n_rows; row_idx += 4)
+    {
+        for (column_idx = 0; column_idx + 4 <= n_columns; column_idx += 4)
+        {
+            for (block_row_idx = 0; block_row_idx < 4; block_row_idx++)
+                rows[block_row_idx] = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(input_plane + (row_idx + block_row_idx)*input_row_stride + column_idx),
+                                                            zero_values),
+                                                 scales);
 
-    // Create child node for the upper interval
-    NodeIndices new_start_indices = start_indices;
-    new_start_indices.idx[axis] = middle_idx;
-    node->upper_child = create_brick_tree_nodes(bricked_field, level + 1, new_start_indices, end_indices);
+            _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
 
-    // The spatial offset of the node along the split axis is the minimum of the children's offset along that axis.
-    // The other components of the offset are equal for both children and also the same for this node.
-    node->spatial_offset = node->lower_child->spatial_offset;
-    node->spatial_offset.a[axis] = fminf(node->lower_child->spatial_offset.a[axis], node->upper_child->spatial_offset.a[axis]);
+            for (block_row_idx = 0; block_row_idx < 4; block_row_idx++)
+                _mm_storeu_ps(output_plane + (column_idx + block_row_idx)*output_row_stride + row_idx, rows[block_row_idx]);
+        }
 
-    // The spatial extent of the node along the split axis is the sum of the children's extent along that axis.
-    // The other components of the extent are equal for both children and also the same for this node.
-    node->spatial_extent = node->lower_child->spatial_extent;
-    node->spatial_extent.a[axis] += node->upper_child->spatial_extent.a[axis];
+        for (; column_idx < n_columns; column_idx++)
+            for (block_row_idx = row_idx; block_row_idx < row_idx + 4; block_row_idx++)
+                output_plane[column_idx*output_row_stride + block_row_idx] = (input_plane[block_row_idx*input_row_stride + column_idx] - zero_value)*scale;
+    }
 
-    node->n_children = 2 + node->lower_child->n_children + node->upper_child->n_children;
+#endif
 
-    return node;
+    // The rows not covered by whole blocks are copied one value at a time
+    for (; row_idx < n_rows; row_idx++)
+        for (column_idx = 0; column_idx < n_columns; column_idx++)
+            output_plane[column_idx*output_row_stride + row_idx] = (input_plane[row_idx*input_row_stride + column_idx] - zero_value)*scale;
 }
 
-static BrickTreeNode* create_brick_tree_leaf_node(BrickedField* bricked_field, NodeIndices indices)
+static void convert_values(const float* values, void* converted_values, size_t n_values, enum brick_data_type data_type)
 {
-    assert(bricked_field);
+    /*
+    Converts normalized values to the given storage type. For the integer
+    types, [0, 1] is mapped onto the full range of the type with rounding to
+    the nearest integer, and values outside [0, 1] are clamped. Half precision
+    values are rounded to nearest, using the F16C instructions when available.
+    */
 
-    BrickTreeNode* node = (BrickTreeNode*)malloc(sizeof(BrickTreeNode));
-    node->lower_child = NULL;
-    node->upper_child = NULL;
-    node->n_children = 0;
-    node->visibility_ratio = 1.0f;
-    node->visibility = UNDETERMINED_REGION_VISIBILITY;
+    assert(values);
+    assert(converted_values);
 
-    node->brick = bricked_field->bricks + (indices.idx[2]*bricked_field->n_bricks_y + indices.idx[1])*bricked_field->n_bricks_x + indices.idx[0];
+    size_t idx = 0;
 
-    node->spatial_offset = node->brick->spatial_offset;
-    node->spatial_extent = node->brick->spatial_extent;
+    if (data_type == BRICK_DATA_FLOAT16)
+    {
+        uint16_t* const output = (uint16_t*)converted_values;
 
-    create_sub_brick_tree(node->brick, bricked_field->field);
+#if defined(__F16C__)
+        for (; idx + 8 <= n_values; idx += 8)
+            _mm_storeu_si128((__m128i*)(output + idx), _mm256_cvtps_ph(_mm256_loadu_ps(values + idx), _MM_FROUND_TO_NEAREST_INT));
+#endif
+
+        for (; idx < n_values; idx++)
+            output[idx] = float_to_half(values[idx]);
+    }
+    else if (data_type == BRICK_DATA_UINT16)
+    {
+        uint16_t* const output = (uint16_t*)converted_values;
+
+        for (idx = 0; idx < n_values; idx++)
+            output[idx] = (uint16_t)(fminf(fmaxf(values[idx], 0.0f), 1.0f)*(float)UINT16_MAX + 0.5f);
+    }
+    else
+    {
+        assert(data_type == BRICK_DATA_UINT8);
+
+        uint8_t* const output = (uint8_t*)converted_values;
+
+        for (idx = 0; idx < n_values; idx++)
+            output[idx] = (uint8_t)(fminf(fmaxf(values[idx], 0.0f), 1.0f)*(float)UINT8_MAX + 0.5f);
+    }
+}
+
+static void fill_bricks(const BrickedField* bricked_field, const float* source_data, size_t source_offset_z,
+                        size_t first_brick_idx, size_t n_bricks)
+{
+    /*
+    Copies the normalized values for the given range of bricks from the source
+    array, which holds the field values from the given z-index onwards. Each
+    brick covers a disjoint part of the brick data array, so the bricks are
+    filled concurrently.
+
+    Bricks with a data type other than 32-bit float are first filled with float
+    values in a scratch array belonging to the filling thread, and then
+    converted from there into the brick data array.
+    */
+
+    assert(bricked_field);
+    assert(source_data);
+
+    // No more threads than bricks are used, so no more scratch arrays are needed either
+    const unsigned int n_threads = (unsigned int)min_size_t(get_worker_thread_count(), n_bricks);
+
+    BrickFilling brick_filling;
+    brick_filling.bricked_field = bricked_field;
+    brick_filling.source_data = source_data;
+    brick_filling.source_offset_z = source_offset_z;
+    brick_filling.first_brick_idx = first_brick_idx;
+    brick_filling.scratch_arrays = NULL;
+
+    const size_t padded_brick_size = bricked_field->brick_size + 2*bricked_field->pad_size;
+    const size_t scratch_array_length = padded_brick_size*padded_brick_size*padded_brick_size;
+    unsigned int thread_idx;
+
+    if (bricked_field->data_type != BRICK_DATA_FLOAT32)
+    {
+        brick_filling.scratch_arrays = (float**)malloc(sizeof(float*)*n_threads);
+        check(brick_filling.scratch_arrays);
+
+        for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+        {
+            brick_filling.scratch_arrays[thread_idx] = (float*)malloc(sizeof(float)*scratch_array_length);
+            check(brick_filling.scratch_arrays[thread_idx]);
+        }
+    }
+
+    run_parallel_tasks(fill_brick, &brick_filling, n_bricks, n_threads);
+
+    if (brick_filling.scratch_arrays)
+    {
+        for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+            free(brick_filling.scratch_arrays[thread_idx]);
+
+        free(brick_filling.scratch_arrays);
+    }
+}
+
+static void fill_brick(void* shared_data, size_t task_idx, unsigned int thread_idx)
+{
+    const BrickFilling* const brick_filling = (const BrickFilling*)shared_data;
+    assert(brick_filling);
+
+    const BrickedField* const bricked_field = brick_filling->bricked_field;
+    const Field* const field = bricked_field->field;
+    Brick* const brick = bricked_field->bricks + brick_filling->first_brick_idx + task_idx;
+
+    const unsigned int* const permutation = brick_axis_permutations[brick->orientation];
+    const size_t pad_size = bricked_field->pad_size;
+
+    float* const values = brick_filling->scratch_arrays ? brick_filling->scratch_arrays[thread_idx] : (float*)brick->data;
+
+    // The padded brick covers the field from pad_size voxels before the brick offset along every axis
+    copy_subarray_with_cycled_layout(brick_filling->source_data,
+                                     field->size_x, field->size_y,
+                                     brick->offset_x - pad_size,
+                                     brick->offset_y - pad_size,
+                                     brick->offset_z - pad_size - brick_filling->source_offset_z,
+                                     values,
+                                     brick->padded_size[permutation[0]], brick->padded_size[permutation[1]], brick->padded_size[permutation[2]],
+                                     (unsigned int)brick->orientation,
+                                     field->normalization_offset, field->normalization_scale);
+
+    if (brick_filling->scratch_arrays)
+        convert_values(values, brick->data, brick->padded_size[0]*brick->padded_size[1]*brick->padded_size[2], bricked_field->data_type);
+
+    create_sub_brick_tree(bricked_field, brick);
+
+    // The padded brick can only be constant if its interior is, which the value limits of the tree root tell cheaply
+    if (brick->tree[0].max_value - brick->tree[0].min_value <= bricked_field->constant_brick_tolerance)
+        detect_constant_brick(bricked_field, brick);
+
+    create_sub_brick_histograms(bricked_field, brick);
+}
+
+static void detect_constant_brick(const BrickedField* bricked_field, Brick* brick)
+{
+    /*
+    Marks the brick as constant if the range of its stored values, including
+    the padding, does not exceed the constant brick tolerance. A constant brick
+    is represented by the value in the middle of the range, which then also
+    becomes the value limits of all its sub bricks. Its data is kept until the
+    bricks are compacted.
+    */
+
+    assert(bricked_field);
+    assert(brick);
+
+    // The padded brick data is contiguous, so it can be scanned as a single row
+    const size_t n_values = brick->padded_size[0]*brick->padded_size[1]*brick->padded_size[2];
+
+    float min_value = INFINITY;
+    float max_value = -INFINITY;
+
+    if (bricked_field->data_type == BRICK_DATA_FLOAT32)
+    {
+        const size_t sizes[3] = {n_values, 1, 1};
+        const size_t strides[3] = {1, n_values, n_values};
+        find_float_region_limits((const float*)brick->data, sizes, strides, &min_value, &max_value);
+    }
+    else
+    {
+        update_value_limits_for_row(bricked_field, brick, 0, n_values, &min_value, &max_value);
+    }
+
+    if (max_value - min_value <= bricked_field->constant_brick_tolerance)
+    {
+        brick->is_constant = 1;
+        brick->constant_value = 0.5f*(min_value + max_value);
+
+        size_t node_idx;
+        for (node_idx = 0; node_idx < brick->n_tree_nodes; node_idx++)
+        {
+            brick->tree[node_idx].min_value = brick->constant_value;
+            brick->tree[node_idx].max_value = brick->constant_value;
+        }
+    }
+}
+
+static void compact_brick_data(BrickedField* bricked_field)
+{
+    /*
+    Removes the data of the constant bricks from the data array by moving the
+    data of the remaining bricks towards the start of the array, which is then
+    shrunk to fit. The data of constant bricks is set to NULL.
+    */
+
+    assert(bricked_field);
+    assert(!bricked_field->cache_mapping);
+
+    const size_t data_type_size = get_brick_data_type_size(bricked_field->data_type);
+
+    size_t brick_idx;
+    size_t data_offset = 0;
+    size_t n_values;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+    {
+        Brick* const brick = bricked_field->bricks + bricked_field->brick_storage_order[brick_idx];
+
+        if (brick->is_constant)
+        {
+            brick->data = NULL;
+            continue;
+        }
+
+        n_values = brick->padded_size[0]*brick->padded_size[1]*brick->padded_size[2];
+
+        // Bricks are visited in storage order, so the destination never lies after the source
+        char* const destination = (char*)bricked_field->data + data_type_size*data_offset;
+        if (destination != brick->data)
+            memmove(destination, brick->data, data_type_size*n_values);
+
+        brick->data = destination;
+        data_offset += n_values;
+    }
+
+    if (data_offset == bricked_field->data_length)
+        return;
+
+    if (data_offset == 0)
+    {
+        free(bricked_field->data);
+        bricked_field->data = NULL;
+    }
+    else
+    {
+        // Shrinking an allocation does not move it with common allocators, but the brick pointers are updated in case it does
+        void* const data = realloc(bricked_field->data, data_type_size*data_offset);
+        check(data);
+
+        if (data != bricked_field->data)
+        {
+            for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+            {
+                Brick* const brick = bricked_field->bricks + brick_idx;
+                if (brick->data)
+                    brick->data = (char*)data + ((char*)brick->data - (char*)bricked_field->data);
+            }
+        }
+
+        bricked_field->data = data;
+    }
+
+    print_info_message("Eliminated %.1f%% of the brick data as constant.",
+                       100.0*(double)(bricked_field->data_length - data_offset)/(double)bricked_field->data_length);
+
+    bricked_field->data_length = data_offset;
+}
+
+static void fill_bricks_from_streamed_slabs(const BrickedField* bricked_field, const BrickedField* source_bricked_field)
+{
+    /*
+    Fills the bricks one layer at a time from slabs of the source file of the
+    field, or of the source bricked field if it is not NULL. The slab for the
+    next layer is read on a background thread while the bricks of the current
+    layer are being filled, so that no more than two slabs are held in memory
+    at once.
+    */
+
+    assert(bricked_field);
+
+    const size_t n_bricks_per_layer = bricked_field->n_bricks_x*bricked_field->n_bricks_y;
+
+    SlabRead slab_reads[2];
+    BackgroundThread slab_reading_thread;
+    reset_background_thread(&slab_reading_thread);
+
+    start_reading_brick_layer_slab(bricked_field, source_bricked_field, 0, slab_reads, &slab_reading_thread);
+
+    size_t layer_idx;
+
+    for (layer_idx = 0; layer_idx < bricked_field->n_bricks_z; layer_idx++)
+    {
+        join_background_thread(&slab_reading_thread);
+
+        SlabRead* const slab_read = slab_reads + (layer_idx % 2);
+
+        if (!slab_read->slab)
+            print_severe_message("Could not read field data for brick layer %d.", layer_idx);
+
+        if (layer_idx + 1 < bricked_field->n_bricks_z)
+            start_reading_brick_layer_slab(bricked_field, source_bricked_field, layer_idx + 1, slab_reads + ((layer_idx + 1) % 2), &slab_reading_thread);
+
+        fill_bricks(bricked_field, slab_read->slab, slab_read->start_z, layer_idx*n_bricks_per_layer, n_bricks_per_layer);
+
+        free(slab_read->slab);
+        slab_read->slab = NULL;
+    }
+}
+
+static void start_reading_brick_layer_slab(const BrickedField* bricked_field, const BrickedField* source_bricked_field, size_t layer_idx,
+                                           SlabRead* slab_read, BackgroundThread* slab_reading_thread)
+{
+    /*
+    Starts reading the slab of field values covered by the given layer of
+    bricks, including the padding at its interior boundaries.
+    */
+
+    assert(bricked_field);
+    assert(slab_read);
+    assert(slab_reading_thread);
+
+    const size_t brick_size = bricked_field->brick_size;
+    const size_t pad_size = bricked_field->pad_size;
+    const size_t n_layers = bricked_field->n_bricks_z;
+    const size_t field_size_z = bricked_field->field->size_z;
+
+    const size_t unpadded_start_z = layer_idx*brick_size;
+
+    slab_read->field = bricked_field->field;
+    slab_read->source_bricked_field = source_bricked_field;
+    slab_read->start_z = unpadded_start_z - (layer_idx > 0)*pad_size;
+    slab_read->end_z = unpadded_start_z + min_size_t(brick_size, field_size_z - unpadded_start_z) + (layer_idx < n_layers - 1)*pad_size;
+    slab_read->slab = NULL;
+
+    start_background_thread(slab_reading_thread, read_slab_in_background, slab_read);
+}
+
+static void read_slab_in_background(void* slab_read_ptr)
+{
+    SlabRead* const slab_read = (SlabRead*)slab_read_ptr;
+    assert(slab_read);
+
+    if (slab_read->source_bricked_field)
+        slab_read->slab = read_bricked_field_slab(slab_read->source_bricked_field, slab_read->start_z, slab_read->end_z);
+    else
+        slab_read->slab = read_field_slab(slab_read->field, slab_read->start_z, slab_read->end_z);
+}
+
+static int create_brick_cache_header(const BrickedField* bricked_field, size_t data_length, BrickCacheHeader* header)
+{
+    /*
+    Fills in the cache header that identifies the bricked data for the field
+    of the given bricked field with the configuration it is built with. Only the source
+    file and the configuration are needed, so the header can be created before
+    the field data has been loaded. Returns 0 if the source file of the field
+    could not be examined.
+    */
+
+    assert(bricked_field);
+    assert(header);
+
+    const Field* const field = bricked_field->field;
+    assert(field);
+    assert(field->source_filename.chars);
+
+    size_t source_size;
+    int64_t source_modification_time;
+
+    if (!get_file_size_and_modification_time(field->source_filename.chars, &source_size, &source_modification_time))
+        return 0;
+
+    char* const source_path = realpath(field->source_filename.chars, NULL);
+
+    if (!source_path)
+        return 0;
+
+    const size_t source_path_length = strlen(source_path);
+
+    // Clear any padding bytes so that headers can be compared byte by byte
+    memset(header, 0, sizeof(BrickCacheHeader));
+
+    if (source_path_length < sizeof(header->source_path))
+        memcpy(header->source_path, source_path, source_path_length);
+
+    free(source_path);
+
+    if (source_path_length >= sizeof(header->source_path))
+        return 0;
+
+    memcpy(header->magic, "VTBRICKS", sizeof(header->magic));
+    header->version = BRICK_CACHE_VERSION;
+    header->byte_order_mark = BRICK_CACHE_BYTE_ORDER_MARK;
+    header->source_size = (uint64_t)source_size;
+    header->source_modification_time = source_modification_time;
+    header->source_element_size = (uint32_t)field->source_element_size;
+    header->source_byte_order_is_swapped = (uint8_t)field->source_byte_order_is_swapped;
+    header->source_is_column_major = (uint8_t)field->source_is_column_major;
+    header->field_size[0] = (uint64_t)field->size_x;
+    header->field_size[1] = (uint64_t)field->size_y;
+    header->field_size[2] = (uint64_t)field->size_z;
+    header->field_half_extent[0] = field->halfwidth;
+    header->field_half_extent[1] = field->halfheight;
+    header->field_half_extent[2] = field->halfdepth;
+    header->brick_size = (uint64_t)bricked_field->brick_size;
+    header->pad_size = (uint32_t)bricked_field->pad_size;
+    header->data_type = (uint32_t)bricked_field->data_type;
+    header->constant_brick_tolerance = bricked_field->constant_brick_tolerance;
+    header->sub_brick_size_limit = (uint32_t)bricked_field->sub_brick_size_limit;
+    header->uses_adaptive_sub_brick_splits = (uint32_t)bricked_field->uses_adaptive_sub_brick_splits;
+    header->creates_lod_bricks = (uint32_t)bricked_field->creates_lod_bricks;
+    header->data_length = (uint64_t)data_length;
+
+    return 1;
+}
+
+static void find_brick_cache_layout(const BrickedField* bricked_field, const BrickCacheContents* contents, BrickCacheLayout* layout)
+{
+    /*
+    Determines where each section of the cache for the given bricked field
+    with the given contents starts. The header and contents share the first
+    page, and are followed by the table of constant brick values, the trees,
+    the value histograms and the LOD bricks, which are copied out of the cache
+    when it is loaded.
+    The data of the non-constant bricks and of the LOD bricks, which is used
+    directly from the mapping, starts on the pages after them.
+    */
+
+    assert(bricked_field);
+    assert(contents);
+    assert(layout);
+    assert(sizeof(BrickCacheHeader) + sizeof(BrickCacheContents) <= BRICK_CACHE_PAGE_SIZE);
+
+    const size_t n_bricks = bricked_field->n_bricks;
+    const size_t n_tree_nodes = get_brick_tree_node_count(n_bricks);
+    const size_t n_sub_brick_tree_nodes = (size_t)contents->n_sub_brick_tree_nodes;
+    const size_t data_type_size = get_brick_data_type_size(bricked_field->data_type);
+
+    // The constant brick table starts right after the first page
+    layout->constant_values_offset = BRICK_CACHE_PAGE_SIZE;
+
+    layout->sub_brick_tree_node_counts_offset = align_brick_cache_offset(layout->constant_values_offset + sizeof(float)*n_bricks,
+                                                                         BRICK_CACHE_SECTION_ALIGNMENT);
+
+    layout->sub_brick_tree_nodes_offset = align_brick_cache_offset(layout->sub_brick_tree_node_counts_offset + sizeof(uint32_t)*n_bricks,
+                                                                   BRICK_CACHE_SECTION_ALIGNMENT);
+
+    layout->histogram_starts_offset = align_brick_cache_offset(layout->sub_brick_tree_nodes_offset + sizeof(SubBrickTreeNode)*n_sub_brick_tree_nodes,
+                                                               BRICK_CACHE_SECTION_ALIGNMENT);
+
+    layout->histogram_entries_offset = align_brick_cache_offset(layout->histogram_starts_offset + sizeof(uint32_t)*(n_sub_brick_tree_nodes + 1),
+                                                                BRICK_CACHE_SECTION_ALIGNMENT);
+
+    layout->tree_nodes_offset = align_brick_cache_offset(layout->histogram_entries_offset + sizeof(ValueHistogramEntry)*(size_t)contents->n_histogram_entries,
+                                                         BRICK_CACHE_SECTION_ALIGNMENT);
+
+    layout->tree_lod_brick_indices_offset = align_brick_cache_offset(layout->tree_nodes_offset + sizeof(BrickTreeNode)*n_tree_nodes,
+                                                                     BRICK_CACHE_SECTION_ALIGNMENT);
+
+    layout->lod_bricks_offset = align_brick_cache_offset(layout->tree_lod_brick_indices_offset + sizeof(uint32_t)*n_tree_nodes,
+                                                         BRICK_CACHE_SECTION_ALIGNMENT);
+
+    layout->data_offset = align_brick_cache_offset(layout->lod_bricks_offset + sizeof(LODBrick)*(size_t)contents->n_lod_bricks,
+                                                   BRICK_CACHE_PAGE_SIZE);
+
+    layout->lod_data_offset = align_brick_cache_offset(layout->data_offset + data_type_size*(size_t)contents->stored_data_length,
+                                                       BRICK_CACHE_PAGE_SIZE);
+
+    layout->size = layout->lod_data_offset + data_type_size*(size_t)contents->lod_data_length;
+}
+
+static size_t align_brick_cache_offset(size_t offset, size_t alignment)
+{
+    return ((offset + alignment - 1)/alignment)*alignment;
+}
+
+static int load_cached_bricked_field(BrickedField* bricked_field, size_t data_length)
+{
+    /*
+    Loads the bricks, the brick trees, the value histograms and the LOD bricks
+    of the bricked field from its cache if a cache file exists, matches the
+    source file of the field and the current configuration, and holds trees
+    and histograms that are consistent with the bricks. The data of the
+    non-constant bricks and of the LOD bricks is used directly from the mapped
+    cache, while the trees and histograms are copied out of it, since the
+    mapping is read-only. Constant bricks are restored from the
+    table of constant values. The value limits of the field are taken from
+    the cache, so the field data is never needed. Returns 0 if no valid cache
+    was found.
+    */
+
+    assert(bricked_field);
+
+    Field* const field = bricked_field->field;
+    assert(field);
+
+    BrickCacheHeader expected_header;
+
+    if (!create_brick_cache_header(bricked_field, data_length, &expected_header))
+        return 0;
+
+    DynamicString cache_filename = create_string("%s.bricks", field->source_filename.chars);
+
+    const size_t n_bricks = bricked_field->n_bricks;
+    const size_t n_tree_nodes = get_brick_tree_node_count(n_bricks);
+    const size_t data_type_size = get_brick_data_type_size(bricked_field->data_type);
+
+    size_t cache_size;
+    int64_t cache_modification_time;
+    int is_valid = 0;
+
+    if (get_file_size_and_modification_time(cache_filename.chars, &cache_size, &cache_modification_time) &&
+        cache_size >= BRICK_CACHE_PAGE_SIZE)
+    {
+        char* const mapping = (char*)map_binary_file(cache_filename.chars, cache_size, 1);
+
+        if (mapping && memcmp(mapping, &expected_header, sizeof(BrickCacheHeader)) == 0)
+        {
+            BrickCacheContents contents;
+            memcpy(&contents, mapping + sizeof(BrickCacheHeader), sizeof(BrickCacheContents));
+
+            BrickCacheLayout layout;
+
+            // The section sizes are checked before the layout is computed from them, so that it cannot overflow
+            if (contents.n_sub_brick_tree_nodes <= cache_size/sizeof(SubBrickTreeNode) &&
+                contents.n_histogram_entries <= cache_size/sizeof(ValueHistogramEntry) &&
+                contents.n_lod_bricks <= cache_size/sizeof(LODBrick) &&
+                contents.stored_data_length <= cache_size/data_type_size &&
+                contents.lod_data_length <= cache_size/data_type_size)
+            {
+                find_brick_cache_layout(bricked_field, &contents, &layout);
+                is_valid = cache_size == layout.size;
+            }
+
+            const float* constant_values = NULL;
+            const uint32_t* node_counts = NULL;
+            const SubBrickTreeNode* sub_brick_tree_nodes = NULL;
+            const uint32_t* histogram_starts = NULL;
+            const BrickTreeNode* tree_nodes = NULL;
+            const uint32_t* tree_lod_brick_indices = NULL;
+            const LODBrick* lod_bricks = NULL;
+
+            size_t brick_idx;
+            size_t node_idx;
+            size_t stored_data_length = 0;
+            size_t n_sub_brick_tree_nodes = 0;
+
+            if (is_valid)
+            {
+                constant_values = (const float*)(mapping + layout.constant_values_offset);
+                node_counts = (const uint32_t*)(mapping + layout.sub_brick_tree_node_counts_offset);
+                sub_brick_tree_nodes = (const SubBrickTreeNode*)(mapping + layout.sub_brick_tree_nodes_offset);
+                histogram_starts = (const uint32_t*)(mapping + layout.histogram_starts_offset);
+                tree_nodes = (const BrickTreeNode*)(mapping + layout.tree_nodes_offset);
+                tree_lod_brick_indices = (const uint32_t*)(mapping + layout.tree_lod_brick_indices_offset);
+                lod_bricks = (const LODBrick*)(mapping + layout.lod_bricks_offset);
+
+                for (brick_idx = 0; brick_idx < n_bricks; brick_idx++)
+                {
+                    const Brick* const brick = bricked_field->bricks + brick_idx;
+
+                    if (constant_values[brick_idx] == NON_CONSTANT_BRICK_MARKER)
+                        stored_data_length += brick->padded_size[0]*brick->padded_size[1]*brick->padded_size[2];
+
+                    n_sub_brick_tree_nodes += node_counts[brick_idx];
+                }
+
+                is_valid = contents.stored_data_length == (uint64_t)stored_data_length &&
+                           contents.n_sub_brick_tree_nodes == (uint64_t)n_sub_brick_tree_nodes &&
+                           (uint64_t)histogram_starts[n_sub_brick_tree_nodes] == contents.n_histogram_entries;
+
+                // The entries of a node end where those of the next node start, so the starts must not decrease
+                for (node_idx = 0; is_valid && node_idx < n_sub_brick_tree_nodes; node_idx++)
+                    is_valid = histogram_starts[node_idx] <= histogram_starts[node_idx + 1];
+
+                // The cached LOD bricks must hold exactly the cached LOD data. No LOD brick is larger than the field,
+                // which also keeps their lengths from overflowing.
+                size_t lod_data_length = 0;
+                size_t lod_brick_idx;
+
+                for (lod_brick_idx = 0; is_valid && lod_brick_idx < (size_t)contents.n_lod_bricks; lod_brick_idx++)
+                {
+                    const LODBrick* const lod_brick = lod_bricks + lod_brick_idx;
+
+                    is_valid = lod_brick->padded_size[0] <= field->size_x &&
+                               lod_brick->padded_size[1] <= field->size_y &&
+                               lod_brick->padded_size[2] <= field->size_z;
+
+                    lod_data_length += get_lod_brick_data_length(lod_brick);
+                }
+
+                is_valid = is_valid && contents.lod_data_length == (uint64_t)lod_data_length;
+            }
+
+            // The trees are traversed by following the stored child indices, so they must lead to later
+            // nodes of the same tree. Likewise, the bricks, sub bricks and LOD bricks they refer to must exist.
+            for (node_idx = 0; is_valid && node_idx < n_tree_nodes; node_idx++)
+            {
+                const BrickTreeNode* const node = tree_nodes + node_idx;
+
+                if (node->upper_child_idx == 0)
+                    is_valid = (size_t)node->brick_idx < n_bricks;
+                else
+                    is_valid = node_idx + 1 < (size_t)node->upper_child_idx && (size_t)node->upper_child_idx < n_tree_nodes &&
+                               node->split_axis < 3;
+
+                is_valid = is_valid && (tree_lod_brick_indices[node_idx] == NO_LOD_BRICK ||
+                                        (uint64_t)tree_lod_brick_indices[node_idx] < contents.n_lod_bricks);
+            }
+
+            // The sub brick trees, like their node counts, follow the storage order of the bricks
+            const SubBrickTreeNode* brick_tree_nodes = sub_brick_tree_nodes;
+
+            for (brick_idx = 0; is_valid && brick_idx < n_bricks; brick_idx++)
+            {
+                const Brick* const brick = bricked_field->bricks + bricked_field->brick_storage_order[brick_idx];
+                const size_t brick_size[3] = {brick->size_x, brick->size_y, brick->size_z};
+                const size_t n_nodes = (size_t)node_counts[brick_idx];
+
+                is_valid = n_nodes > 0;
+
+                for (node_idx = 0; is_valid && node_idx < n_nodes; node_idx++)
+                {
+                    const SubBrickTreeNode* const node = brick_tree_nodes + node_idx;
+
+                    unsigned int dim;
+
+                    for (dim = 0; is_valid && dim < 3; dim++)
+                        is_valid = (size_t)node->offset[dim] + (size_t)node->size[dim] <= brick_size[dim];
+
+                    if (is_valid && node->upper_child_idx != 0)
+                        is_valid = node_idx + 1 < (size_t)node->upper_child_idx && (size_t)node->upper_child_idx < n_nodes &&
+                                   node->split_axis < 3;
+                }
+
+                brick_tree_nodes += n_nodes;
+            }
+
+            if (is_valid)
+            {
+                char* const data = (stored_data_length > 0) ? mapping + layout.data_offset : NULL;
+                size_t data_offset = 0;
+
+                // The data of the non-constant bricks and the sub brick trees are stored in the storage order of the bricks
+                for (brick_idx = 0; brick_idx < n_bricks; brick_idx++)
+                {
+                    const size_t stored_brick_idx = bricked_field->brick_storage_order[brick_idx];
+                    Brick* const brick = bricked_field->bricks + stored_brick_idx;
+
+                    if (constant_values[stored_brick_idx] == NON_CONSTANT_BRICK_MARKER)
+                    {
+                        brick->data = data + data_type_size*data_offset;
+                        data_offset += brick->padded_size[0]*brick->padded_size[1]*brick->padded_size[2];
+                    }
+                    else
+                    {
+                        brick->data = NULL;
+                        brick->is_constant = 1;
+                        brick->constant_value = constant_values[stored_brick_idx];
+                    }
+
+                    brick->n_tree_nodes = (size_t)node_counts[brick_idx];
+                }
+
+                bricked_field->data = data;
+                bricked_field->data_length = stored_data_length;
+                bricked_field->cache_mapping = mapping;
+                bricked_field->cache_mapping_size = cache_size;
+
+                load_cached_brick_tree(bricked_field, mapping, &layout, &contents);
+
+                bricked_field->n_sub_brick_tree_nodes = n_sub_brick_tree_nodes;
+                bricked_field->sub_brick_tree_nodes = (SubBrickTreeNode*)malloc(sizeof(SubBrickTreeNode)*n_sub_brick_tree_nodes);
+                check(bricked_field->sub_brick_tree_nodes);
+
+                memcpy(bricked_field->sub_brick_tree_nodes, sub_brick_tree_nodes, sizeof(SubBrickTreeNode)*n_sub_brick_tree_nodes);
+
+                bricked_field->sub_brick_visibility_ratios = (float*)malloc(sizeof(float)*n_sub_brick_tree_nodes);
+                check(bricked_field->sub_brick_visibility_ratios);
+
+                for (node_idx = 0; node_idx < n_sub_brick_tree_nodes; node_idx++)
+                    bricked_field->sub_brick_visibility_ratios[node_idx] = 1.0f;
+
+                bricked_field->sub_brick_histogram_starts = (uint32_t*)malloc(sizeof(uint32_t)*(n_sub_brick_tree_nodes + 1));
+                check(bricked_field->sub_brick_histogram_starts);
+
+                memcpy(bricked_field->sub_brick_histogram_starts, histogram_starts, sizeof(uint32_t)*(n_sub_brick_tree_nodes + 1));
+
+                const size_t n_histogram_entries = (size_t)contents.n_histogram_entries;
+
+                bricked_field->n_histogram_entries = n_histogram_entries;
+                bricked_field->histogram_entries = NULL;
+
+                if (n_histogram_entries > 0)
+                {
+                    bricked_field->histogram_entries = (ValueHistogramEntry*)malloc(sizeof(ValueHistogramEntry)*n_histogram_entries);
+                    check(bricked_field->histogram_entries);
+
+                    memcpy(bricked_field->histogram_entries, mapping + layout.histogram_entries_offset,
+                           sizeof(ValueHistogramEntry)*n_histogram_entries);
+                }
+
+                set_sub_brick_tree_pointers(bricked_field);
+
+                // The entries of each brick are those of its nodes, which follow each other
+                for (brick_idx = 0; brick_idx < n_bricks; brick_idx++)
+                {
+                    Brick* const brick = bricked_field->bricks + brick_idx;
+                    const uint32_t first_entry_idx = brick->histogram_starts[0];
+
+                    brick->n_histogram_entries = (size_t)(brick->histogram_starts[brick->n_tree_nodes] - first_entry_idx);
+                    brick->histogram = brick->is_constant ? NULL : bricked_field->histogram_entries + first_entry_idx;
+                }
+
+                // The cached bricks were normalized with these limits, which the field would otherwise have to be read to find
+                set_field_value_limits(field, contents.min_value, contents.max_value);
+
+                print_info_message("Using cached bricks from %s.", cache_filename.chars);
+            }
+        }
+
+        if (mapping && !is_valid)
+            unmap_binary_file(mapping, cache_size, 1);
+    }
+
+    if (!is_valid)
+        print_info_message("No valid brick cache found at %s.", cache_filename.chars);
+
+    clear_string(&cache_filename);
+
+    return is_valid;
+}
+
+static void load_cached_brick_tree(BrickedField* bricked_field, const char* mapping,
+                                   const BrickCacheLayout* layout, const BrickCacheContents* contents)
+{
+    /*
+    Copies the brick tree and the LOD bricks out of a validated cache mapping,
+    and points the data of the LOD bricks into the mapping.
+    */
+
+    assert(bricked_field);
+    assert(mapping);
+    assert(layout);
+    assert(contents);
+
+    const size_t n_tree_nodes = get_brick_tree_node_count(bricked_field->n_bricks);
+    const size_t n_lod_bricks = (size_t)contents->n_lod_bricks;
+
+    allocate_brick_tree(bricked_field);
+
+    memcpy(bricked_field->tree, mapping + layout->tree_nodes_offset, sizeof(BrickTreeNode)*n_tree_nodes);
+    memcpy(bricked_field->tree_lod_brick_indices, mapping + layout->tree_lod_brick_indices_offset, sizeof(uint32_t)*n_tree_nodes);
+
+    size_t node_idx;
+
+    for (node_idx = 0; node_idx < n_tree_nodes; node_idx++)
+        bricked_field->tree_visibility_ratios[node_idx] = 1.0f;
+
+    bricked_field->n_lod_bricks = n_lod_bricks;
+
+    if (n_lod_bricks == 0)
+        return;
+
+    bricked_field->lod_bricks = (LODBrick*)malloc(sizeof(LODBrick)*n_lod_bricks);
+    check(bricked_field->lod_bricks);
+
+    memcpy(bricked_field->lod_bricks, mapping + layout->lod_bricks_offset, sizeof(LODBrick)*n_lod_bricks);
+
+    bricked_field->lod_data = (char*)mapping + layout->lod_data_offset;
+
+    const size_t data_type_size = get_brick_data_type_size(bricked_field->data_type);
+    size_t lod_brick_idx;
+    size_t data_offset = 0;
+
+    for (lod_brick_idx = 0; lod_brick_idx < n_lod_bricks; lod_brick_idx++)
+    {
+        LODBrick* const lod_brick = bricked_field->lod_bricks + lod_brick_idx;
+
+        lod_brick->data = (char*)bricked_field->lod_data + data_type_size*data_offset;
+        lod_brick->texture_id = 0;
+
+        data_offset += get_lod_brick_data_length(lod_brick);
+    }
+}
+
+static void write_cached_bricked_field(const BrickedField* bricked_field, size_t data_length)
+{
+    /*
+    Writes the header, the value limits of the field, the table of constant
+    brick values, the trees, the value histograms, the LOD bricks and the data
+    of the non-constant bricks and the LOD bricks to the cache. The tree nodes are written as they
+    are, since they refer to each other and to the bricks by index.
+    */
+
+    assert(bricked_field);
+
+    const Field* const field = bricked_field->field;
+    assert(field);
+
+    BrickCacheHeader header;
+
+    if (!create_brick_cache_header(bricked_field, data_length, &header))
+    {
+        print_warning_message("Could not examine %s, so its bricks will not be cached.", field->source_filename.chars);
+        return;
+    }
+
+    const size_t n_bricks = bricked_field->n_bricks;
+    const size_t data_type_size = get_brick_data_type_size(bricked_field->data_type);
+
+    // The constant values are indexed by brick, while the node counts follow the storage order like the nodes themselves
+    float* const constant_values = (float*)malloc(sizeof(float)*n_bricks);
+    check(constant_values);
+
+    uint32_t* const node_counts = (uint32_t*)malloc(sizeof(uint32_t)*n_bricks);
+    check(node_counts);
+
+    size_t brick_idx;
+
+    for (brick_idx = 0; brick_idx < n_bricks; brick_idx++)
+    {
+        const Brick* const brick = bricked_field->bricks + brick_idx;
+        constant_values[brick_idx] = brick->is_constant ? brick->constant_value : NON_CONSTANT_BRICK_MARKER;
+        node_counts[brick_idx] = (uint32_t)bricked_field->bricks[bricked_field->brick_storage_order[brick_idx]].n_tree_nodes;
+    }
+
+    BrickCacheContents contents;
+    memset(&contents, 0, sizeof(BrickCacheContents));
+    contents.min_value = field->min_value;
+    contents.max_value = field->max_value;
+    contents.normalization_offset = field->normalization_offset;
+    contents.normalization_scale = field->normalization_scale;
+    contents.stored_data_length = (uint64_t)bricked_field->data_length;
+    contents.n_sub_brick_tree_nodes = (uint64_t)bricked_field->n_sub_brick_tree_nodes;
+    contents.n_histogram_entries = (uint64_t)bricked_field->n_histogram_entries;
+    contents.n_lod_bricks = (uint64_t)bricked_field->n_lod_bricks;
+
+    size_t lod_brick_idx;
+
+    for (lod_brick_idx = 0; lod_brick_idx < bricked_field->n_lod_bricks; lod_brick_idx++)
+        contents.lod_data_length += (uint64_t)get_lod_brick_data_length(bricked_field->lod_bricks + lod_brick_idx);
+
+    BrickCacheLayout layout;
+    find_brick_cache_layout(bricked_field, &contents, &layout);
+
+    BrickCacheSections sections;
+    sections.n_sections = 0;
+    sections.size = 0;
+
+    add_brick_cache_section(&sections, 0, &header, sizeof(BrickCacheHeader));
+    add_brick_cache_section(&sections, sizeof(BrickCacheHeader), &contents, sizeof(BrickCacheContents));
+    add_brick_cache_section(&sections, layout.constant_values_offset, constant_values, sizeof(float)*n_bricks);
+    add_brick_cache_section(&sections, layout.sub_brick_tree_node_counts_offset, node_counts, sizeof(uint32_t)*n_bricks);
+    add_brick_cache_section(&sections, layout.sub_brick_tree_nodes_offset,
+                            bricked_field->sub_brick_tree_nodes, sizeof(SubBrickTreeNode)*bricked_field->n_sub_brick_tree_nodes);
+    add_brick_cache_section(&sections, layout.histogram_starts_offset,
+                            bricked_field->sub_brick_histogram_starts, sizeof(uint32_t)*(bricked_field->n_sub_brick_tree_nodes + 1));
+    add_brick_cache_section(&sections, layout.histogram_entries_offset,
+                            bricked_field->histogram_entries, sizeof(ValueHistogramEntry)*bricked_field->n_histogram_entries);
+    add_brick_cache_section(&sections, layout.tree_nodes_offset, bricked_field->tree, sizeof(BrickTreeNode)*bricked_field->n_tree_nodes);
+    add_brick_cache_section(&sections, layout.tree_lod_brick_indices_offset,
+                            bricked_field->tree_lod_brick_indices, sizeof(uint32_t)*bricked_field->n_tree_nodes);
+    add_brick_cache_section(&sections, layout.lod_bricks_offset, bricked_field->lod_bricks, sizeof(LODBrick)*bricked_field->n_lod_bricks);
+    add_brick_cache_section(&sections, layout.data_offset, bricked_field->data, data_type_size*bricked_field->data_length);
+    add_brick_cache_section(&sections, layout.lod_data_offset, bricked_field->lod_data, data_type_size*(size_t)contents.lod_data_length);
+
+    assert(sections.size == layout.size);
+
+    DynamicString cache_filename = create_string("%s.bricks", field->source_filename.chars);
+
+    // Failing to write the cache is not fatal, since the bricks have already been created
+    if (write_binary_file_sections(cache_filename.chars, sections.data, sections.sizes, sections.n_sections))
+        print_info_message("Wrote brick cache to %s.", cache_filename.chars);
+    else
+        print_warning_message("Could not write brick cache to %s.", cache_filename.chars);
+
+    clear_string(&cache_filename);
+    free(node_counts);
+    free(constant_values);
+}
+
+static void add_brick_cache_section(BrickCacheSections* sections, size_t offset, const void* data, size_t size)
+{
+    /*
+    Appends a section to be written at the given offset in the cache, preceded
+    by zero padding from the end of the previous section.
+    */
+
+    assert(sections);
+    assert(offset >= sections->size);
+    assert(sections->n_sections + 2 <= MAX_BRICK_CACHE_SECTIONS);
+
+    if (offset > sections->size)
+    {
+        sections->data[sections->n_sections] = NULL;
+        sections->sizes[sections->n_sections] = offset - sections->size;
+        sections->n_sections++;
+    }
+
+    sections->data[sections->n_sections] = data;
+    sections->sizes[sections->n_sections] = size;
+    sections->n_sections++;
+
+    sections->size = offset + size;
+}
+
+static size_t get_brick_tree_node_count(size_t n_bricks)
+{
+    // A binary tree with one brick in each leaf has one node less than twice the number of bricks
+    return 2*n_bricks - 1;
+}
+
+static void create_brick_tree(BrickedField* bricked_field, int create_lod_bricks)
+{
+    assert(bricked_field);
+
+    allocate_brick_tree(bricked_field);
+
+    // LOD bricks are registered while the tree is created. There can be no more of them than there are interior nodes.
+    if (create_lod_bricks)
+    {
+        bricked_field->lod_bricks = (LODBrick*)malloc(sizeof(LODBrick)*bricked_field->n_bricks);
+        check(bricked_field->lod_bricks);
+    }
+
+    bricked_field->n_lod_bricks = 0;
+
+    const NodeIndices start_indices = {{0, 0, 0}};
+    const NodeIndices end_indices = {{bricked_field->n_bricks_x, bricked_field->n_bricks_y, bricked_field->n_bricks_z}};
+
+    uint32_t n_created_nodes = 0;
+    create_brick_tree_nodes(bricked_field, 0, UINT_MAX, start_indices, end_indices, &n_created_nodes);
+
+    assert(n_created_nodes == bricked_field->n_tree_nodes);
+}
+
+static void allocate_brick_tree(BrickedField* bricked_field)
+{
+    assert(bricked_field);
+
+    bricked_field->n_tree_nodes = get_brick_tree_node_count(bricked_field->n_bricks);
+    check(bricked_field->n_tree_nodes <= UINT32_MAX);
+
+    bricked_field->tree = (BrickTreeNode*)malloc(sizeof(BrickTreeNode)*bricked_field->n_tree_nodes);
+    check(bricked_field->tree);
+
+    bricked_field->tree_visibility_ratios = (float*)malloc(sizeof(float)*bricked_field->n_tree_nodes);
+    check(bricked_field->tree_visibility_ratios);
+
+    bricked_field->tree_lod_brick_indices = (uint32_t*)malloc(sizeof(uint32_t)*bricked_field->n_tree_nodes);
+    check(bricked_field->tree_lod_brick_indices);
+}
+
+static uint32_t create_brick_tree_nodes(BrickedField* bricked_field, unsigned int level, unsigned int parent_lod_level,
+                                        NodeIndices start_indices, NodeIndices end_indices, uint32_t* n_created_nodes)
+{
+    assert(bricked_field);
+    assert(n_created_nodes);
+
+    const uint32_t node_idx = (*n_created_nodes)++;
+    BrickTreeNode* const node = bricked_field->tree + node_idx;
+
+    node->upper_child_idx = 0;
+    node->brick_idx = 0;
+    node->split_axis = 0;
+    node->visibility = UNDETERMINED_REGION_VISIBILITY;
+
+    bricked_field->tree_visibility_ratios[node_idx] = 1.0f;
+    bricked_field->tree_lod_brick_indices[node_idx] = NO_LOD_BRICK;
+
+    size_t region_start[3];
+    size_t region_end[3];
+    const unsigned int lod_level = find_lod_level(bricked_field, start_indices, end_indices, region_start, region_end);
+
+    // Only the largest node at each level gets an LOD brick, so that the LOD bricks have about the size of a brick
+    if (bricked_field->lod_bricks && lod_level > 0 && lod_level < parent_lod_level)
+        add_lod_brick(bricked_field, node_idx, lod_level, region_start, region_end);
+
+    unsigned int axis;
+    size_t middle_idx;
+
+    if (!find_brick_split(&level, start_indices, end_indices, &axis, &middle_idx))
+    {
+        node->brick_idx = (uint32_t)((start_indices.idx[2]*bricked_field->n_bricks_y + start_indices.idx[1])*bricked_field->n_bricks_x
+                                     + start_indices.idx[0]);
+
+        const Brick* const brick = bricked_field->bricks + node->brick_idx;
+
+        node->spatial_offset = brick->spatial_offset;
+        node->spatial_extent = brick->spatial_extent;
+
+        node->min_value = brick->tree[0].min_value;
+        node->max_value = brick->tree[0].max_value;
+
+        return node_idx;
+    }
+
+    node->split_axis = (uint8_t)axis;
+
+    // Create child node for the lower interval, which will directly follow this node
+    NodeIndices new_end_indices = end_indices;
+    new_end_indices.idx[axis] = middle_idx;
+    const uint32_t lower_child_idx = create_brick_tree_nodes(bricked_field, level + 1, lod_level,
+                                                             start_indices, new_end_indices, n_created_nodes);
+
+    // Create child node for the upper interval
+    NodeIndices new_start_indices = start_indices;
+    new_start_indices.idx[axis] = middle_idx;
+    const uint32_t upper_child_idx = create_brick_tree_nodes(bricked_field, level + 1, lod_level,
+                                                             new_start_indices, end_indices, n_created_nodes);
+
+    node->upper_child_idx = upper_child_idx;
+
+    const BrickTreeNode* const lower_child = bricked_field->tree + lower_child_idx;
+    const BrickTreeNode* const upper_child = bricked_field->tree + upper_child_idx;
+
+    // The spatial offset of the node along the split axis is the minimum of the children's offset along that axis.
+    // The other components of the offset are equal for both children and also the same for this node.
+    node->spatial_offset = lower_child->spatial_offset;
+    node->spatial_offset.a[axis] = fminf(lower_child->spatial_offset.a[axis], upper_child->spatial_offset.a[axis]);
+
+    // The spatial extent of the node along the split axis is the sum of the children's extent along that axis.
+    // The other components of the extent are equal for both children and also the same for this node.
+    node->spatial_extent = lower_child->spatial_extent;
+    node->spatial_extent.a[axis] += upper_child->spatial_extent.a[axis];
+
+    node->min_value = fminf(lower_child->min_value, upper_child->min_value);
+    node->max_value = fmaxf(lower_child->max_value, upper_child->max_value);
+
+    return node_idx;
+}
+
+static int find_brick_split(unsigned int* level, NodeIndices start_indices, NodeIndices end_indices,
+                            unsigned int* split_axis, size_t* middle_idx)
+{
+    /*
+    Determines along which axis and where the given range of bricks should be
+    split. Returns 0 if the range only holds a single brick.
+    */
+
+    assert(level);
+    assert(split_axis);
+    assert(middle_idx);
+
+    unsigned int axis = (*level) % 3;
+
+    // Advance the level until a divisible axis is found or return if none is found
+    if (end_indices.idx[axis] - start_indices.idx[axis] == 1)
+    {
+        (*level)++;
+        axis = (*level) % 3;
+
+        if (end_indices.idx[axis] - start_indices.idx[axis] == 1)
+        {
+            (*level)++;
+            axis = (*level) % 3;
+
+            if (end_indices.idx[axis] - start_indices.idx[axis] == 1)
+            {
+                return 0;
+            }
+        }
+    }
+
+    *split_axis = axis;
+
+    // Subdivide along the current axis as close to the middle as possible
+    *middle_idx = (size_t)(0.5f*(float)(start_indices.idx[axis] + end_indices.idx[axis] + 1));
+    assert(*middle_idx > start_indices.idx[axis] && end_indices.idx[axis] > *middle_idx);
+
+    return 1;
+}
+
+static void find_brick_storage_order(BrickedField* bricked_field, unsigned int level,
+                                     NodeIndices start_indices, NodeIndices end_indices, size_t* n_ordered_bricks)
+{
+    /*
+    Appends the indices of the bricks in the given range to the storage order
+    in the order of a depth-first traversal of the brick tree, which only
+    depends on the brick geometry and can therefore be found before the tree
+    itself is created.
+    */
+
+    assert(bricked_field);
+    assert(bricked_field->brick_storage_order);
+    assert(n_ordered_bricks);
+
+    unsigned int axis;
+    size_t middle_idx;
+
+    if (!find_brick_split(&level, start_indices, end_indices, &axis, &middle_idx))
+    {
+        bricked_field->brick_storage_order[(*n_ordered_bricks)++] =
+            (start_indices.idx[2]*bricked_field->n_bricks_y + start_indices.idx[1])*bricked_field->n_bricks_x + start_indices.idx[0];
+        return;
+    }
+
+    NodeIndices new_end_indices = end_indices;
+    new_end_indices.idx[axis] = middle_idx;
+    find_brick_storage_order(bricked_field, level + 1, start_indices, new_end_indices, n_ordered_bricks);
+
+    NodeIndices new_start_indices = start_indices;
+    new_start_indices.idx[axis] = middle_idx;
+    find_brick_storage_order(bricked_field, level + 1, new_start_indices, end_indices, n_ordered_bricks);
+}
+
+static unsigned int find_lod_level(const BrickedField* bricked_field, NodeIndices start_indices, NodeIndices end_indices,
+                                   size_t region_start[3], size_t region_end[3])
+{
+    /*
+    Finds the voxel region covered by the given range of bricks, and the
+    lowest level at which the region is downsampled to no more than the brick
+    size along every axis. Level zero means that the range holds a single brick.
+    */
+
+    assert(bricked_field);
+    assert(region_start);
+    assert(region_end);
+
+    const size_t n_bricks_x = bricked_field->n_bricks_x;
+    const size_t n_bricks_y = bricked_field->n_bricks_y;
+
+    const Brick* const first_brick = bricked_field->bricks + (start_indices.idx[2]*n_bricks_y + start_indices.idx[1])*n_bricks_x + start_indices.idx[0];
+    const Brick* const last_brick = bricked_field->bricks + ((end_indices.idx[2] - 1)*n_bricks_y + end_indices.idx[1] - 1)*n_bricks_x + end_indices.idx[0] - 1;
+
+    region_start[0] = first_brick->offset_x;
+    region_start[1] = first_brick->offset_y;
+    region_start[2] = first_brick->offset_z;
+
+    region_end[0] = last_brick->offset_x + last_brick->size_x;
+    region_end[1] = last_brick->offset_y + last_brick->size_y;
+    region_end[2] = last_brick->offset_z + last_brick->size_z;
+
+    const size_t max_region_size = max_size_t(region_end[0] - region_start[0],
+                                              max_size_t(region_end[1] - region_start[1], region_end[2] - region_start[2]));
+
+    unsigned int level = 0;
+
+    while ((max_region_size + pow2_size_t(level) - 1)/pow2_size_t(level) > bricked_field->brick_size)
+        level++;
+
+    return level;
+}
+
+static void add_lod_brick(BrickedField* bricked_field, uint32_t node_idx, unsigned int level,
+                          const size_t region_start[3], const size_t region_end[3])
+{
+    /*
+    Registers an LOD brick for the given node, covering its voxel region at the
+    given level. The data is padded with at least one voxel of the level on
+    each side within the field, and the texture coordinates of the region are
+    computed so that the voxels of all levels line up.
+    */
+
+    assert(bricked_field);
+    assert(node_idx < bricked_field->n_tree_nodes);
+    assert(bricked_field->n_lod_bricks < bricked_field->n_bricks);
+
+    const size_t field_size[3] = {bricked_field->field->size_x, bricked_field->field->size_y, bricked_field->field->size_z};
+    const size_t factor = pow2_size_t(level);
+    const size_t pad_size = max_size_t(bricked_field->pad_size, 1);
+
+    bricked_field->tree_lod_brick_indices[node_idx] = (uint32_t)bricked_field->n_lod_bricks;
+    LODBrick* const lod_brick = bricked_field->lod_bricks + bricked_field->n_lod_bricks++;
+
+    lod_brick->data = NULL;
+    lod_brick->level = level;
+    lod_brick->texture_id = 0;
+
+    size_t level_size, start, end;
+    unsigned int dim;
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        level_size = (field_size[dim] + factor - 1)/factor;
+
+        start = region_start[dim]/factor;
+        end = (region_end[dim] + factor - 1)/factor;
+
+        lod_brick->offset[dim] = start - min_size_t(start, pad_size);
+        lod_brick->padded_size[dim] = min_size_t(end + pad_size, level_size) - lod_brick->offset[dim];
+
+        lod_brick->texture_offset.a[dim] = ((float)region_start[dim]/(float)factor - (float)lod_brick->offset[dim])/(float)lod_brick->padded_size[dim];
+        lod_brick->texture_extent.a[dim] = (float)(region_end[dim] - region_start[dim])/((float)factor*(float)lod_brick->padded_size[dim]);
+    }
+}
+
+static size_t get_lod_brick_data_length(const LODBrick* lod_brick)
+{
+    assert(lod_brick);
+    return lod_brick->padded_size[0]*lod_brick->padded_size[1]*lod_brick->padded_size[2];
+}
+
+static void create_lod_bricks(BrickedField* bricked_field)
+{
+    /*
+    Fills the LOD bricks registered while creating the brick tree. The field is
+    downsampled one level at a time by averaging blocks of 2x2x2 voxels,
+    starting from the values in the bricks, and every LOD brick is copied from
+    the downsampled field of its level. At most two levels are held in memory
+    at once.
+    */
+
+    assert(bricked_field);
+
+    if (bricked_field->n_lod_bricks == 0)
+    {
+        if (bricked_field->lod_bricks)
+            free(bricked_field->lod_bricks);
+
+        bricked_field->lod_bricks = NULL;
+        return;
+    }
+
+    bricked_field->lod_bricks = (LODBrick*)realloc(bricked_field->lod_bricks, sizeof(LODBrick)*bricked_field->n_lod_bricks);
+    check(bricked_field->lod_bricks);
+
+    const size_t data_type_size = get_brick_data_type_size(bricked_field->data_type);
+
+    size_t lod_brick_idx;
+    size_t data_length = 0;
+    unsigned int max_level = 0;
+
+    for (lod_brick_idx = 0; lod_brick_idx < bricked_field->n_lod_bricks; lod_brick_idx++)
+    {
+        const LODBrick* const lod_brick = bricked_field->lod_bricks + lod_brick_idx;
+        data_length += get_lod_brick_data_length(lod_brick);
+        max_level = (lod_brick->level > max_level) ? lod_brick->level : max_level;
+    }
+
+    bricked_field->lod_data = malloc(data_type_size*data_length);
+    check(bricked_field->lod_data);
+
+    size_t data_offset = 0;
+
+    for (lod_brick_idx = 0; lod_brick_idx < bricked_field->n_lod_bricks; lod_brick_idx++)
+    {
+        LODBrick* const lod_brick = bricked_field->lod_bricks + lod_brick_idx;
+        lod_brick->data = (char*)bricked_field->lod_data + data_type_size*data_offset;
+        data_offset += get_lod_brick_data_length(lod_brick);
+    }
+
+    const unsigned int n_threads = get_worker_thread_count();
+
+    LODLevel lod_level;
+    lod_level.bricked_field = bricked_field;
+    lod_level.source_data = NULL;
+    lod_level.source_size[0] = bricked_field->field->size_x;
+    lod_level.source_size[1] = bricked_field->field->size_y;
+    lod_level.source_size[2] = bricked_field->field->size_z;
+
+    unsigned int level;
+    unsigned int dim;
+
+    for (level = 1; level <= max_level; level++)
+    {
+        lod_level.level = level;
+
+        for (dim = 0; dim < 3; dim++)
+            lod_level.size[dim] = (lod_level.source_size[dim] + 1)/2;
+
+        lod_level.data = (float*)malloc(sizeof(float)*lod_level.size[0]*lod_level.size[1]*lod_level.size[2]);
+        check(lod_level.data);
+
+        // Every brick covers an even number of voxels along each axis, except at the upper field edges, so the
+        // bricks downsample into disjoint parts of the first level
+        if (level == 1)
+            run_parallel_tasks(downsample_brick_to_first_lod_level, &lod_level, bricked_field->n_bricks, n_threads);
+        else
+            run_parallel_tasks(downsample_lod_level_slice, &lod_level, lod_level.size[2], n_threads);
+
+        if (lod_level.source_data)
+            free((float*)lod_level.source_data);
+
+        run_parallel_tasks(fill_lod_brick, &lod_level, bricked_field->n_lod_bricks, n_threads);
+
+        lod_level.source_data = lod_level.data;
+
+        for (dim = 0; dim < 3; dim++)
+            lod_level.source_size[dim] = lod_level.size[dim];
+    }
+
+    free((float*)lod_level.source_data);
+}
+
+static void downsample_brick_to_first_lod_level(void* shared_data, size_t task_idx, unsigned int thread_idx)
+{
+    const LODLevel* const lod_level = (const LODLevel*)shared_data;
+    assert(lod_level);
+
+    const BrickedField* const bricked_field = lod_level->bricked_field;
+
+    // The bricks are visited in storage order, so that their data is read sequentially
+    const size_t brick_idx = bricked_field->brick_storage_order[task_idx];
+    const Brick* const brick = bricked_field->bricks + brick_idx;
+
+    const size_t pad_size = bricked_field->pad_size;
+    const size_t n_bricks[3] = {bricked_field->n_bricks_x, bricked_field->n_bricks_y, bricked_field->n_bricks_z};
+    const size_t brick_indices[3] = {brick_idx % n_bricks[0], (brick_idx/n_bricks[0]) % n_bricks[1], brick_idx/(n_bricks[0]*n_bricks[1])};
+    const size_t offset[3] = {brick->offset_x, brick->offset_y, brick->offset_z};
+    const size_t size[3] = {brick->size_x, brick->size_y, brick->size_z};
+
+    size_t strides[3];
+    get_brick_data_strides(brick, strides);
+
+    // The bricks partition the field, with the field edge voxels that only serve as padding belonging to the edge bricks
+    size_t start[3];
+    size_t end[3];
+    unsigned int dim;
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        start[dim] = offset[dim] - (brick_indices[dim] == 0)*pad_size;
+        end[dim] = offset[dim] + size[dim] + (brick_indices[dim] == n_bricks[dim] - 1)*pad_size;
+    }
+
+    const size_t level_size_x = lod_level->size[0];
+    const size_t level_size_y = lod_level->size[1];
+
+    size_t i, j, k;
+    float* output_row;
+
+    if (brick->is_constant)
+    {
+        for (k = start[2]/2; k < (end[2] + 1)/2; k++)
+            for (j = start[1]/2; j < (end[1] + 1)/2; j++)
+            {
+                output_row = lod_level->data + (k*level_size_y + j)*level_size_x;
+
+                for (i = start[0]/2; i < (end[0] + 1)/2; i++)
+                    output_row[i] = brick->constant_value;
+            }
+
+        return;
+    }
+
+    const float* const float_data = (bricked_field->data_type == BRICK_DATA_FLOAT32) ? (const float*)brick->data : NULL;
+
+    size_t ii, jj, kk;
+    size_t n_i, n_j, n_k;
+    size_t base_idx;
+    float sum;
+
+    for (k = start[2]/2; k < (end[2] + 1)/2; k++)
+    {
+        // Only the last block along an axis can be cut short, when the field size is odd
+        n_k = (2*k + 1 < end[2]) ? 2 : 1;
+
+        for (j = start[1]/2; j < (end[1] + 1)/2; j++)
+        {
+            n_j = (2*j + 1 < end[1]) ? 2 : 1;
+            output_row = lod_level->data + (k*level_size_y + j)*level_size_x;
+
+            for (i = start[0]/2; i < (end[0] + 1)/2; i++)
+            {
+                n_i = (2*i + 1 < end[0]) ? 2 : 1;
+
+                // The padded brick data starts pad_size voxels before the brick offset along every axis
+                base_idx = (2*i + pad_size - offset[0])*strides[0] +
+                           (2*j + pad_size - offset[1])*strides[1] +
+                           (2*k + pad_size - offset[2])*strides[2];
+
+                if (float_data && n_i == 2 && n_j == 2 && n_k == 2)
+                {
+                    output_row[i] = 0.125f*(float_data[base_idx] +
+                                            float_data[base_idx + strides[0]] +
+                                            float_data[base_idx + strides[1]] +
+                                            float_data[base_idx + strides[0] + strides[1]] +
+                                            float_data[base_idx + strides[2]] +
+                                            float_data[base_idx + strides[0] + strides[2]] +
+                                            float_data[base_idx + strides[1] + strides[2]] +
+                                            float_data[base_idx + strides[0] + strides[1] + strides[2]]);
+                }
+                else
+                {
+                    sum = 0;
+
+                    for (kk = 0; kk < n_k; kk++)
+                        for (jj = 0; jj < n_j; jj++)
+                            for (ii = 0; ii < n_i; ii++)
+                                sum += get_brick_data_value(bricked_field, brick, base_idx + ii*strides[0] + jj*strides[1] + kk*strides[2]);
+
+                    output_row[i] = sum/(float)(n_i*n_j*n_k);
+                }
+            }
+        }
+    }
+}
+
+static void downsample_lod_level_slice(void* shared_data, size_t slice_idx, unsigned int thread_idx)
+{
+    const LODLevel* const lod_level = (const LODLevel*)shared_data;
+    assert(lod_level);
+    assert(lod_level->source_data);
+
+    const size_t* const source_size = lod_level->source_size;
+    const size_t source_row_stride = source_size[0];
+    const size_t source_plane_stride = source_size[0]*source_size[1];
+    const size_t k = slice_idx;
+
+    // Only the last block along an axis can be cut short, when the size of the previous level is odd
+    const size_t n_k = (2*k + 1 < source_size[2]) ? 2 : 1;
+
+    size_t i, j, ii, jj, kk;
+    size_t n_i, n_j;
+    const float* source_block;
+    float* output_row;
+    float sum;
+
+    for (j = 0; j < lod_level->size[1]; j++)
+    {
+        n_j = (2*j + 1 < source_size[1]) ? 2 : 1;
+        output_row = lod_level->data + (k*lod_level->size[1] + j)*lod_level->size[0];
+
+        for (i = 0; i < lod_level->size[0]; i++)
+        {
+            n_i = (2*i + 1 < source_size[0]) ? 2 : 1;
+            source_block = lod_level->source_data + 2*k*source_plane_stride + 2*j*source_row_stride + 2*i;
+
+            sum = 0;
+
+            for (kk = 0; kk < n_k; kk++)
+                for (jj = 0; jj < n_j; jj++)
+                    for (ii = 0; ii < n_i; ii++)
+                        sum += source_block[kk*source_plane_stride + jj*source_row_stride + ii];
+
+            output_row[i] = sum/(float)(n_i*n_j*n_k);
+        }
+    }
+}
+
+static void fill_lod_brick(void* shared_data, size_t lod_brick_idx, unsigned int thread_idx)
+{
+    const LODLevel* const lod_level = (const LODLevel*)shared_data;
+    assert(lod_level);
+
+    const BrickedField* const bricked_field = lod_level->bricked_field;
+    const LODBrick* const lod_brick = bricked_field->lod_bricks + lod_brick_idx;
+
+    if (lod_brick->level != lod_level->level)
+        return;
+
+    const size_t n_values = lod_brick->padded_size[0]*lod_brick->padded_size[1]*lod_brick->padded_size[2];
+
+    // There are few LOD bricks, so values to be converted are simply copied into an array of their own first
+    float* const values = (bricked_field->data_type == BRICK_DATA_FLOAT32) ? (float*)lod_brick->data : (float*)malloc(sizeof(float)*n_values);
+    check(values);
+
+    // The downsampled values are already normalized
+    copy_subarray_with_cycled_layout(lod_level->data,
+                                     lod_level->size[0], lod_level->size[1],
+                                     lod_brick->offset[0], lod_brick->offset[1], lod_brick->offset[2],
+                                     values,
+                                     lod_brick->padded_size[0], lod_brick->padded_size[1], lod_brick->padded_size[2],
+                                     0, 0.0f, 1.0f);
+
+    if (values != lod_brick->data)
+    {
+        convert_values(values, lod_brick->data, n_values, bricked_field->data_type);
+        free(values);
+    }
+}
+
+static void allocate_sub_brick_trees(BrickedField* bricked_field)
+{
+    /*
+    The sub brick trees of all bricks are stored after each other in a single
+    array. With midpoint splits, the number of nodes in each tree only depends
+    on the brick geometry, so the array can be allocated and divided between
+    the bricks up front. With adaptive splits, each brick is given room for
+    the largest tree its geometry permits, and the trees are compacted once
+    they have been created. The trees can in either case be built concurrently
+    into their own parts of the array. Like the brick data, the trees follow
+    the storage order of the bricks.
+    */
+
+    assert(bricked_field);
+
+    const NodeIndices start_indices = {{0, 0, 0}};
+    size_t brick_idx;
+    size_t n_nodes = 0;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+    {
+        Brick* const brick = bricked_field->bricks + brick_idx;
+        const NodeIndices end_indices = {{brick->size_x, brick->size_y, brick->size_z}};
+
+        brick->n_tree_nodes = bricked_field->uses_adaptive_sub_brick_splits ? count_max_adaptive_sub_brick_tree_nodes(bricked_field, brick)
+                                                                            : count_sub_brick_tree_nodes(bricked_field->sub_brick_size_limit, 0, start_indices, end_indices);
+        check(brick->n_tree_nodes <= UINT32_MAX);
+
+        n_nodes += brick->n_tree_nodes;
+    }
+
+    bricked_field->n_sub_brick_tree_nodes = n_nodes;
+    bricked_field->sub_brick_tree_nodes = (SubBrickTreeNode*)malloc(sizeof(SubBrickTreeNode)*n_nodes);
+    check(bricked_field->sub_brick_tree_nodes);
+
+    bricked_field->sub_brick_visibility_ratios = (float*)malloc(sizeof(float)*n_nodes);
+    check(bricked_field->sub_brick_visibility_ratios);
+
+    // The last start holds the total number of histogram entries, so that every node's entries end where the next node's start
+    bricked_field->sub_brick_histogram_starts = (uint32_t*)malloc(sizeof(uint32_t)*(n_nodes + 1));
+    check(bricked_field->sub_brick_histogram_starts);
+
+    set_sub_brick_tree_pointers(bricked_field);
+}
+
+static void set_sub_brick_tree_pointers(BrickedField* bricked_field)
+{
+    /*
+    Points each brick to its part of the arrays of sub brick tree nodes,
+    visibility ratios and histogram starts, where the trees follow each other
+    in brick storage order.
+    */
+
+    assert(bricked_field);
+    assert(bricked_field->sub_brick_tree_nodes);
+    assert(bricked_field->sub_brick_visibility_ratios);
+    assert(bricked_field->sub_brick_histogram_starts);
+
+    size_t brick_idx;
+    size_t n_nodes = 0;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+    {
+        Brick* const brick = bricked_field->bricks + bricked_field->brick_storage_order[brick_idx];
+        brick->tree = bricked_field->sub_brick_tree_nodes + n_nodes;
+        brick->visibility_ratios = bricked_field->sub_brick_visibility_ratios + n_nodes;
+        brick->histogram_starts = bricked_field->sub_brick_histogram_starts + n_nodes;
+        n_nodes += brick->n_tree_nodes;
+    }
+
+    assert(n_nodes == bricked_field->n_sub_brick_tree_nodes);
+}
+
+static void compact_sub_brick_trees(BrickedField* bricked_field)
+{
+    /*
+    Moves the sub brick trees forward so that they follow each other without
+    gaps, and shrinks the node arrays accordingly. Since the node indices are
+    relative to the root of each tree, the trees can be moved freely.
+    */
+
+    assert(bricked_field);
+    assert(bricked_field->sub_brick_tree_nodes);
+
+    size_t brick_idx;
+    size_t n_nodes = 0;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+        n_nodes += bricked_field->bricks[brick_idx].n_tree_nodes;
+
+    if (n_nodes == bricked_field->n_sub_brick_tree_nodes)
+        return;
+
+    n_nodes = 0;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+    {
+        const Brick* const brick = bricked_field->bricks + bricked_field->brick_storage_order[brick_idx];
+
+        memmove(bricked_field->sub_brick_tree_nodes + n_nodes, brick->tree, sizeof(SubBrickTreeNode)*brick->n_tree_nodes);
+        memmove(bricked_field->sub_brick_visibility_ratios + n_nodes, brick->visibility_ratios, sizeof(float)*brick->n_tree_nodes);
+        memmove(bricked_field->sub_brick_histogram_starts + n_nodes, brick->histogram_starts, sizeof(uint32_t)*brick->n_tree_nodes);
+
+        n_nodes += brick->n_tree_nodes;
+    }
+
+    bricked_field->sub_brick_tree_nodes = (SubBrickTreeNode*)realloc(bricked_field->sub_brick_tree_nodes, sizeof(SubBrickTreeNode)*n_nodes);
+    check(bricked_field->sub_brick_tree_nodes);
+
+    bricked_field->sub_brick_visibility_ratios = (float*)realloc(bricked_field->sub_brick_visibility_ratios, sizeof(float)*n_nodes);
+    check(bricked_field->sub_brick_visibility_ratios);
+
+    bricked_field->sub_brick_histogram_starts = (uint32_t*)realloc(bricked_field->sub_brick_histogram_starts, sizeof(uint32_t)*(n_nodes + 1));
+    check(bricked_field->sub_brick_histogram_starts);
+
+    bricked_field->n_sub_brick_tree_nodes = n_nodes;
+
+    set_sub_brick_tree_pointers(bricked_field);
+}
+
+static void gather_sub_brick_histograms(BrickedField* bricked_field)
+{
+    /*
+    Moves the value histograms that the bricks have built in their own arrays
+    into a single array, in the storage order of the bricks. The histogram
+    starts of the nodes, which are relative to the entries of their brick
+    until then, are offset to index the combined array.
+    */
+
+    assert(bricked_field);
+
+    size_t brick_idx;
+    size_t node_idx;
+    size_t n_entries = 0;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+        n_entries += bricked_field->bricks[brick_idx].n_histogram_entries;
+
+    check(n_entries <= UINT32_MAX);
+
+    bricked_field->histogram_entries = NULL;
+    bricked_field->n_histogram_entries = n_entries;
+    bricked_field->sub_brick_histogram_starts[bricked_field->n_sub_brick_tree_nodes] = (uint32_t)n_entries;
+
+    // Only constant bricks have no histogram entries
+    if (n_entries > 0)
+    {
+        bricked_field->histogram_entries = (ValueHistogramEntry*)malloc(sizeof(ValueHistogramEntry)*n_entries);
+        check(bricked_field->histogram_entries);
+    }
+
+    n_entries = 0;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+    {
+        Brick* const brick = bricked_field->bricks + bricked_field->brick_storage_order[brick_idx];
+
+        for (node_idx = 0; node_idx < brick->n_tree_nodes; node_idx++)
+            brick->histogram_starts[node_idx] += (uint32_t)n_entries;
+
+        if (!brick->histogram)
+            continue;
+
+        ValueHistogramEntry* const histogram = bricked_field->histogram_entries + n_entries;
+        memcpy(histogram, brick->histogram, sizeof(ValueHistogramEntry)*brick->n_histogram_entries);
+
+        free(brick->histogram);
+        brick->histogram = histogram;
+
+        n_entries += brick->n_histogram_entries;
+    }
+}
+
+static void create_sub_brick_histograms(const BrickedField* bricked_field, Brick* brick)
+{
+    /*
+    Builds the value histograms of the leaves of the sub brick tree of the
+    brick into an array of its own, so that the bricks can do this
+    concurrently while their data is still in cache.
+    */
+
+    assert(bricked_field);
+    assert(brick);
+
+    brick->histogram = NULL;
+    brick->n_histogram_entries = 0;
+
+    // The visibility of a constant brick follows from its single value
+    if (brick->is_constant)
+        return;
+
+    SubBrickTreeNode* node;
+    size_t node_idx;
+    size_t max_n_entries = 0;
+
+    // A leaf has at most one entry per bin, plus one for every full entry count among its voxels
+    for (node_idx = 0; node_idx < brick->n_tree_nodes; node_idx++)
+    {
+        node = brick->tree + node_idx;
+
+        if (node->upper_child_idx == 0)
+            max_n_entries += VALUE_HISTOGRAM_BINS + ((size_t)node->size[0]*node->size[1]*node->size[2])/UINT8_MAX;
+    }
+
+    ValueHistogramEntry* const histogram = (ValueHistogramEntry*)malloc(sizeof(ValueHistogramEntry)*max_n_entries);
+    check(histogram);
+
+    uint32_t counts[VALUE_HISTOGRAM_BINS];
+    uint32_t count;
+    unsigned int bin;
+    size_t n_entries = 0;
+
+    for (node_idx = 0; node_idx < brick->n_tree_nodes; node_idx++)
+    {
+        node = brick->tree + node_idx;
+
+        // Interior nodes have no entries of their own, so their entries end where they start
+        check(n_entries <= UINT32_MAX);
+        brick->histogram_starts[node_idx] = (uint32_t)n_entries;
+
+        if (node->upper_child_idx != 0)
+            continue;
+
+        const NodeIndices start_indices = {{node->offset[0], node->offset[1], node->offset[2]}};
+        const NodeIndices end_indices = {{(size_t)node->offset[0] + node->size[0],
+                                          (size_t)node->offset[1] + node->size[1],
+                                          (size_t)node->offset[2] + node->size[2]}};
+
+        memset(counts, 0, sizeof(counts));
+        add_region_to_value_histogram(bricked_field, brick, start_indices, end_indices, counts);
+
+        for (bin = 0; bin < VALUE_HISTOGRAM_BINS; bin++)
+        {
+            count = counts[bin];
+
+            // Bins that fit in a single entry are written without branching, and only kept if they are non-empty
+            while (count > UINT8_MAX)
+            {
+                histogram[n_entries].count = UINT8_MAX;
+                histogram[n_entries].bin = (uint8_t)bin;
+                n_entries++;
+
+                count -= UINT8_MAX;
+            }
+
+            histogram[n_entries].count = (uint8_t)count;
+            histogram[n_entries].bin = (uint8_t)bin;
+            n_entries += (count > 0);
+        }
+    }
+
+    assert(n_entries <= max_n_entries);
+
+    brick->histogram = histogram;
+    brick->n_histogram_entries = n_entries;
+}
+
+static void add_region_to_value_histogram(const BrickedField* bricked_field, const Brick* brick,
+                                          NodeIndices start_indices, NodeIndices end_indices, uint32_t* counts)
+{
+    /*
+    Adds the normalized values in the given region of the non-constant brick,
+    with indices relative to the unpadded brick, to the given bin counts.
+    */
+
+    assert(bricked_field);
+    assert(brick);
+    assert(!brick->is_constant);
+    assert(counts);
+
+    size_t memory_sizes[3];
+    size_t memory_strides[3];
+    const size_t offset = get_brick_region_memory_layout(bricked_field, brick, start_indices, end_indices, memory_sizes, memory_strides);
+
+    size_t j, k;
+    for (k = 0; k < memory_sizes[2]; k++)
+        for (j = 0; j < memory_sizes[1]; j++)
+            add_row_to_value_histogram(bricked_field, brick, offset + k*memory_strides[2] + j*memory_strides[1], memory_sizes[0], counts);
+}
+
+static void add_row_to_value_histogram(const BrickedField* bricked_field, const Brick* brick, size_t start_idx, size_t length, uint32_t* counts)
+{
+    /*
+    Adds the normalized values of the given contiguous range of the brick data
+    to the given bin counts. The integer types are binned without converting
+    them, since their range maps exactly onto the bins.
+    */
+
+    assert(bricked_field);
+    assert(brick);
+    assert(counts);
+
+    size_t idx;
+
+    switch (bricked_field->data_type)
+    {
+        case BRICK_DATA_UINT16:
+        {
+            const uint16_t* const values = (const uint16_t*)brick->data + start_idx;
+
+            for (idx = 0; idx < length; idx++)
+                counts[(unsigned int)values[idx]*VALUE_HISTOGRAM_BINS/(UINT16_MAX + 1)]++;
+
+            break;
+        }
+        case BRICK_DATA_UINT8:
+        {
+            const uint8_t* const values = (const uint8_t*)brick->data + start_idx;
+
+            for (idx = 0; idx < length; idx++)
+                counts[(unsigned int)values[idx]*VALUE_HISTOGRAM_BINS/(UINT8_MAX + 1)]++;
+
+            break;
+        }
+        case BRICK_DATA_FLOAT32:
+        {
+            const float* const values = (const float*)brick->data + start_idx;
+
+            for (idx = 0; idx < length; idx++)
+                counts[find_value_histogram_bin(values[idx])]++;
+
+            break;
+        }
+        default:
+        {
+            for (idx = 0; idx < length; idx++)
+                counts[find_value_histogram_bin(get_brick_data_value(bricked_field, brick, start_idx + idx))]++;
+        }
+    }
+}
+
+static unsigned int find_value_histogram_bin(float value)
+{
+    // Bin b holds the normalized values in [b, b + 1)/VALUE_HISTOGRAM_BINS, except that the last bin also holds 1
+    const float scaled_value = fminf(fmaxf(value*(float)VALUE_HISTOGRAM_BINS, 0.0f), (float)(VALUE_HISTOGRAM_BINS - 1));
+    return (unsigned int)scaled_value;
+}
+
+static void create_sub_brick_tree(const BrickedField* bricked_field, Brick* brick)
+{
+    assert(bricked_field);
+    assert(brick);
+    assert(brick->tree);
+
+    const NodeIndices start_indices = {{0, 0, 0}};
+    const NodeIndices end_indices = {{brick->size_x, brick->size_y, brick->size_z}};
+
+    uint32_t n_created_nodes = 0;
+
+    if (!bricked_field->uses_adaptive_sub_brick_splits)
+    {
+        create_sub_brick_tree_nodes(bricked_field, brick, 0, start_indices, end_indices, &n_created_nodes);
+        assert(n_created_nodes == brick->n_tree_nodes);
+        return;
+    }
+
+    if (brick->is_constant)
+    {
+        // A constant brick has nothing to separate, so its tree is a single leaf
+        SubBrickTreeNode* const node = add_sub_brick_tree_node(brick, start_indices, end_indices, &n_created_nodes);
+        node->min_value = brick->constant_value;
+        node->max_value = brick->constant_value;
+    }
+    else
+    {
+        SubBrickCells cells;
+        create_sub_brick_cells(bricked_field, brick, &cells);
+
+        create_adaptive_sub_brick_tree_nodes(brick, &cells, 0, start_indices, end_indices, &n_created_nodes);
+
+        destroy_sub_brick_cells(&cells);
+    }
+
+    assert(n_created_nodes <= brick->n_tree_nodes);
+    brick->n_tree_nodes = n_created_nodes;
+}
+
+static int find_sub_brick_split(size_t size_limit, unsigned int* level, NodeIndices start_indices, NodeIndices end_indices,
+                                unsigned int* split_axis, size_t* middle_idx)
+{
+    /*
+    Determines along which axis and where the given sub brick region should be
+    split. Returns 0 if the region is smaller than the size limit along every
+    axis.
+    */
+
+    assert(level);
+    assert(split_axis);
+    assert(middle_idx);
+
+    unsigned int axis = (*level) % 3;
+
+    // Advance the level until a divisible axis is found or return if none is found
+    if (end_indices.idx[axis] - start_indices.idx[axis] < size_limit)
+    {
+        (*level)++;
+        axis = (*level) % 3;
+
+        if (end_indices.idx[axis] - start_indices.idx[axis] < size_limit)
+        {
+            (*level)++;
+            axis = (*level) % 3;
+
+            if (end_indices.idx[axis] - start_indices.idx[axis] < size_limit)
+            {
+                return 0;
+            }
+        }
+    }
+
+    *split_axis = axis;
+
+    // Subdivide along the current axis as close to the middle as possible (rounding down)
+    *middle_idx = (size_t)(0.5f*(float)(start_indices.idx[axis] + end_indices.idx[axis]));
+    assert(*middle_idx > start_indices.idx[axis] && end_indices.idx[axis] > *middle_idx);
+
+    return 1;
+}
+
+static size_t count_sub_brick_tree_nodes(size_t size_limit, unsigned int level, NodeIndices start_indices, NodeIndices end_indices)
+{
+    unsigned int axis;
+    size_t middle_idx;
+
+    if (!find_sub_brick_split(size_limit, &level, start_indices, end_indices, &axis, &middle_idx))
+        return 1;
+
+    NodeIndices new_end_indices = end_indices;
+    new_end_indices.idx[axis] = middle_idx;
+
+    NodeIndices new_start_indices = start_indices;
+    new_start_indices.idx[axis] = middle_idx;
+
+    return 1 + count_sub_brick_tree_nodes(size_limit, level + 1, start_indices, new_end_indices)
+             + count_sub_brick_tree_nodes(size_limit, level + 1, new_start_indices, end_indices);
+}
+
+static size_t count_max_adaptive_sub_brick_tree_nodes(const BrickedField* bricked_field, const Brick* brick)
+{
+    /*
+    A region is only split along an axis if it is at least twice the minimum
+    sub brick size along it, and both parts are then at least the minimum
+    size. Every leaf therefore either spans the whole brick along an axis or
+    is at least the minimum size along it, which limits the number of leaves.
+    */
+
+    assert(bricked_field);
+    assert(brick);
+
+    const size_t sizes[3] = {brick->size_x, brick->size_y, brick->size_z};
+    const size_t min_size = bricked_field->sub_brick_size_limit/2;
+
+    size_t n_leaves = 1;
+    unsigned int dim;
+
+    for (dim = 0; dim < 3; dim++)
+        if (sizes[dim] >= bricked_field->sub_brick_size_limit)
+            n_leaves *= sizes[dim]/min_size;
+
+    return 2*n_leaves - 1;
+}
+
+static SubBrickTreeNode* add_sub_brick_tree_node(Brick* brick, NodeIndices start_indices, NodeIndices end_indices, uint32_t* n_created_nodes)
+{
+    /*
+    Initializes the next node in the tree of the given brick as a leaf covering
+    the given region. Its value limits are left for the caller to set.
+    */
+
+    assert(brick);
+    assert(n_created_nodes);
+
+    const uint32_t node_idx = (*n_created_nodes)++;
+    SubBrickTreeNode* const node = brick->tree + node_idx;
+
+    unsigned int dim;
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        node->offset[dim] = (uint16_t)start_indices.idx[dim];
+        node->size[dim] = (uint16_t)(end_indices.idx[dim] - start_indices.idx[dim]);
+    }
+
+    node->upper_child_idx = 0;
+    node->indicator_idx = 0;
+    node->split_axis = 0;
+    node->visibility = UNDETERMINED_REGION_VISIBILITY;
+
+    brick->visibility_ratios[node_idx] = 1.0f;
+    brick->histogram_starts[node_idx] = 0;
 
     return node;
 }
 
-static void create_sub_brick_tree(Brick* brick, const Field* field)
+static uint32_t create_sub_brick_tree_nodes(const BrickedField* bricked_field, Brick* brick, unsigned int level,
+                                            NodeIndices start_indices, NodeIndices end_indices, uint32_t* n_created_nodes)
+{
+    /*
+    Creates the node covering the given region of the brick and, recursively,
+    its descendants. The value limits of the leaf nodes are found from the
+    brick data, and those of the other nodes are combined from their children.
+    Since the leaves partition the brick, each voxel is examined only once.
+    */
+
+    assert(bricked_field);
+    assert(brick);
+    assert(n_created_nodes);
+
+    const uint32_t node_idx = *n_created_nodes;
+    SubBrickTreeNode* const node = add_sub_brick_tree_node(brick, start_indices, end_indices, n_created_nodes);
+
+    unsigned int axis;
+    size_t middle_idx;
+
+    if (!find_sub_brick_split(bricked_field->sub_brick_size_limit, &level, start_indices, end_indices, &axis, &middle_idx))
+    {
+        find_brick_region_value_limits(bricked_field, brick, start_indices, end_indices, &node->min_value, &node->max_value);
+        return node_idx;
+    }
+
+    node->split_axis = (uint8_t)axis;
+
+    // Create child node for the lower interval, which will directly follow this node
+    NodeIndices new_end_indices = end_indices;
+    new_end_indices.idx[axis] = middle_idx;
+    const uint32_t lower_child_idx = create_sub_brick_tree_nodes(bricked_field, brick, level + 1, start_indices, new_end_indices, n_created_nodes);
+
+    // Create child node for the upper interval
+    NodeIndices new_start_indices = start_indices;
+    new_start_indices.idx[axis] = middle_idx;
+    node->upper_child_idx = create_sub_brick_tree_nodes(bricked_field, brick, level + 1, new_start_indices, end_indices, n_created_nodes);
+
+    const SubBrickTreeNode* const lower_child = brick->tree + lower_child_idx;
+    const SubBrickTreeNode* const upper_child = brick->tree + node->upper_child_idx;
+
+    node->min_value = fminf(lower_child->min_value, upper_child->min_value);
+    node->max_value = fmaxf(lower_child->max_value, upper_child->max_value);
+
+    return node_idx;
+}
+
+static void create_sub_brick_cells(const BrickedField* bricked_field, const Brick* brick, SubBrickCells* cells)
+{
+    /*
+    Divides the brick into a grid of small cubic cells and finds the value
+    limits of each. Adaptive splits are only made on cell boundaries, so the
+    value limits of any node, and of any candidate child, can be combined
+    from those of the cells without revisiting the brick data. The cells are
+    half the minimum sub brick size, which for an even minimum size leaves
+    every node that is large enough to be split at least one boundary to
+    split at.
+    */
+
+    assert(bricked_field);
+    assert(brick);
+    assert(cells);
+
+    const size_t sizes[3] = {brick->size_x, brick->size_y, brick->size_z};
+    const size_t size_limit = bricked_field->sub_brick_size_limit;
+    const size_t cell_size = (size_limit >= 4) ? size_limit/4 : 1;
+
+    cells->size_limit = size_limit;
+    cells->constant_brick_tolerance = bricked_field->constant_brick_tolerance;
+    cells->cell_size = cell_size;
+
+    size_t max_n_cells = 0;
+    unsigned int dim;
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        cells->n_cells[dim] = (sizes[dim] + cell_size - 1)/cell_size;
+        max_n_cells = (cells->n_cells[dim] > max_n_cells) ? cells->n_cells[dim] : max_n_cells;
+    }
+
+    const size_t n_cells = cells->n_cells[0]*cells->n_cells[1]*cells->n_cells[2];
+    const size_t n_layers = cells->n_cells[0] + cells->n_cells[1] + cells->n_cells[2];
+
+    // All the arrays share one allocation
+    float* const values = (float*)malloc(sizeof(float)*2*(n_cells + n_layers + max_n_cells));
+    check(values);
+
+    cells->min_values = values;
+    cells->max_values = values + n_cells;
+
+    float* layer_values = values + 2*n_cells;
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        cells->layer_min_values[dim] = layer_values;
+        cells->layer_max_values[dim] = layer_values + cells->n_cells[dim];
+        layer_values += 2*cells->n_cells[dim];
+    }
+
+    cells->prefix_min_values = layer_values;
+    cells->prefix_max_values = layer_values + max_n_cells;
+
+    const unsigned int* const permutation = brick_axis_permutations[brick->orientation];
+
+    size_t strides[3];
+    get_brick_data_strides(brick, strides);
+
+    // The brick is traversed in the order of its data, with the rows of each block of cells first being reduced to a
+    // single row, which is then divided between the cells
+    size_t memory_sizes[3];
+    size_t memory_strides[3];
+    size_t memory_cell_strides[3];
+    const size_t cell_strides[3] = {1, cells->n_cells[0], cells->n_cells[0]*cells->n_cells[1]};
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        memory_sizes[permutation[dim]] = sizes[dim];
+        memory_strides[permutation[dim]] = strides[dim];
+        memory_cell_strides[permutation[dim]] = cell_strides[dim];
+    }
+
+    assert(memory_strides[0] == 1);
+
+    const size_t row_length = memory_sizes[0];
+    float* const row_min_values = (float*)malloc(sizeof(float)*2*row_length);
+    check(row_min_values);
+    float* const row_max_values = row_min_values + row_length;
+
+    const size_t pad_offset = bricked_field->pad_size*(strides[0] + strides[1] + strides[2]);
+    const float* const float_data = (bricked_field->data_type == BRICK_DATA_FLOAT32) ? (const float*)brick->data : NULL;
+
+    size_t i, j, k, block_start_j, block_start_k, block_end_j, block_end_k, chunk_end, row_start_idx, cell_idx;
+    const float* row;
+    float value, chunk_min_value, chunk_max_value;
+
+    for (block_start_k = 0; block_start_k < memory_sizes[2]; block_start_k = block_end_k)
+    {
+        block_end_k = (block_start_k + cell_size < memory_sizes[2]) ? block_start_k + cell_size : memory_sizes[2];
+
+        for (block_start_j = 0; block_start_j < memory_sizes[1]; block_start_j = block_end_j)
+        {
+            block_end_j = (block_start_j + cell_size < memory_sizes[1]) ? block_start_j + cell_size : memory_sizes[1];
+
+            for (i = 0; i < row_length; i++)
+            {
+                row_min_values[i] = INFINITY;
+                row_max_values[i] = -INFINITY;
+            }
+
+            for (k = block_start_k; k < block_end_k; k++)
+                for (j = block_start_j; j < block_end_j; j++)
+                {
+                    row_start_idx = pad_offset + k*memory_strides[2] + j*memory_strides[1];
+
+                    if (float_data)
+                    {
+                        row = float_data + row_start_idx;
+
+                        for (i = 0; i < row_length; i++)
+                        {
+                            row_min_values[i] = fminf(row_min_values[i], row[i]);
+                            row_max_values[i] = fmaxf(row_max_values[i], row[i]);
+                        }
+                    }
+                    else
+                    {
+                        for (i = 0; i < row_length; i++)
+                        {
+                            value = get_brick_data_value(bricked_field, brick, row_start_idx + i);
+                            row_min_values[i] = fminf(row_min_values[i], value);
+                            row_max_values[i] = fmaxf(row_max_values[i], value);
+                        }
+                    }
+                }
+
+            cell_idx = (block_start_k/cell_size)*memory_cell_strides[2] + (block_start_j/cell_size)*memory_cell_strides[1];
+
+            for (i = 0; i < row_length; i = chunk_end, cell_idx += memory_cell_strides[0])
+            {
+                chunk_end = (i + cell_size < row_length) ? i + cell_size : row_length;
+
+                chunk_min_value = INFINITY;
+                chunk_max_value = -INFINITY;
+
+                for (; i < chunk_end; i++)
+                {
+                    chunk_min_value = fminf(chunk_min_value, row_min_values[i]);
+                    chunk_max_value = fmaxf(chunk_max_value, row_max_values[i]);
+                }
+
+                cells->min_values[cell_idx] = chunk_min_value;
+                cells->max_values[cell_idx] = chunk_max_value;
+            }
+        }
+    }
+
+    free(row_min_values);
+}
+
+static void destroy_sub_brick_cells(SubBrickCells* cells)
 {
-    assert(brick);
-    assert(field);
+    assert(cells);
 
-    const NodeIndices start_indices = {{0, 0, 0}};
-    const NodeIndices end_indices = {{brick->size_x, brick->size_y, brick->size_z}};
+    free(cells->min_values);
 
-    brick->tree = create_sub_brick_tree_nodes(brick, field, 0, start_indices, end_indices);
-    check(brick->tree);
+    cells->min_values = NULL;
+    cells->max_values = NULL;
 }
 
-static SubBrickTreeNode* create_sub_brick_tree_nodes(const Brick* brick, const Field* field, unsigned int level,
-                                                     NodeIndices start_indices, NodeIndices end_indices)
+static uint32_t create_adaptive_sub_brick_tree_nodes(Brick* brick, SubBrickCells* cells, unsigned int level,
+                                                     NodeIndices start_indices, NodeIndices end_indices, uint32_t* n_created_nodes)
 {
+    /*
+    Like create_sub_brick_tree_nodes, but places each split where it best
+    separates the values of the node, as judged from the cells. A node whose
+    values are all within the constant brick tolerance is not split further,
+    since no transfer function can make its parts differ in visibility.
+    */
+
     assert(brick);
-    assert(field);
+    assert(cells);
+    assert(n_created_nodes);
 
-    SubBrickTreeNode* node = create_sub_brick_tree_node(brick, field, start_indices, end_indices);
+    const uint32_t node_idx = *n_created_nodes;
+    SubBrickTreeNode* const node = add_sub_brick_tree_node(brick, start_indices, end_indices, n_created_nodes);
 
-    unsigned int axis = level % 3;
+    size_t start_cells[3];
+    size_t end_cells[3];
+    unsigned int dim;
 
-    // Advance the level until a divisible axis is found or return a leaf node if none is found
-    if (end_indices.idx[axis] - start_indices.idx[axis] < configuration.sub_brick_size_limit)
+    // Node regions always start on a cell boundary, and end on one or at the end of the brick
+    for (dim = 0; dim < 3; dim++)
     {
-        level++;
-        axis = level % 3;
+        start_cells[dim] = start_indices.idx[dim]/cells->cell_size;
+        end_cells[dim] = (end_indices.idx[dim] + cells->cell_size - 1)/cells->cell_size;
+    }
+
+    find_cell_layer_value_limits(cells, start_cells, end_cells, &node->min_value, &node->max_value);
+
+    const float value_range = node->max_value - node->min_value;
+
+    if (value_range <= cells->constant_brick_tolerance)
+        return node_idx;
+
+    unsigned int axis;
+    size_t split_idx;
+
+    if (!find_adaptive_sub_brick_split(cells, level, start_indices, end_indices, start_cells, end_cells, value_range, &axis, &split_idx))
+        return node_idx;
+
+    node->split_axis = (uint8_t)axis;
+
+    // The round-robin order of the fallback split axes continues after the axis that was split
+    NodeIndices new_end_indices = end_indices;
+    new_end_indices.idx[axis] = split_idx;
+    create_adaptive_sub_brick_tree_nodes(brick, cells, axis + 1, start_indices, new_end_indices, n_created_nodes);
+
+    NodeIndices new_start_indices = start_indices;
+    new_start_indices.idx[axis] = split_idx;
+    node->upper_child_idx = create_adaptive_sub_brick_tree_nodes(brick, cells, axis + 1, new_start_indices, end_indices, n_created_nodes);
+
+    return node_idx;
+}
+
+static void find_cell_layer_value_limits(SubBrickCells* cells, const size_t start_cells[3], const size_t end_cells[3],
+                                         float* min_value, float* max_value)
+{
+    /*
+    Finds the value limits of each layer of cells within the given range of
+    cells, along each of the three axes, as well as the limits of the whole
+    range.
+    */
+
+    assert(cells);
+    assert(min_value);
+    assert(max_value);
+
+    const size_t n_layers[3] = {end_cells[0] - start_cells[0], end_cells[1] - start_cells[1], end_cells[2] - start_cells[2]};
+
+    size_t i, j, k;
+    size_t layer_idx;
+    unsigned int dim;
+
+    for (dim = 0; dim < 3; dim++)
+        for (layer_idx = 0; layer_idx < n_layers[dim]; layer_idx++)
+        {
+            cells->layer_min_values[dim][layer_idx] = INFINITY;
+            cells->layer_max_values[dim][layer_idx] = -INFINITY;
+        }
 
-        if (end_indices.idx[axis] - start_indices.idx[axis] < configuration.sub_brick_size_limit)
+    float* const layer_min_values_x = cells->layer_min_values[0];
+    float* const layer_max_values_x = cells->layer_max_values[0];
+    float* const layer_min_values_y = cells->layer_min_values[1];
+    float* const layer_max_values_y = cells->layer_max_values[1];
+    float* const layer_min_values_z = cells->layer_min_values[2];
+    float* const layer_max_values_z = cells->layer_max_values[2];
+
+    size_t cell_idx;
+    float row_min_value, row_max_value;
+
+    for (k = 0; k < n_layers[2]; k++)
+        for (j = 0; j < n_layers[1]; j++)
         {
-            level++;
-            axis = level % 3;
+            cell_idx = ((start_cells[2] + k)*cells->n_cells[1] + start_cells[1] + j)*cells->n_cells[0] + start_cells[0];
 
-            if (end_indices.idx[axis] - start_indices.idx[axis] < configuration.sub_brick_size_limit)
+            row_min_value = INFINITY;
+            row_max_value = -INFINITY;
+
+            for (i = 0; i < n_layers[0]; i++)
             {
-                return node;
+                const float cell_min_value = cells->min_values[cell_idx + i];
+                const float cell_max_value = cells->max_values[cell_idx + i];
+
+                layer_min_values_x[i] = fminf(layer_min_values_x[i], cell_min_value);
+                layer_max_values_x[i] = fmaxf(layer_max_values_x[i], cell_max_value);
+
+                row_min_value = fminf(row_min_value, cell_min_value);
+                row_max_value = fmaxf(row_max_value, cell_max_value);
             }
+
+            layer_min_values_y[j] = fminf(layer_min_values_y[j], row_min_value);
+            layer_max_values_y[j] = fmaxf(layer_max_values_y[j], row_max_value);
+            layer_min_values_z[k] = fminf(layer_min_values_z[k], row_min_value);
+            layer_max_values_z[k] = fmaxf(layer_max_values_z[k], row_max_value);
         }
+
+    *min_value = INFINITY;
+    *max_value = -INFINITY;
+
+    for (k = 0; k < n_layers[2]; k++)
+    {
+        *min_value = fminf(*min_value, layer_min_values_z[k]);
+        *max_value = fmaxf(*max_value, layer_max_values_z[k]);
     }
+}
 
-    node->split_axis = axis;
+static int find_adaptive_sub_brick_split(SubBrickCells* cells, unsigned int level, NodeIndices start_indices, NodeIndices end_indices,
+                                         const size_t start_cells[3], const size_t end_cells[3], float value_range,
+                                         unsigned int* split_axis, size_t* split_idx)
+{
+    /*
+    Evaluates every cell boundary that leaves both parts of the node at least
+    the minimum sub brick size, and picks the one maximizing the volume-
+    weighted reduction in value range of the two parts compared to the node.
+    A part with a narrower value range is more likely to be culled by a
+    transfer function, and the more volume it covers, the more culling it
+    saves. Empty or uniform space is thereby cut away from structure as
+    tightly as the cells allow. If no boundary narrows the parts noticeably,
+    the node is split as close to its middle as possible along the first
+    divisible axis in round-robin order, as with midpoint splits, so that
+    structure that spans every layer is still subdivided. Returns 0 if the node cannot
+    be split along any axis. Expects the layer value limits of the node to
+    have been found.
+    */
 
-    // Subdivide along the current axis as close to the middle as possible (rounding down)
-    const size_t middle_idx = (size_t)(0.5f*(float)(start_indices.idx[axis] + end_indices.idx[axis]));
-    assert(middle_idx > start_indices.idx[axis] && end_indices.idx[axis] > middle_idx);
+    assert(cells);
+    assert(split_axis);
+    assert(split_idx);
 
-    // Create child node for the lower interval
-    NodeIndices new_end_indices = end_indices;
-    new_end_indices.idx[axis] = middle_idx;
-    node->lower_child = create_sub_brick_tree_nodes(brick, field, level + 1, start_indices, new_end_indices);
+    const size_t min_size = cells->size_limit/2;
+    const size_t sizes[3] = {end_indices.idx[0] - start_indices.idx[0],
+                             end_indices.idx[1] - start_indices.idx[1],
+                             end_indices.idx[2] - start_indices.idx[2]};
 
-    // Create child node for the upper interval
-    NodeIndices new_start_indices = start_indices;
-    new_start_indices.idx[axis] = middle_idx;
-    node->upper_child = create_sub_brick_tree_nodes(brick, field, level + 1, new_start_indices, end_indices);
+    float best_gain = 0;
+    int has_best_split = 0;
+    int has_fallback_split = 0;
+    unsigned int fallback_axis = 0;
+    size_t fallback_idx = 0;
+    size_t fallback_offset = 0;
 
-    node->n_children = 2 + node->lower_child->n_children + node->upper_child->n_children;
+    unsigned int n;
+    size_t layer_idx;
 
-    return node;
+    for (n = 0; n < 3; n++)
+    {
+        const unsigned int axis = (level + n) % 3;
+
+        if (sizes[axis] < cells->size_limit)
+            continue;
+
+        const size_t n_layers = end_cells[axis] - start_cells[axis];
+        const float* const layer_min_values = cells->layer_min_values[axis];
+        const float* const layer_max_values = cells->layer_max_values[axis];
+
+        // Each layer of the node along the axis covers this many voxels per voxel of thickness
+        const float layer_area = (float)(sizes[0]*sizes[1]*sizes[2]/sizes[axis]);
+
+        cells->prefix_min_values[0] = layer_min_values[0];
+        cells->prefix_max_values[0] = layer_max_values[0];
+
+        for (layer_idx = 1; layer_idx < n_layers; layer_idx++)
+        {
+            cells->prefix_min_values[layer_idx] = fminf(cells->prefix_min_values[layer_idx - 1], layer_min_values[layer_idx]);
+            cells->prefix_max_values[layer_idx] = fmaxf(cells->prefix_max_values[layer_idx - 1], layer_max_values[layer_idx]);
+        }
+
+        float upper_min_value = INFINITY;
+        float upper_max_value = -INFINITY;
+
+        // Sweep the boundaries from the upper end, accumulating the value limits of the upper part
+        for (layer_idx = n_layers - 1; layer_idx > 0; layer_idx--)
+        {
+            upper_min_value = fminf(upper_min_value, layer_min_values[layer_idx]);
+            upper_max_value = fmaxf(upper_max_value, layer_max_values[layer_idx]);
+
+            const size_t idx = (start_cells[axis] + layer_idx)*cells->cell_size;
+            const size_t lower_size = idx - start_indices.idx[axis];
+            const size_t upper_size = end_indices.idx[axis] - idx;
+
+            if (lower_size < min_size || upper_size < min_size)
+                continue;
+
+            const float lower_range = cells->prefix_max_values[layer_idx - 1] - cells->prefix_min_values[layer_idx - 1];
+            const float upper_range = upper_max_value - upper_min_value;
+
+            const float gain = layer_area*((float)lower_size*(value_range - lower_range) + (float)upper_size*(value_range - upper_range));
+
+            if (gain > best_gain)
+            {
+                best_gain = gain;
+                has_best_split = 1;
+                *split_axis = axis;
+                *split_idx = idx;
+            }
+
+            // The offset from the middle is measured in half voxels to stay integral
+            const size_t offset_from_middle = (lower_size > upper_size) ? lower_size - upper_size : upper_size - lower_size;
+
+            if (!has_fallback_split || (fallback_axis == axis && offset_from_middle < fallback_offset))
+            {
+                has_fallback_split = 1;
+                fallback_axis = axis;
+                fallback_idx = idx;
+                fallback_offset = offset_from_middle;
+            }
+        }
+    }
+
+    if (has_best_split && best_gain > MIN_ADAPTIVE_SPLIT_GAIN*value_range*(float)(sizes[0]*sizes[1]*sizes[2]))
+        return 1;
+
+    if (!has_fallback_split)
+        return 0;
+
+    *split_axis = fallback_axis;
+    *split_idx = fallback_idx;
+
+    return 1;
 }
 
-static SubBrickTreeNode* create_sub_brick_tree_node(const Brick* brick, const Field* field,
-                                                    NodeIndices start_indices, NodeIndices end_indices)
+static void find_brick_region_value_limits(const BrickedField* bricked_field, const Brick* brick,
+                                           NodeIndices start_indices, NodeIndices end_indices, float* min_value, float* max_value)
 {
-    SubBrickTreeNode* node = (SubBrickTreeNode*)malloc(sizeof(SubBrickTreeNode));
+    /*
+    Finds the smallest and largest normalized value in the given region of the
+    brick, with indices relative to the unpadded brick.
+    */
 
-    node->lower_child = NULL;
-    node->upper_child = NULL;
-    node->split_axis = 0;
-    node->n_children = 0;
+    assert(bricked_field);
+    assert(brick);
+    assert(min_value);
+    assert(max_value);
 
-    node->offset_x = brick->offset_x + start_indices.idx[0];
-    node->offset_y = brick->offset_y + start_indices.idx[1];
-    node->offset_z = brick->offset_z + start_indices.idx[2];
+    if (brick->is_constant)
+    {
+        *min_value = brick->constant_value;
+        *max_value = brick->constant_value;
+        return;
+    }
 
-    node->size_x = end_indices.idx[0] - start_indices.idx[0];
-    node->size_y = end_indices.idx[1] - start_indices.idx[1];
-    node->size_z = end_indices.idx[2] - start_indices.idx[2];
+    // The region is traversed in the order of the brick data, so that every row of values is contiguous
+    size_t memory_sizes[3];
+    size_t memory_strides[3];
+    const size_t offset = get_brick_region_memory_layout(bricked_field, brick, start_indices, end_indices, memory_sizes, memory_strides);
 
-    set_vector3f_elements(&node->spatial_offset,
-                          brick->spatial_offset.a[0] + (float)start_indices.idx[0]*field->voxel_width,
-                          brick->spatial_offset.a[1] + (float)start_indices.idx[1]*field->voxel_height,
-                          brick->spatial_offset.a[2] + (float)start_indices.idx[2]*field->voxel_depth);
+    *min_value = INFINITY;
+    *max_value = -INFINITY;
 
-    set_vector3f_elements(&node->spatial_extent,
-                          (float)node->size_x*field->voxel_width,
-                          (float)node->size_y*field->voxel_height,
-                          (float)node->size_z*field->voxel_depth);
+    if (bricked_field->data_type == BRICK_DATA_FLOAT32)
+    {
+        find_float_region_limits((const float*)brick->data + offset, memory_sizes, memory_strides, min_value, max_value);
+    }
+    else
+    {
+        size_t j, k;
+        for (k = 0; k < memory_sizes[2]; k++)
+            for (j = 0; j < memory_sizes[1]; j++)
+                update_value_limits_for_row(bricked_field, brick, offset + k*memory_strides[2] + j*memory_strides[1], memory_sizes[0],
+                                            min_value, max_value);
+    }
+}
 
-    node->visibility_ratio = 1.0f;
-    node->visibility = UNDETERMINED_REGION_VISIBILITY;
+static size_t get_brick_region_memory_layout(const BrickedField* bricked_field, const Brick* brick,
+                                             NodeIndices start_indices, NodeIndices end_indices,
+                                             size_t memory_sizes[3], size_t memory_strides[3])
+{
+    /*
+    Finds the sizes of the given region of the brick and the strides between
+    its voxels along the axes of the brick data, from fastest to slowest
+    varying, and returns the index of the first voxel of the region in the
+    brick data.
+    */
 
-    return node;
+    assert(bricked_field);
+    assert(brick);
+    assert(memory_sizes);
+    assert(memory_strides);
+
+    const unsigned int* const permutation = brick_axis_permutations[brick->orientation];
+
+    size_t strides[3];
+    get_brick_data_strides(brick, strides);
+
+    unsigned int dim;
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        memory_sizes[permutation[dim]] = end_indices.idx[dim] - start_indices.idx[dim];
+        memory_strides[permutation[dim]] = strides[dim];
+    }
+
+    assert(memory_strides[0] == 1);
+
+    // The padded brick data starts pad_size voxels before the brick offset along every axis
+    return (start_indices.idx[0] + bricked_field->pad_size)*strides[0] +
+           (start_indices.idx[1] + bricked_field->pad_size)*strides[1] +
+           (start_indices.idx[2] + bricked_field->pad_size)*strides[2];
 }
 
-static void destroy_brick_tree(BrickedField* bricked_field)
+static void update_value_limits_for_row(const BrickedField* bricked_field, const Brick* brick, size_t start_idx, size_t length,
+                                        float* min_value, float* max_value)
 {
+    /*
+    Widens the given value limits to include the normalized values of the
+    given contiguous range of the brick data. The integer types are compared
+    before they are converted, so only the limits need converting.
+    */
+
     assert(bricked_field);
+    assert(brick);
+    assert(min_value);
+    assert(max_value);
 
-    if (bricked_field->tree)
-        destroy_brick_tree_node(bricked_field->tree);
+    size_t idx;
 
-    bricked_field->tree = NULL;
+    if (bricked_field->data_type == BRICK_DATA_UINT16 || bricked_field->data_type == BRICK_DATA_UINT8)
+    {
+        unsigned int min_integer = UINT16_MAX;
+        unsigned int max_integer = 0;
+
+        if (bricked_field->data_type == BRICK_DATA_UINT16)
+        {
+            const uint16_t* const values = (const uint16_t*)brick->data + start_idx;
+
+            for (idx = 0; idx < length; idx++)
+            {
+                min_integer = (values[idx] < min_integer) ? values[idx] : min_integer;
+                max_integer = (values[idx] > max_integer) ? values[idx] : max_integer;
+            }
+        }
+        else
+        {
+            const uint8_t* const values = (const uint8_t*)brick->data + start_idx;
+
+            for (idx = 0; idx < length; idx++)
+            {
+                min_integer = (values[idx] < min_integer) ? values[idx] : min_integer;
+                max_integer = (values[idx] > max_integer) ? values[idx] : max_integer;
+            }
+        }
+
+        const float norm = 1.0f/(float)((bricked_field->data_type == BRICK_DATA_UINT16) ? UINT16_MAX : UINT8_MAX);
+
+        *min_value = fminf(*min_value, (float)min_integer*norm);
+        *max_value = fmaxf(*max_value, (float)max_integer*norm);
+    }
+    else
+    {
+        for (idx = 0; idx < length; idx++)
+        {
+            const float value = get_brick_data_value(bricked_field, brick, start_idx + idx);
+            *min_value = fminf(*min_value, value);
+            *max_value = fmaxf(*max_value, value);
+        }
+    }
 }
 
-static void destroy_brick_tree_node(BrickTreeNode* node)
+static void find_float_region_limits(const float* data, const size_t sizes[3], const size_t strides[3], float* min_value, float* max_value)
 {
-    assert(node);
+    /*
+    Finds the smallest and largest value in a 3D region of a float array. The
+    region has the given sizes and strides, and its rows (along the first
+    axis) are contiguous. Since the rows of sub bricks are short, the AVX
+    version keeps its running limits in vector registers across rows, and
+    only reduces them at the end.
+    */
+
+    assert(data);
+    assert(strides[0] == 1);
+    assert(min_value);
+    assert(max_value);
+
+    const size_t row_length = sizes[0];
+    const float* row;
+    size_t i, j, k;
+
+    float region_min_value = INFINITY;
+    float region_max_value = -INFINITY;
+
+#if defined(__AVX__)
+
+    // Loading from this table at an offset gives a mask selecting the first n lanes
+    static const int32_t lane_masks[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    if (row_length > 0)
+    {
+        __m256 min_values = _mm256_set1_ps(INFINITY);
+        __m256 max_values = _mm256_set1_ps(-INFINITY);
+        __m256 values;
+
+        const __m256i tail_mask = _mm256_loadu_si256((const __m256i*)(lane_masks + 8 - (row_length % 8)));
+
+        for (k = 0; k < sizes[2]; k++)
+            for (j = 0; j < sizes[1]; j++)
+            {
+                row = data + k*strides[2] + j*strides[1];
+
+                for (i = 0; i + 8 <= row_length; i += 8)
+                {
+                    values = _mm256_loadu_ps(row + i);
+                    min_values = _mm256_min_ps(min_values, values);
+                    max_values = _mm256_max_ps(max_values, values);
+                }
+
+                if (i == row_length)
+                    continue;
+
+                if (row_length >= 8)
+                {
+                    // Including some values twice does not change the limits, so the last 8 values are simply reloaded
+                    values = _mm256_loadu_ps(row + row_length - 8);
+                    min_values = _mm256_min_ps(min_values, values);
+                    max_values = _mm256_max_ps(max_values, values);
+                }
+                else
+                {
+                    // Only the lanes inside the row take part, since the masked lanes are loaded as zero
+                    values = _mm256_maskload_ps(row, tail_mask);
+                    min_values = _mm256_blendv_ps(min_values, _mm256_min_ps(min_values, values), _mm256_castsi256_ps(tail_mask));
+                    max_values = _mm256_blendv_ps(max_values, _mm256_max_ps(max_values, values), _mm256_castsi256_ps(tail_mask));
+                }
+            }
+
+        float lane_values[8];
+        unsigned int lane_idx;
+
+        _mm256_storeu_ps(lane_values, min_values);
+        for (lane_idx = 0; lane_idx < 8; lane_idx++)
+            region_min_value = fminf(region_min_value, lane_values[lane_idx]);
+
+        _mm256_storeu_ps(lane_values, max_values);
+        for (lane_idx = 0; lane_idx < 8; lane_idx++)
+            region_max_value = fmaxf(region_max_value, lane_values[lane_idx]);
+    }
+
+#else
 
-    if (node->brick)
-        destroy_sub_brick_tree(node->brick);
+    for (k = 0; k < sizes[2]; k++)
+        for (j = 0; j < sizes[1]; j++)
+        {
+            row = data + k*strides[2] + j*strides[1];
+
+            for (i = 0; i < row_length; i++)
+            {
+                region_min_value = fminf(region_min_value, row[i]);
+                region_max_value = fmaxf(region_max_value, row[i]);
+            }
+        }
+
+#endif
+
+    *min_value = fminf(*min_value, region_min_value);
+    *max_value = fmaxf(*max_value, region_max_value);
+}
 
-    if (node->lower_child)
-        destroy_brick_tree_node(node->lower_child);
+static size_t find_brick_tree_nodes_in_value_range(const BrickedField* bricked_field, uint32_t node_idx,
+                                                   float lower_value, float upper_value, size_t* brick_indices, size_t n_found)
+{
+    assert(bricked_field);
+
+    const BrickTreeNode* const node = bricked_field->tree + node_idx;
+
+    if (node->max_value < lower_value || node->min_value > upper_value)
+        return n_found;
 
-    if (node->upper_child)
-        destroy_brick_tree_node(node->upper_child);
+    if (node->upper_child_idx == 0)
+    {
+        if (brick_indices)
+            brick_indices[n_found] = node->brick_idx;
+
+        return n_found + 1;
+    }
 
-    free(node);
+    n_found = find_brick_tree_nodes_in_value_range(bricked_field, node_idx + 1, lower_value, upper_value, brick_indices, n_found);
+    return find_brick_tree_nodes_in_value_range(bricked_field, node->upper_child_idx, lower_value, upper_value, brick_indices, n_found);
 }
 
-static void destroy_sub_brick_tree(Brick* brick)
+static size_t find_sub_brick_tree_nodes_in_value_range(const Brick* brick, uint32_t node_idx,
+                                                       float lower_value, float upper_value, uint32_t* node_indices, size_t n_found)
 {
     assert(brick);
 
-    if (brick->tree)
-        destroy_sub_brick_tree_node(brick->tree);
+    const SubBrickTreeNode* const node = brick->tree + node_idx;
+
+    if (node->max_value < lower_value || node->min_value > upper_value)
+        return n_found;
 
-    brick->tree = NULL;
+    if (node->upper_child_idx == 0)
+    {
+        if (node_indices)
+            node_indices[n_found] = node_idx;
+
+        return n_found + 1;
+    }
+
+    n_found = find_sub_brick_tree_nodes_in_value_range(brick, node_idx + 1, lower_value, upper_value, node_indices, n_found);
+    return find_sub_brick_tree_nodes_in_value_range(brick, node->upper_child_idx, lower_value, upper_value, node_indices, n_found);
 }
 
-static void destroy_sub_brick_tree_node(SubBrickTreeNode* node)
+static void destroy_brick_trees(BrickedField* bricked_field)
 {
-    assert(node);
+    assert(bricked_field);
+
+    // All the trees and their leaf histograms are stored in single arrays, so no traversal is needed to free them
+    if (bricked_field->tree)
+        free(bricked_field->tree);
 
-    if (node->lower_child)
-        destroy_sub_brick_tree_node(node->lower_child);
+    if (bricked_field->tree_visibility_ratios)
+        free(bricked_field->tree_visibility_ratios);
 
-    if (node->upper_child)
-        destroy_sub_brick_tree_node(node->upper_child);
+    if (bricked_field->tree_lod_brick_indices)
+        free(bricked_field->tree_lod_brick_indices);
 
-    free(node);
+    if (bricked_field->sub_brick_tree_nodes)
+        free(bricked_field->sub_brick_tree_nodes);
+
+    if (bricked_field->sub_brick_visibility_ratios)
+        free(bricked_field->sub_brick_visibility_ratios);
+
+    if (bricked_field->sub_brick_histogram_starts)
+        free(bricked_field->sub_brick_histogram_starts);
+
+    if (bricked_field->histogram_entries)
+        free(bricked_field->histogram_entries);
+
+    bricked_field->tree = NULL;
+    bricked_field->n_tree_nodes = 0;
+    bricked_field->tree_visibility_ratios = NULL;
+    bricked_field->tree_lod_brick_indices = NULL;
+    bricked_field->sub_brick_tree_nodes = NULL;
+    bricked_field->n_sub_brick_tree_nodes = 0;
+    bricked_field->sub_brick_visibility_ratios = NULL;
+    bricked_field->sub_brick_histogram_starts = NULL;
+    bricked_field->histogram_entries = NULL;
+    bricked_field->n_histogram_entries = 0;
 }
 
 static void create_boundary_indicator_for_field(BrickedField* bricked_field)
@@ -829,13 +4034,7 @@ static void create_boundary_indicator_for_sub_bricks(BrickedField* bricked_field
     check(bricked_field);
 
     size_t brick_idx;
-    size_t n_sub_bricks = 0;
-
-    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
-    {
-        const Brick* const brick = bricked_field->bricks + brick_idx;
-        n_sub_bricks += 1 + brick->tree->n_children;
-    }
+    const size_t n_sub_bricks = bricked_field->n_sub_brick_tree_nodes;
 
     const DynamicString name = create_string("sub_brick_boundaries_%d", sub_brick_boundary_indicator_count++);
     Indicator* const indicator = create_indicator(&name, 8*n_sub_bricks, 24*n_sub_bricks);
@@ -846,7 +4045,7 @@ static void create_boundary_indicator_for_sub_bricks(BrickedField* bricked_field
     for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
     {
         Brick* const brick = bricked_field->bricks + brick_idx;
-        set_sub_brick_boundary_indicator_data(indicator, brick->tree, &vertex_idx, &index_idx);
+        set_sub_brick_boundary_indicator_data(indicator, bricked_field, brick, &vertex_idx, &index_idx);
     }
 
     set_vertex_colors_for_indicator(indicator, 0, indicator->n_vertices, &sub_brick_boundary_color);
@@ -856,63 +4055,67 @@ static void create_boundary_indicator_for_sub_bricks(BrickedField* bricked_field
     bricked_field->sub_brick_boundary_indicator_name = indicator->name.chars;
 }
 
-static void set_sub_brick_boundary_indicator_data(Indicator* indicator, SubBrickTreeNode* node, size_t* running_vertex_idx, size_t* running_index_idx)
+static void set_sub_brick_boundary_indicator_data(Indicator* indicator, const BrickedField* bricked_field, Brick* brick,
+                                                  size_t* running_vertex_idx, size_t* running_index_idx)
 {
     assert(indicator);
-    assert(node);
+    assert(brick);
     assert(running_vertex_idx);
     assert(running_index_idx);
 
-    if (node->lower_child)
-        set_sub_brick_boundary_indicator_data(indicator, node->lower_child, running_vertex_idx, running_index_idx);
+    Vector3f spatial_offset;
+    Vector3f spatial_extent;
+    size_t node_idx;
 
-    if (node->upper_child)
-        set_sub_brick_boundary_indicator_data(indicator, node->upper_child, running_vertex_idx, running_index_idx);
+    for (node_idx = 0; node_idx < brick->n_tree_nodes; node_idx++)
+    {
+        SubBrickTreeNode* const node = brick->tree + node_idx;
+
+        get_sub_brick_tree_node_box(bricked_field, brick, node, &spatial_offset, &spatial_extent);
 
-    node->indicator_idx = *running_index_idx;
-    set_cube_edges_for_indicator(indicator, *running_vertex_idx, running_index_idx);
-    set_cube_vertex_positions_for_indicator(indicator, running_vertex_idx, &node->spatial_offset, &node->spatial_extent);
+        node->indicator_idx = (uint32_t)(*running_index_idx);
+        set_cube_edges_for_indicator(indicator, *running_vertex_idx, running_index_idx);
+        set_cube_vertex_positions_for_indicator(indicator, running_vertex_idx, &spatial_offset, &spatial_extent);
+    }
 }
 
-static void draw_brick_boundaries(const BrickTreeNode* node)
+static void draw_brick_boundaries(const BrickedField* bricked_field, uint32_t node_idx)
 {
-    assert(node);
+    assert(bricked_field);
+
+    const BrickTreeNode* const node = bricked_field->tree + node_idx;
 
     if (node->visibility == REGION_INVISIBLE || node->visibility == REGION_CLIPPED)
         return;
 
-    if (node->brick)
+    if (node->upper_child_idx == 0)
     {
-        draw_sub_brick_boundaries(node->brick->tree);
+        draw_sub_brick_boundaries(bricked_field->bricks + node->brick_idx, 0);
     }
     else
     {
-        if (node->lower_child)
-            draw_brick_boundaries(node->lower_child);
-
-        if (node->upper_child)
-            draw_brick_boundaries(node->upper_child);
+        draw_brick_boundaries(bricked_field, node_idx + 1);
+        draw_brick_boundaries(bricked_field, node->upper_child_idx);
     }
 }
 
-static void draw_sub_brick_boundaries(const SubBrickTreeNode* node)
+static void draw_sub_brick_boundaries(const Brick* brick, uint32_t node_idx)
 {
-    assert(node);
+    assert(brick);
+
+    const SubBrickTreeNode* const node = brick->tree + node_idx;
 
     if (node->visibility == REGION_INVISIBLE || node->visibility == REGION_CLIPPED)
         return;
 
     if (node->visibility == REGION_VISIBLE)
     {
-        glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, (GLvoid*)(node->indicator_idx*sizeof(unsigned int)));
+        glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, (GLvoid*)((size_t)node->indicator_idx*sizeof(unsigned int)));
         abort_on_GL_error("Could not draw indicator");
     }
-    else
+    else if (node->upper_child_idx != 0)
     {
-        if (node->lower_child)
-            draw_sub_brick_boundaries(node->lower_child);
-
-        if (node->upper_child)
-            draw_sub_brick_boundaries(node->upper_child);
+        draw_sub_brick_boundaries(brick, node_idx + 1);
+        draw_sub_brick_boundaries(brick, node->upper_child_idx);
     }
 }
@@ -3,6 +3,7 @@
 #include "error.h"
 
 #include <math.h>
+#include <string.h>
 
 
 const double PI = 3.14159265358979323846;
@@ -60,6 +61,101 @@ float clamp(float x, float lower, float upper)
     return (x > lower) ? ((x < upper) ? x : upper) : lower;
 }
 
+float half_to_float(uint16_t half)
+{
+    // Converts the bits of an IEEE 754 half precision value to a single precision value
+    const uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    uint32_t exponent = (uint32_t)(half >> 10) & 0x1Fu;
+    uint32_t mantissa = (uint32_t)half & 0x3FFu;
+    uint32_t bits;
+
+    if (exponent == 0x1F)
+    {
+        // Infinity or NaN
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    }
+    else if (exponent > 0)
+    {
+        // Normal value, only the exponent bias differs
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        // Signed zero
+        bits = sign;
+    }
+    else
+    {
+        // Subnormal half values are normal in single precision, so shift until the implicit bit is set
+        exponent = 113;
+
+        while (!(mantissa & 0x400u))
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+
+    return value;
+}
+
+uint16_t float_to_half(float value)
+{
+    // Converts a single precision value to the bits of the nearest IEEE 754 half precision value (ties to even)
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const int exponent = (int)((bits >> 23) & 0xFFu) - 112;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+    uint32_t half;
+    uint32_t remainder;
+    uint32_t halfway;
+
+    if (exponent == 0xFF - 112)
+    {
+        // Infinity or NaN, keeping NaNs quiet
+        return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u | (mantissa >> 13) : 0));
+    }
+    else if (exponent >= 0x1F)
+    {
+        // Too large, so overflow to infinity
+        return (uint16_t)(sign | 0x7C00u);
+    }
+    else if (exponent > 0)
+    {
+        // Normal value, only the exponent bias differs
+        half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+        remainder = mantissa & 0x1FFFu;
+        halfway = 0x1000u;
+    }
+    else if (exponent >= -10)
+    {
+        // Subnormal half value, so the implicit bit becomes part of the shifted mantissa
+        const unsigned int shift = (unsigned int)(14 - exponent);
+        mantissa |= 0x800000u;
+        half = sign | (mantissa >> shift);
+        remainder = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    }
+    else
+    {
+        // Too small, so underflow to signed zero
+        return (uint16_t)sign;
+    }
+
+    // A carry out of the mantissa correctly increments the exponent
+    if (remainder > halfway || (remainder == halfway && (half & 1u)))
+        half++;
+
+    return (uint16_t)half;
+}
+
 size_t pow2_size_t(unsigned int exponent)
 {
     return 1u << (size_t)exponent;
@@ -0,0 +1,205 @@
+/*
+ * Fields can be loaded and bricked on background threads, so that the render
+ * loop stays responsive while large fields are being read. Only the CPU work
+ * is done in the background. The loaded field is added to the collection of
+ * fields, and its bricks are transferred to the GPU, when the main thread
+ * finishes the loading.
+ */
+
+#include "field_loading.h"
+
+#include "error.h"
+#include "dynamic_string.h"
+#include "fields.h"
+#include "threads.h"
+
+
+#define MAX_FIELD_LOADINGS 16
+
+
+typedef struct FieldLoading
+{
+    size_t id;
+    BackgroundThread thread;
+    DynamicString field_name;
+    DynamicString data_filename;
+    DynamicString header_filename;
+    FieldConfiguration field_configuration;
+    BinaryFileReadingConfiguration reading_configuration;
+    BrickingConfiguration bricking_configuration;
+    Field field;
+    BrickedField bricked_field;
+} FieldLoading;
+
+
+static FieldLoading* get_field_loading(size_t loading_id);
+static void load_bricked_field_in_background(void* field_loading_ptr);
+static void clear_field_loading(FieldLoading* field_loading);
+
+
+// Loadings are stored in a fixed array since their background threads refer to them by address
+static FieldLoading field_loadings[MAX_FIELD_LOADINGS];
+
+static size_t next_loading_id;
+
+
+void initialize_field_loading(void)
+{
+    size_t idx;
+
+    for (idx = 0; idx < MAX_FIELD_LOADINGS; idx++)
+    {
+        field_loadings[idx].id = 0;
+        reset_background_thread(&field_loadings[idx].thread);
+    }
+
+    next_loading_id = 1;
+}
+
+size_t start_loading_bricked_field_from_bifrost_file(const char* field_name, const char* data_filename, const char* header_filename)
+{
+    /*
+    Starts loading and bricking the given Bifrost field on a background thread.
+    Returns an ID that can be used to poll whether the loading has finished,
+    and to finish or discard it.
+    */
+
+    check(field_name);
+    check(data_filename);
+    check(header_filename);
+
+    FieldLoading* field_loading = NULL;
+    size_t idx;
+
+    for (idx = 0; idx < MAX_FIELD_LOADINGS; idx++)
+    {
+        if (field_loadings[idx].id == 0)
+        {
+            field_loading = field_loadings + idx;
+            break;
+        }
+    }
+
+    if (!field_loading)
+        print_severe_message("Cannot load more than %d fields concurrently.", MAX_FIELD_LOADINGS);
+
+    field_loading->id = next_loading_id++;
+    field_loading->field_name = create_string("%s", field_name);
+    field_loading->data_filename = create_string("%s", data_filename);
+    field_loading->header_filename = create_string("%s", header_filename);
+
+    // The configurations are copied here, since the main thread may modify them while the loading runs
+    field_loading->field_configuration = get_field_configuration();
+    field_loading->reading_configuration = get_binary_file_reading_configuration();
+    field_loading->bricking_configuration = get_bricking_configuration();
+
+    reset_bricked_field(&field_loading->bricked_field);
+
+    start_background_thread(&field_loading->thread, load_bricked_field_in_background, field_loading);
+
+    return field_loading->id;
+}
+
+int bricked_field_loading_has_finished(size_t loading_id)
+{
+    return background_thread_has_finished(&get_field_loading(loading_id)->thread);
+}
+
+const char* finish_loading_bricked_field(size_t loading_id, BrickedField* bricked_field)
+{
+    /*
+    Waits for the given loading to complete if necessary, adds the loaded field
+    to the collection of fields and hands the bricked field over to the caller.
+    The bricked field still needs its indicators and textures to be created on
+    the main thread. Returns the name of the added field.
+    */
+
+    check(bricked_field);
+
+    FieldLoading* const field_loading = get_field_loading(loading_id);
+
+    join_background_thread(&field_loading->thread);
+
+    const char* const field_name = add_detached_field(&field_loading->field);
+
+    *bricked_field = field_loading->bricked_field;
+    bricked_field->field = get_field(field_name);
+
+    reset_bricked_field(&field_loading->bricked_field);
+
+    clear_field_loading(field_loading);
+
+    return field_name;
+}
+
+void discard_bricked_field_loading(size_t loading_id)
+{
+    FieldLoading* const field_loading = get_field_loading(loading_id);
+
+    join_background_thread(&field_loading->thread);
+
+    // The bricked field has no indicators or textures yet, so this involves no GL calls
+    destroy_bricked_field(&field_loading->bricked_field);
+    clear_detached_field(&field_loading->field);
+
+    clear_field_loading(field_loading);
+}
+
+void cleanup_field_loading(void)
+{
+    size_t idx;
+
+    for (idx = 0; idx < MAX_FIELD_LOADINGS; idx++)
+    {
+        if (field_loadings[idx].id != 0)
+            discard_bricked_field_loading(field_loadings[idx].id);
+    }
+}
+
+static FieldLoading* get_field_loading(size_t loading_id)
+{
+    check(loading_id > 0);
+
+    size_t idx;
+
+    for (idx = 0; idx < MAX_FIELD_LOADINGS; idx++)
+    {
+        if (field_loadings[idx].id == loading_id)
+            return field_loadings + idx;
+    }
+
+    print_severe_message("Could not find field loading %d.", loading_id);
+
+    return NULL;
+}
+
+static void load_bricked_field_in_background(void* field_loading_ptr)
+{
+    FieldLoading* const field_loading = (FieldLoading*)field_loading_ptr;
+    assert(field_loading);
+
+    const double start_time = get_wall_clock_time();
+
+    create_detached_field_from_bifrost_file(&field_loading->field,
+                                            field_loading->field_name.chars,
+                                            field_loading->data_filename.chars,
+                                            field_loading->header_filename.chars,
+                                            &field_loading->field_configuration,
+                                            &field_loading->reading_configuration);
+
+    build_bricked_field(&field_loading->bricked_field, &field_loading->field, &field_loading->bricking_configuration);
+
+    print_info_message("Loaded and bricked field \"%s\" in the background in %.2f s.",
+                       field_loading->field_name.chars, get_wall_clock_time() - start_time);
+}
+
+static void clear_field_loading(FieldLoading* field_loading)
+{
+    assert(field_loading);
+
+    clear_string(&field_loading->field_name);
+    clear_string(&field_loading->data_filename);
+    clear_string(&field_loading->header_filename);
+
+    field_loading->id = 0;
+}
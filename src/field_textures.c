@@ -21,6 +21,8 @@ typedef struct FieldTexture
 
 static FieldTexture* get_field_texture(const char* name);
 static void transfer_scalar_field_texture(FieldTexture* field_texture);
+static void create_brick_texture(FieldTexture* field_texture, GLuint* texture_id, const size_t padded_size[3], const void* data,
+                                 GLint internal_format, GLenum type, GLint wrap_mode);
 static void clear_field_texture(FieldTexture* field_texture);
 static void clear_field_texture_field(FieldTexture* field_texture);
 
@@ -62,6 +64,17 @@ void set_field_texture_field(const char* name, Field* field)
 
     FieldTexture* const field_texture = get_field_texture(name);
 
+    // A field whose data has been released after bricking, and that cannot be streamed from its
+    // source file, can only be bricked anew from its existing bricks
+    if (field_texture->bricked_field.field == field && !field_values_can_be_read(field))
+    {
+        BrickedField bricked_field;
+        reset_bricked_field(&bricked_field);
+        rebuild_bricked_field(&bricked_field, &field_texture->bricked_field);
+        set_field_texture_bricked_field(name, &bricked_field);
+        return;
+    }
+
     if (field_texture->bricked_field.field)
         clear_field_texture_field(field_texture);
 
@@ -70,6 +83,31 @@ void set_field_texture_field(const char* name, Field* field)
     transfer_scalar_field_texture(field_texture);
 }
 
+void set_field_texture_bricked_field(const char* name, BrickedField* bricked_field)
+{
+    /*
+    Takes over a bricked field that has already been built (possibly on another
+    thread), and performs the remaining GL work of creating its indicators and
+    transferring its bricks to textures. The given bricked field is left reset.
+    */
+
+    check(bricked_field);
+    check(bricked_field->field);
+    check(active_shader_program);
+
+    FieldTexture* const field_texture = get_field_texture(name);
+
+    if (field_texture->bricked_field.field)
+        clear_field_texture_field(field_texture);
+
+    field_texture->bricked_field = *bricked_field;
+    reset_bricked_field(bricked_field);
+
+    create_bricked_field_indicators(&field_texture->bricked_field);
+    field_texture->bricked_field.texture_unit = field_texture->texture->unit;
+    transfer_scalar_field_texture(field_texture);
+}
+
 BrickedField* get_field_texture_bricked_field(const char* name)
 {
     FieldTexture* const field_texture = get_field_texture(name);
@@ -149,8 +187,8 @@ static void transfer_scalar_field_texture(FieldTexture* field_texture)
     if (field->type != SCALAR_FIELD)
         print_severe_message("Cannot create scalar texture from non-scalar field type.");
 
-    if (!field->data)
-        print_severe_message("Cannot create texture with NULL data pointer.");
+    if (!bricked_field->bricks)
+        print_severe_message("Cannot create texture without bricks.");
 
     if (field->size_x == 0 || field->size_y == 0 || field->size_z == 0)
         print_severe_message("Cannot create texture with size 0 along any dimension.");
@@ -160,46 +198,100 @@ static void transfer_scalar_field_texture(FieldTexture* field_texture)
         field->size_z > GL_MAX_3D_TEXTURE_SIZE)
         print_severe_message("Cannot create texture with size exceeding %d along any dimension.", GL_MAX_3D_TEXTURE_SIZE);
 
+    // The integer formats are normalized by GL, so the shaders sample the same [0, 1] values for every data type
+    GLint internal_format;
+    GLenum type;
+
+    switch (bricked_field->data_type)
+    {
+        case BRICK_DATA_UINT16:
+            internal_format = GL_R16;
+            type = GL_UNSIGNED_SHORT;
+            break;
+        case BRICK_DATA_UINT8:
+            internal_format = GL_R8;
+            type = GL_UNSIGNED_BYTE;
+            break;
+        case BRICK_DATA_FLOAT16:
+            internal_format = GL_R16F;
+            type = GL_HALF_FLOAT;
+            break;
+        default:
+            internal_format = GL_RED;
+            type = GL_FLOAT;
+            break;
+    }
+
     glActiveTexture(GL_TEXTURE0 + field_texture->texture->unit);
     abort_on_GL_error("Could not set active texture unit");
 
+    // Rows of 8 and 16-bit bricks with odd sizes are not aligned to the default 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    abort_on_GL_error("Could not set unpack alignment");
+
+    // The bricks are uploaded in storage order, so that their data is read sequentially
     size_t brick_idx;
     Brick* brick;
     for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
     {
-        brick = bricked_field->bricks + brick_idx;
-
-        glGenTextures(1, &brick->texture_id);
-        abort_on_GL_error("Could not generate texture object");
-
-        glBindTexture(GL_TEXTURE_3D, brick->texture_id);
-        abort_on_GL_error("Could not bind 3D texture");
-
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
-
-        glTexImage3D(GL_TEXTURE_3D,
-                     0,
-                     GL_RED,
-                     (GLsizei)brick->padded_size[0],
-                     (GLsizei)brick->padded_size[1],
-                     (GLsizei)brick->padded_size[2],
-                     0,
-                     GL_RED,
-                     GL_FLOAT,
-                     (GLvoid*)brick->data);
-        abort_on_GL_error("Could not define 3D texture image");
-
-        glGenerateMipmap(GL_TEXTURE_3D);
-        abort_on_GL_error("Could not generate mipmap for 3D texture");
-
-        ListItem item = append_new_list_item(&field_texture->texture->ids, sizeof(GLuint));
-        GLuint* const id = (GLuint*)item.data;
-        *id = brick->texture_id;
+        brick = bricked_field->bricks + bricked_field->brick_storage_order[brick_idx];
+
+        // Constant bricks get no texture, since their value is supplied directly to the shader
+        if (brick->is_constant)
+            continue;
+
+        create_brick_texture(field_texture, &brick->texture_id, brick->padded_size, brick->data, internal_format, type, GL_CLAMP_TO_BORDER);
     }
+
+    // LOD bricks are not padded at the field edges, so sampling there is clamped to the edge voxels instead
+    size_t lod_brick_idx;
+    LODBrick* lod_brick;
+    for (lod_brick_idx = 0; lod_brick_idx < bricked_field->n_lod_bricks; lod_brick_idx++)
+    {
+        lod_brick = bricked_field->lod_bricks + lod_brick_idx;
+        create_brick_texture(field_texture, &lod_brick->texture_id, lod_brick->padded_size, lod_brick->data, internal_format, type, GL_CLAMP_TO_EDGE);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+static void create_brick_texture(FieldTexture* field_texture, GLuint* texture_id, const size_t padded_size[3], const void* data,
+                                 GLint internal_format, GLenum type, GLint wrap_mode)
+{
+    assert(field_texture);
+    assert(texture_id);
+    assert(data);
+
+    glGenTextures(1, texture_id);
+    abort_on_GL_error("Could not generate texture object");
+
+    glBindTexture(GL_TEXTURE_3D, *texture_id);
+    abort_on_GL_error("Could not bind 3D texture");
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, wrap_mode);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, wrap_mode);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, wrap_mode);
+
+    glTexImage3D(GL_TEXTURE_3D,
+                 0,
+                 internal_format,
+                 (GLsizei)padded_size[0],
+                 (GLsizei)padded_size[1],
+                 (GLsizei)padded_size[2],
+                 0,
+                 GL_RED,
+                 type,
+                 (GLvoid*)data);
+    abort_on_GL_error("Could not define 3D texture image");
+
+    glGenerateMipmap(GL_TEXTURE_3D);
+    abort_on_GL_error("Could not generate mipmap for 3D texture");
+
+    ListItem item = append_new_list_item(&field_texture->texture->ids, sizeof(GLuint));
+    GLuint* const id = (GLuint*)item.data;
+    *id = *texture_id;
 }
 
 static void clear_field_texture(FieldTexture* field_texture)
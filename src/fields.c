@@ -3,36 +3,440 @@
 #include "error.h"
 #include "io.h"
 #include "hash_map.h"
+#include "threads.h"
+#include "extra_math.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <float.h>
 
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
 
-static const char* create_field(const char* name,
-                                enum field_type type, float* data,
-                                size_t size_x, size_t size_y, size_t size_z,
-                                float physical_extent_x, float physical_extent_y, float physical_extent_z);
+
+#define LIMIT_SEARCH_CHUNK_LENGTH (1024*1024)
+#define TRANSPOSE_TILE_SIZE 32
+#define STREAMED_LIMIT_SEARCH_SLAB_SIZE (64*1024*1024)
+
+
+typedef struct BifrostHeader
+{
+    size_t element_size;
+    int swap_byte_order;
+    char order;
+    size_t size_x;
+    size_t size_y;
+    size_t size_z;
+    float dx;
+    float dy;
+    float dz;
+    int has_limits;
+    float min_value;
+    float max_value;
+} BifrostHeader;
+
+typedef struct LoadedField
+{
+    float* data;
+    int data_is_mapped;
+    int data_is_deferred;
+    const char* source_filename;
+    const char* source_header_filename;
+    size_t source_element_size;
+    int source_byte_order_is_swapped;
+    int source_is_column_major;
+    int source_is_compressed;
+    FieldConfiguration source_configuration;
+    BinaryFileReadingConfiguration source_reading_configuration;
+    size_t size_x;
+    size_t size_y;
+    size_t size_z;
+    float physical_extent_x;
+    float physical_extent_y;
+    float physical_extent_z;
+    float min_value;
+    float max_value;
+} LoadedField;
+
+typedef struct AxisSwap
+{
+    const float* input_array;
+    float* output_array;
+    size_t size_x;
+    size_t size_y;
+    size_t size_z;
+    size_t n_tile_rows;
+} AxisSwap;
+
+typedef struct LimitSearch
+{
+    const float* array;
+    size_t length;
+    float* chunk_min_values;
+    float* chunk_max_values;
+} LimitSearch;
+
+
+static void read_bifrost_header(const char* header_filename, BifrostHeader* bifrost_header);
+static void load_bifrost_field_data(const char* data_filename, const char* header_filename,
+                                    const size_t* region_start, const size_t* region_end, size_t stride,
+                                    int allow_deferral, const FieldConfiguration* field_configuration,
+                                    const BinaryFileReadingConfiguration* reading_configuration, LoadedField* loaded_field);
+static float* read_source_slab(const char* data_filename, size_t element_size, int swap_byte_order, int is_column_major,
+                               size_t size_x, size_t size_y, size_t size_z, size_t start_z, size_t end_z,
+                               const BinaryFileReadingConfiguration* reading_configuration);
+static void find_source_limits(const char* data_filename, size_t element_size, int swap_byte_order, int is_column_major,
+                               size_t size_x, size_t size_y, size_t size_z, const BinaryFileReadingConfiguration* reading_configuration,
+                               float* min_value, float* max_value);
+static float* extract_strided_subarray(const float* array, const size_t shape[3],
+                                       const size_t subarray_start[3], const size_t subarray_shape[3], const size_t subarray_stride[3]);
+static const char* create_field(const char* name, enum field_type type, const LoadedField* loaded_field);
+static void initialize_field(Field* field, const char* name, enum field_type type, const LoadedField* loaded_field);
+static Field* insert_new_field(const char* name);
 static size_t get_field_array_length(const Field* field);
+static void free_field_data(float* data, size_t length, int data_is_mapped);
 static void swap_x_and_z_axes(const float* input_array, size_t size_x, size_t size_y, size_t size_z, float* output_array);
+static void swap_x_and_z_axes_for_tile_row(void* shared_data, size_t task_idx, unsigned int thread_idx);
 static void find_float_array_limits(const float* array, size_t length, float* min_value, float* max_value);
-static void scale_float_array(float* array, size_t length, float zero_value, float unity_value);
+static void find_float_array_chunk_limits(void* shared_data, size_t chunk_idx, unsigned int thread_idx);
+static void find_float_subarray_limits(const float* array, size_t length, float* min_value, float* max_value);
 static void clear_field(Field* field);
 
 
+static FieldConfiguration configuration;
+
 static HashMap fields;
 
 
 void initialize_fields(void)
 {
+    configuration.use_memory_mapping = 0;
+    configuration.use_streaming = 0;
+    configuration.use_deferral = 0;
+
     fields = create_map();
 }
 
+void set_memory_mapped_field_loading(int state)
+{
+    check(state == 0 || state == 1);
+    configuration.use_memory_mapping = state;
+}
+
+void set_streamed_field_loading(int state)
+{
+    check(state == 0 || state == 1);
+    configuration.use_streaming = state;
+}
+
+void set_deferred_field_loading(int state)
+{
+    check(state == 0 || state == 1);
+    configuration.use_deferral = state;
+}
+
+FieldConfiguration get_field_configuration(void)
+{
+    /*
+    Returns a copy of the current field loading configuration, for loading
+    fields on other threads (see create_detached_field_from_bifrost_file).
+    */
+
+    return configuration;
+}
+
 const char* create_field_from_bifrost_file(const char* name, const char* data_filename, const char* header_filename)
 {
     check(name);
+
+    const BinaryFileReadingConfiguration reading_configuration = get_binary_file_reading_configuration();
+
+    LoadedField loaded_field;
+    load_bifrost_field_data(data_filename, header_filename, NULL, NULL, 1, 1, &configuration, &reading_configuration, &loaded_field);
+
+    return create_field(name, SCALAR_FIELD, &loaded_field);
+}
+
+const char* create_field_region_from_bifrost_file(const char* name, const char* data_filename, const char* header_filename,
+                                                  size_t start_x, size_t end_x,
+                                                  size_t start_y, size_t end_y,
+                                                  size_t start_z, size_t end_z)
+{
+    const size_t region_start[3] = {start_x, start_y, start_z};
+    const size_t region_end[3] = {end_x, end_y, end_z};
+
+    check(name);
+
+    const BinaryFileReadingConfiguration reading_configuration = get_binary_file_reading_configuration();
+
+    LoadedField loaded_field;
+    load_bifrost_field_data(data_filename, header_filename, region_start, region_end, 1, 1, &configuration, &reading_configuration, &loaded_field);
+
+    return create_field(name, SCALAR_FIELD, &loaded_field);
+}
+
+const char* create_decimated_field_from_bifrost_file(const char* name, const char* data_filename, const char* header_filename,
+                                                     unsigned int stride)
+{
+    check(name);
+    check(stride > 0);
+
+    const BinaryFileReadingConfiguration reading_configuration = get_binary_file_reading_configuration();
+
+    LoadedField loaded_field;
+    load_bifrost_field_data(data_filename, header_filename, NULL, NULL, (size_t)stride, 1, &configuration, &reading_configuration, &loaded_field);
+
+    return create_field(name, SCALAR_FIELD, &loaded_field);
+}
+
+int compress_bifrost_file(const char* data_filename, const char* header_filename, const char* output_filename)
+{
+    /*
+    Writes the data of the given Bifrost data and header file to a compressed
+    file that can be loaded in place of the original data file together with
+    the same header file. The values are converted to native single precision
+    but keep their order in the file. Returns 1 if successful and 0 otherwise.
+    */
+
     check(data_filename);
+    check(output_filename);
+
+    BifrostHeader bifrost_header;
+    read_bifrost_header(header_filename, &bifrost_header);
+
+    const size_t length = bifrost_header.size_x*bifrost_header.size_y*bifrost_header.size_z;
+    const BinaryFileReadingConfiguration reading_configuration = get_binary_file_reading_configuration();
+
+    float* const data = is_compressed_float_binary_file(data_filename) ?
+                        read_compressed_float_binary_file(data_filename, length) :
+                        read_float_binary_file(data_filename, length, bifrost_header.element_size, bifrost_header.swap_byte_order,
+                                               &reading_configuration);
+
+    if (!data)
+        return 0;
+
+    const int write_succeeded = write_compressed_float_binary_file(output_filename, data, length);
+
+    free(data);
+
+    return write_succeeded;
+}
+
+void create_detached_field_from_bifrost_file(Field* field, const char* name, const char* data_filename, const char* header_filename,
+                                             const FieldConfiguration* field_configuration,
+                                             const BinaryFileReadingConfiguration* reading_configuration)
+{
+    /*
+    Creates a field from the given Bifrost data and header file without adding
+    it to the collection of fields. Since neither the collection nor the
+    current configurations are touched, this can be called from any thread.
+    The given configurations should be copies taken on the main thread (see
+    get_field_configuration and get_binary_file_reading_configuration). The
+    field can later be added to the collection with add_detached_field.
+    */
+
+    check(field);
+    check(name);
+    check(field_configuration);
+    check(reading_configuration);
+
+    LoadedField loaded_field;
+    load_bifrost_field_data(data_filename, header_filename, NULL, NULL, 1, 1, field_configuration, reading_configuration, &loaded_field);
+
+    initialize_field(field, name, SCALAR_FIELD, &loaded_field);
+}
+
+const char* add_detached_field(Field* field)
+{
+    /*
+    Moves the given detached field into the collection of fields. The detached
+    field is left empty, and the field must subsequently be accessed through
+    get_field with the returned name.
+    */
+
+    check(field);
+    check(field->name.chars);
+
+    Field* const added_field = insert_new_field(field->name.chars);
+
+    *added_field = *field;
+
+    field->name = create_empty_string();
+    field->source_filename = create_empty_string();
+    field->source_header_filename = create_empty_string();
+    field->data = NULL;
+    field->data_is_mapped = 0;
+    field->data_is_deferred = 0;
+
+    return added_field->name.chars;
+}
+
+void clear_detached_field(Field* field)
+{
+    clear_field(field);
+}
+
+Field* get_field(const char* name)
+{
+    check(name);
+
+    MapItem item = get_map_item(&fields, name);
+
+    if (!item.data)
+        print_severe_message("Could not get field \"%s\" because it doesn't exist.", name);
+
+    assert(item.size == sizeof(Field));
+    Field* const field = (Field*)item.data;
+    check(field);
+
+    return field;
+}
+
+int field_values_can_be_read(const Field* field)
+{
+    /*
+    Returns whether the values of the given field can still be obtained from
+    the field itself, either from its data, by loading its deferred data or by
+    streaming them from its source file. A compressed source file can not be
+    streamed, so once the data of a field with such a source has been released,
+    its values are only available from wherever they were copied to.
+    */
+
+    check(field);
+
+    return field->data || field->data_is_deferred || (field->source_filename.chars && !field->source_is_compressed);
+}
+
+float* read_field_slab(const Field* field, size_t start_z, size_t end_z)
+{
+    /*
+    Reads the unnormalized values of the given z-range of a field from its
+    source file into a newly allocated array with x varying fastest. This is
+    how the data of fields loaded without data (see set_streamed_field_loading)
+    is accessed. Since the field collection is not touched, this can be called
+    from any thread. Returns NULL if the data could not be read.
+    */
+
+    check(field);
+    check(field->source_filename.chars);
+    check(!field->data_is_deferred);
+    check(!field->source_is_compressed);
+    check(start_z < end_z && end_z <= field->size_z);
+
+    return read_source_slab(field->source_filename.chars, field->source_element_size,
+                            field->source_byte_order_is_swapped, field->source_is_column_major,
+                            field->size_x, field->size_y, field->size_z, start_z, end_z,
+                            &field->source_reading_configuration);
+}
+
+void load_deferred_field_data(Field* field)
+{
+    /*
+    Loads the data and value limits of a field whose loading was deferred
+    (see set_deferred_field_loading), in the same way and with the same
+    configuration they would have been loaded with when the field was created.
+    Since neither the field collection nor the current configurations are
+    touched, this can be called from any thread.
+    */
+
+    check(field);
+    check(field->data_is_deferred);
+    check(field->source_filename.chars);
+    check(field->source_header_filename.chars);
+
+    LoadedField loaded_field;
+    load_bifrost_field_data(field->source_filename.chars, field->source_header_filename.chars, NULL, NULL, 1, 0,
+                            &field->source_configuration, &field->source_reading_configuration, &loaded_field);
+
+    check(loaded_field.size_x == field->size_x && loaded_field.size_y == field->size_y && loaded_field.size_z == field->size_z);
+
+    field->data = loaded_field.data;
+    field->data_is_mapped = loaded_field.data_is_mapped;
+    field->data_is_deferred = 0;
+
+    set_field_value_limits(field, loaded_field.min_value, loaded_field.max_value);
+}
+
+void set_field_value_limits(Field* field, float min_value, float max_value)
+{
+    /*
+    Sets the value limits of the given field along with the normalization
+    mapping them onto [0, 1]. This is used when the limits are known from
+    elsewhere, like a brick cache, so that the data need not be loaded to find
+    them.
+    */
+
+    check(field);
+
+    field->min_value = min_value;
+    field->max_value = max_value;
+
+    // The data array is kept unnormalized, and the normalization is instead applied by whoever
+    // reads the values next (typically while copying them into bricks). This avoids a separate
+    // pass over the data and keeps memory mapped data read-only.
+    if (min_value < max_value)
+    {
+        field->normalization_offset = min_value;
+        field->normalization_scale = 1.0f/(max_value - min_value);
+    }
+    else
+    {
+        print_warning_message("Can only normalize field with maximum value larger than minimum value.");
+        field->normalization_offset = 0.0f;
+        field->normalization_scale = 1.0f;
+    }
+}
+
+void release_field_data(Field* field)
+{
+    /*
+    Frees the data of the given field while keeping the rest of the field,
+    for when the values have been copied elsewhere (like into bricks) and the
+    original array is no longer needed. Use field_values_can_be_read to
+    determine whether the values can still be obtained from the field.
+    */
+
+    check(field);
+
+    if (!field->data)
+        return;
+
+    free_field_data(field->data, get_field_array_length(field), field->data_is_mapped);
+
+    field->data = NULL;
+    field->data_is_mapped = 0;
+}
+
+void destroy_field(const char* name)
+{
+    Field* const field = get_field(name);
+
+    DynamicString field_name_copy = create_duplicate_string(&field->name);
+
+    clear_field(field);
+
+    remove_map_item(&fields, field_name_copy.chars);
+
+    clear_string(&field_name_copy);
+}
+
+void cleanup_fields(void)
+{
+    for (reset_map_iterator(&fields); valid_map_iterator(&fields); advance_map_iterator(&fields))
+    {
+        Field* const field = get_field(get_current_map_key(&fields));
+        clear_field(field);
+    }
+
+    destroy_map(&fields);
+}
+
+static void read_bifrost_header(const char* header_filename, BifrostHeader* bifrost_header)
+{
     check(header_filename);
+    check(bifrost_header);
 
     char* header = read_text_file(header_filename);
 
@@ -51,6 +455,15 @@ const char* create_field_from_bifrost_file(const char* name, const char* data_fi
     const float dy = find_float_entry_in_header(header, "dy", ":");
     const float dz = find_float_entry_in_header(header, "dz", ":");
 
+    // The value limits are optional, and allow streamed loading to skip searching the data for them
+    bifrost_header->has_limits = has_entry_in_header(header, "min_value", ":") && has_entry_in_header(header, "max_value", ":");
+
+    if (bifrost_header->has_limits)
+    {
+        bifrost_header->min_value = find_float_entry_in_header(header, "min_value", ":");
+        bifrost_header->max_value = find_float_entry_in_header(header, "max_value", ":");
+    }
+
     free(header);
 
     if (element_kind == 0 || element_size == 0 || dimensions == 0 ||
@@ -61,102 +474,400 @@ const char* create_field_from_bifrost_file(const char* name, const char* data_fi
     if (element_kind != 'f')
         print_severe_message("Field data must be floating-point.");
 
-    if (element_size != 4)
-        print_severe_message("Field data must have 4-byte precision.");
+    if (element_size != 2 && element_size != 4 && element_size != 8)
+        print_severe_message("Field data must have 2, 4 or 8-byte precision.");
 
-    if (is_little_endian())
-    {
-        if (endianness != 'l')
-            print_severe_message("Field data must be little-endian.");
-    }
-    else
-    {
-        if (endianness != 'b')
-            print_severe_message("Field data must be big-endian.");
-    }
+    if (endianness != 'l' && endianness != 'b')
+        print_severe_message("Field data must be either little-endian or big-endian.");
 
     if (dimensions != 3)
         print_severe_message("Field data must be 3D.");
 
-    if (order != 'C')
-        print_severe_message("Field data must laid out row-major order.");
+    if (order != 'C' && order != 'F')
+        print_severe_message("Field data must be laid out in either row-major or column-major order.");
 
     if (signed_size_x < 2 || signed_size_y < 2 || signed_size_z < 2)
         print_severe_message("Field dimensions cannot smaller than 2 along any axis.");
 
-    const size_t size_x = (size_t)signed_size_x;
-    const size_t size_y = (size_t)signed_size_y;
-    const size_t size_z = (size_t)signed_size_z;
+    bifrost_header->element_size = (size_t)element_size;
+    bifrost_header->swap_byte_order = endianness != (is_little_endian() ? 'l' : 'b');
+    bifrost_header->order = order;
+    bifrost_header->size_x = (size_t)signed_size_x;
+    bifrost_header->size_y = (size_t)signed_size_y;
+    bifrost_header->size_z = (size_t)signed_size_z;
+    bifrost_header->dx = dx;
+    bifrost_header->dy = dy;
+    bifrost_header->dz = dz;
+}
+
+static void load_bifrost_field_data(const char* data_filename, const char* header_filename,
+                                    const size_t* region_start, const size_t* region_end, size_t stride,
+                                    int allow_deferral, const FieldConfiguration* field_configuration,
+                                    const BinaryFileReadingConfiguration* reading_configuration, LoadedField* loaded_field)
+{
+    /*
+    Reads the data of the given Bifrost data and header file and computes its
+    limits. If region bounds are given, only the voxels with indices in
+    [region_start, region_end) along each axis are read from the file. With a
+    stride larger than one, only every stride'th voxel along each axis is read.
+    The data file may also be a compressed file written by
+    compress_bifrost_file. If deferral is allowed and enabled (see
+    set_deferred_field_loading), only the header is read for whole fields. Since
+    the field collection is not touched and the configurations are given, this
+    can be called from any thread.
+    */
+
+    check(data_filename);
+    check(header_filename);
+    check(field_configuration);
+    check(reading_configuration);
+
+    BifrostHeader bifrost_header;
+    read_bifrost_header(header_filename, &bifrost_header);
+
+    const size_t element_size = bifrost_header.element_size;
+    const int swap_byte_order = bifrost_header.swap_byte_order;
+    const char order = bifrost_header.order;
+    const size_t file_size_x = bifrost_header.size_x;
+    const size_t file_size_y = bifrost_header.size_y;
+    const size_t file_size_z = bifrost_header.size_z;
+
+    check((region_start == NULL) == (region_end == NULL));
+
+    check(loaded_field);
+    check(stride > 0);
+
+    const size_t start_x = region_start ? region_start[0] : 0;
+    const size_t start_y = region_start ? region_start[1] : 0;
+    const size_t start_z = region_start ? region_start[2] : 0;
+    const size_t end_x = region_end ? region_end[0] : file_size_x;
+    const size_t end_y = region_end ? region_end[1] : file_size_y;
+    const size_t end_z = region_end ? region_end[2] : file_size_z;
+
+    if (end_x > file_size_x || end_y > file_size_y || end_z > file_size_z ||
+        end_x <= start_x || end_y <= start_y || end_z <= start_z)
+        print_severe_message("Field region must lie within the data.");
+
+    const int is_region = stride > 1 ||
+                          start_x != 0 || end_x != file_size_x ||
+                          start_y != 0 || end_y != file_size_y ||
+                          start_z != 0 || end_z != file_size_z;
+
+    const size_t size_x = (end_x - start_x - 1)/stride + 1;
+    const size_t size_y = (end_y - start_y - 1)/stride + 1;
+    const size_t size_z = (end_z - start_z - 1)/stride + 1;
+
+    if (size_x < 2 || size_y < 2 || size_z < 2)
+        print_severe_message("Field region must span at least 2 voxels along every axis after decimation.");
 
     const size_t length = size_x*size_y*size_z;
 
-    float* data = (float*)read_binary_file(data_filename, length, sizeof(float));
+    // Compressed files always hold native single precision values
+    const int is_compressed = is_compressed_float_binary_file(data_filename);
+
+    // The source of a streamed field is read slab by slab, which requires the values of
+    // each slab to be found at fixed positions in the file
+    const int use_streaming = field_configuration->use_streaming && !is_region && !is_compressed;
+
+    if (field_configuration->use_streaming && !use_streaming)
+        print_info_message("Loading all field data at once instead of streaming it since it is compressed or is a region.");
+
+    loaded_field->source_filename = is_region ? NULL : data_filename;
+    loaded_field->source_header_filename = is_region ? NULL : header_filename;
+    loaded_field->source_element_size = element_size;
+    loaded_field->source_byte_order_is_swapped = swap_byte_order;
+    loaded_field->source_is_column_major = order == 'F';
+    loaded_field->source_is_compressed = is_compressed;
+    loaded_field->source_configuration = *field_configuration;
+    loaded_field->source_reading_configuration = *reading_configuration;
+    loaded_field->size_x = size_x;
+    loaded_field->size_y = size_y;
+    loaded_field->size_z = size_z;
+
+    // Decimated voxels are separated by stride grid cells
+    loaded_field->physical_extent_x = (float)((size_x - 1)*stride)*bifrost_header.dx;
+    loaded_field->physical_extent_y = (float)((size_y - 1)*stride)*bifrost_header.dy;
+    loaded_field->physical_extent_z = (float)((size_z - 1)*stride)*bifrost_header.dz;
+
+    // Regions cannot be loaded later from the source file alone, so they are never deferred
+    loaded_field->data_is_deferred = allow_deferral && field_configuration->use_deferral && !is_region;
+
+    if (loaded_field->data_is_deferred)
+    {
+        loaded_field->data = NULL;
+        loaded_field->data_is_mapped = 0;
+        loaded_field->min_value = 0;
+        loaded_field->max_value = 0;
+        return;
+    }
+
+    if (use_streaming)
+    {
+        loaded_field->data = NULL;
+        loaded_field->data_is_mapped = 0;
+
+        if (bifrost_header.has_limits)
+        {
+            loaded_field->min_value = bifrost_header.min_value;
+            loaded_field->max_value = bifrost_header.max_value;
+        }
+        else
+        {
+            find_source_limits(data_filename, element_size, swap_byte_order, order == 'F',
+                               size_x, size_y, size_z, reading_configuration, &loaded_field->min_value, &loaded_field->max_value);
+        }
+
+        return;
+    }
+
+    // Memory mapped data cannot be modified, so data with the opposite byte order
+    // or a precision other than single precision is read instead. Regions are
+    // always read, since only the rows intersecting the region are needed.
+    int use_memory_mapping = field_configuration->use_memory_mapping && !is_region && !is_compressed &&
+                             !swap_byte_order && element_size == sizeof(float);
+
+    if (field_configuration->use_memory_mapping && !use_memory_mapping)
+        print_info_message("Reading field data instead of mapping it since it must be converted, is compressed or is a region.");
+
+    // Shapes and offsets are given with the axis varying fastest in the file first
+    const int is_column_major = order == 'F';
+
+    const size_t file_shape[3] = {is_column_major ? file_size_z : file_size_x,
+                                  file_size_y,
+                                  is_column_major ? file_size_x : file_size_z};
+
+    const size_t file_region_start[3] = {is_column_major ? start_z : start_x,
+                                         start_y,
+                                         is_column_major ? start_x : start_z};
+
+    const size_t file_region_shape[3] = {is_column_major ? size_z : size_x,
+                                         size_y,
+                                         is_column_major ? size_x : size_z};
 
-    const float physical_extent_x = (float)(size_x - 1)*dx;
-    const float physical_extent_y = (float)(size_y - 1)*dy;
-    const float physical_extent_z = (float)(size_z - 1)*dz;
+    const size_t file_region_stride[3] = {stride, stride, stride};
 
-    return create_field(name, SCALAR_FIELD, data,
-                        size_x, size_y, size_z,
-                        physical_extent_x, physical_extent_y, physical_extent_z);
+    float* data = NULL;
+
+    if (is_compressed)
+    {
+        // The blocks do not align with regions, so the whole file is decompressed
+        // and the region is extracted afterwards
+        data = read_compressed_float_binary_file(data_filename, file_size_x*file_size_y*file_size_z);
+
+        if (data && is_region)
+        {
+            float* const region_data = extract_strided_subarray(data, file_shape, file_region_start, file_region_shape, file_region_stride);
+            free(data);
+            data = region_data;
+        }
+    }
+    else if (is_region)
+    {
+        data = read_float_binary_file_region(data_filename, element_size, swap_byte_order,
+                                             file_shape, file_region_start, file_region_shape, file_region_stride,
+                                             reading_configuration);
+    }
+    else
+    {
+        // With memory mapping, the data is never copied into private memory
+        data = use_memory_mapping ?
+               (float*)map_binary_file(data_filename, length, sizeof(float)) :
+               read_float_binary_file(data_filename, length, element_size, swap_byte_order, reading_configuration);
+    }
+
+    if (!data)
+        print_severe_message("Could not load field data.");
+
+    // In column-major order z varies fastest, so the data must be transposed into the
+    // layout with x varying fastest that is assumed everywhere else. When the original
+    // data is memory mapped, this at least avoids holding two private copies.
+    if (order == 'F')
+    {
+        float* const transposed_data = (float*)malloc(sizeof(float)*length);
+
+        if (!transposed_data)
+            print_severe_message("Could not allocate memory for transposing field data.");
+
+        swap_x_and_z_axes(data, size_x, size_y, size_z, transposed_data);
+
+        free_field_data(data, length, use_memory_mapping);
+
+        data = transposed_data;
+        use_memory_mapping = 0;
+    }
+
+    loaded_field->data = data;
+    loaded_field->data_is_mapped = use_memory_mapping;
+
+    find_float_array_limits(data, length, &loaded_field->min_value, &loaded_field->max_value);
 }
 
-Field* get_field(const char* name)
+static float* read_source_slab(const char* data_filename, size_t element_size, int swap_byte_order, int is_column_major,
+                               size_t size_x, size_t size_y, size_t size_z, size_t start_z, size_t end_z,
+                               const BinaryFileReadingConfiguration* reading_configuration)
 {
-    check(name);
+    assert(data_filename);
+    assert(start_z < end_z && end_z <= size_z);
 
-    MapItem item = get_map_item(&fields, name);
+    const size_t slab_size_z = end_z - start_z;
 
-    if (!item.data)
-        print_severe_message("Could not get field \"%s\" because it doesn't exist.", name);
+    // A slab is contiguous in row-major files, while column-major files must be read row by row
+    const size_t file_shape[3] = {is_column_major ? size_z : size_x, size_y, is_column_major ? size_x : size_z};
+    const size_t file_region_start[3] = {is_column_major ? start_z : 0, 0, is_column_major ? 0 : start_z};
+    const size_t file_region_shape[3] = {is_column_major ? slab_size_z : size_x, size_y, is_column_major ? size_x : slab_size_z};
+    const size_t file_region_stride[3] = {1, 1, 1};
 
-    assert(item.size == sizeof(Field));
-    Field* const field = (Field*)item.data;
-    check(field);
+    float* slab = read_float_binary_file_region(data_filename, element_size, swap_byte_order,
+                                                file_shape, file_region_start, file_region_shape, file_region_stride,
+                                                reading_configuration);
 
-    return field;
+    if (slab && is_column_major)
+    {
+        float* const transposed_slab = (float*)malloc(sizeof(float)*size_x*size_y*slab_size_z);
+
+        if (transposed_slab)
+            swap_x_and_z_axes(slab, size_x, size_y, slab_size_z, transposed_slab);
+        else
+            print_error_message("Could not allocate memory for transposing field slab.");
+
+        free(slab);
+        slab = transposed_slab;
+    }
+
+    return slab;
 }
 
-void destroy_field(const char* name)
+static void find_source_limits(const char* data_filename, size_t element_size, int swap_byte_order, int is_column_major,
+                               size_t size_x, size_t size_y, size_t size_z, const BinaryFileReadingConfiguration* reading_configuration,
+                               float* min_value, float* max_value)
 {
-    Field* const field = get_field(name);
+    /*
+    Finds the value limits of a field in a file by reading it a slab at a time,
+    so that the full field never has to be held in memory.
+    */
 
-    DynamicString field_name_copy = create_duplicate_string(&field->name);
+    assert(min_value);
+    assert(max_value);
 
-    clear_field(field);
+    const size_t slab_size_z = max_size_t(1, STREAMED_LIMIT_SEARCH_SLAB_SIZE/(sizeof(float)*size_x*size_y));
 
-    remove_map_item(&fields, field_name_copy.chars);
+    float slab_min_value, slab_max_value;
+    size_t start_z;
 
-    clear_string(&field_name_copy);
+    *min_value = FLT_MAX;
+    *max_value = -FLT_MAX;
+
+    for (start_z = 0; start_z < size_z; start_z += slab_size_z)
+    {
+        const size_t end_z = min_size_t(start_z + slab_size_z, size_z);
+
+        float* const slab = read_source_slab(data_filename, element_size, swap_byte_order, is_column_major,
+                                             size_x, size_y, size_z, start_z, end_z, reading_configuration);
+
+        if (!slab)
+            print_severe_message("Could not read field data for finding its limits.");
+
+        find_float_array_limits(slab, size_x*size_y*(end_z - start_z), &slab_min_value, &slab_max_value);
+
+        free(slab);
+
+        *min_value = fminf(*min_value, slab_min_value);
+        *max_value = fmaxf(*max_value, slab_max_value);
+    }
 }
 
-void cleanup_fields(void)
+static float* extract_strided_subarray(const float* array, const size_t shape[3],
+                                       const size_t subarray_start[3], const size_t subarray_shape[3], const size_t subarray_stride[3])
 {
-    for (reset_map_iterator(&fields); valid_map_iterator(&fields); advance_map_iterator(&fields))
+    /*
+    Copies every stride'th element of the given box of a 3D array into a newly
+    allocated array. Shapes and offsets are given with the fastest varying axis
+    first.
+    */
+
+    assert(array);
+
+    float* const subarray = (float*)malloc(sizeof(float)*subarray_shape[0]*subarray_shape[1]*subarray_shape[2]);
+
+    if (!subarray)
     {
-        Field* const field = get_field(get_current_map_key(&fields));
-        clear_field(field);
+        print_error_message("Could not allocate memory for field region.");
+        return NULL;
     }
 
-    destroy_map(&fields);
+    size_t i, j, k;
+    size_t output_idx = 0;
+
+    for (k = 0; k < subarray_shape[2]; k++)
+    {
+        for (j = 0; j < subarray_shape[1]; j++)
+        {
+            const float* const row = array + ((subarray_start[2] + k*subarray_stride[2])*shape[1] +
+                                              subarray_start[1] + j*subarray_stride[1])*shape[0] + subarray_start[0];
+
+            for (i = 0; i < subarray_shape[0]; i++)
+                subarray[output_idx++] = row[i*subarray_stride[0]];
+        }
+    }
+
+    return subarray;
 }
 
-const char* create_field(const char* name,
-                         enum field_type type, float* data,
-                         size_t size_x, size_t size_y, size_t size_z,
-                         float physical_extent_x, float physical_extent_y, float physical_extent_z)
+static const char* create_field(const char* name, enum field_type type, const LoadedField* loaded_field)
 {
     check(name);
-    check(data);
+
+    Field* const field = insert_new_field(name);
+
+    initialize_field(field, name, type, loaded_field);
+
+    return field->name.chars;
+}
+
+static Field* insert_new_field(const char* name)
+{
+    assert(name);
 
     if (map_has_key(&fields, name))
         print_severe_message("Cannot create field \"%s\" because a field with this name already exists.", name);
 
     MapItem item = insert_new_map_item(&fields, name, sizeof(Field));
     Field* const field = (Field*)item.data;
+    check(field);
+
+    return field;
+}
+
+static void initialize_field(Field* field, const char* name, enum field_type type, const LoadedField* loaded_field)
+{
+    check(field);
+    check(name);
+    check(loaded_field);
+
+    // Fields without data are streamed from their source file when needed
+    check(loaded_field->data || loaded_field->source_filename);
+
+    const size_t size_x = loaded_field->size_x;
+    const size_t size_y = loaded_field->size_y;
+    const size_t size_z = loaded_field->size_z;
+
+    const float physical_extent_x = loaded_field->physical_extent_x;
+    const float physical_extent_y = loaded_field->physical_extent_y;
+    const float physical_extent_z = loaded_field->physical_extent_z;
 
     field->name = create_string(name);
-    field->data = data;
+    field->data = loaded_field->data;
+    field->data_is_mapped = loaded_field->data_is_mapped;
+    field->data_is_deferred = loaded_field->data_is_deferred;
+    field->source_filename = loaded_field->source_filename ? create_string("%s", loaded_field->source_filename) : create_empty_string();
+    field->source_header_filename = loaded_field->source_header_filename ?
+                                    create_string("%s", loaded_field->source_header_filename) : create_empty_string();
+    field->source_element_size = loaded_field->source_element_size;
+    field->source_byte_order_is_swapped = loaded_field->source_byte_order_is_swapped;
+    field->source_is_column_major = loaded_field->source_is_column_major;
+    field->source_is_compressed = loaded_field->source_is_compressed;
+    field->source_configuration = loaded_field->source_configuration;
+    field->source_reading_configuration = loaded_field->source_reading_configuration;
     field->type = type;
     field->size_x = size_x;
     field->size_y = size_y;
@@ -175,13 +886,16 @@ const char* create_field(const char* name,
 
     field->physical_extent_scale = 0.5f*max_physical_extent;
 
-    const size_t length = get_field_array_length(field);
-
-    find_float_array_limits(data, length, &field->min_value, &field->max_value);
-
-    scale_float_array(data, length, field->min_value, field->max_value);
-
-    return field->name.chars;
+    // The limits of deferred fields are set once they are known
+    if (field->data_is_deferred)
+    {
+        field->min_value = 0;
+        field->max_value = 0;
+        field->normalization_offset = 0.0f;
+        field->normalization_scale = 1.0f;
+    }
+    else
+        set_field_value_limits(field, loaded_field->min_value, loaded_field->max_value);
 }
 
 static size_t get_field_array_length(const Field* field)
@@ -189,24 +903,70 @@ static size_t get_field_array_length(const Field* field)
     return field->size_x*field->size_y*field->size_z*((field->type == VECTOR_FIELD) ? 3 : 1);
 }
 
+static void free_field_data(float* data, size_t length, int data_is_mapped)
+{
+    check(data);
+
+    if (data_is_mapped)
+        unmap_binary_file(data, length, sizeof(float));
+    else
+        free(data);
+}
+
 static void swap_x_and_z_axes(const float* input_array, size_t size_x, size_t size_y, size_t size_z, float* output_array)
 {
+    /*
+    Transposes an array with z varying fastest into one with x varying fastest.
+    For each y-index, the (x, z)-plane is transposed in square tiles, so that
+    both the reads and the writes within a tile stay in a small set of cache
+    lines. Each task handles one row of tiles in one plane.
+    */
+
     assert(input_array);
     assert(output_array);
     assert(output_array != input_array);
 
-    size_t i, j, k;
-    size_t input_idx, output_idx;
+    AxisSwap axis_swap;
+    axis_swap.input_array = input_array;
+    axis_swap.output_array = output_array;
+    axis_swap.size_x = size_x;
+    axis_swap.size_y = size_y;
+    axis_swap.size_z = size_z;
+    axis_swap.n_tile_rows = (size_x + TRANSPOSE_TILE_SIZE - 1)/TRANSPOSE_TILE_SIZE;
 
-    for (i = 0; i < size_x; i++)
-        for (j = 0; j < size_y; j++)
-            for (k = 0; k < size_z; k++)
-            {
-                input_idx = (i*size_y + j)*size_z + k;
-                output_idx = (k*size_y + j)*size_x + i;
+    run_parallel_tasks(swap_x_and_z_axes_for_tile_row, &axis_swap, size_y*axis_swap.n_tile_rows, get_worker_thread_count());
+}
 
-                output_array[output_idx] = input_array[input_idx];
-            }
+static void swap_x_and_z_axes_for_tile_row(void* shared_data, size_t task_idx, unsigned int thread_idx)
+{
+    const AxisSwap* const axis_swap = (const AxisSwap*)shared_data;
+    assert(axis_swap);
+
+    const size_t size_x = axis_swap->size_x;
+    const size_t size_y = axis_swap->size_y;
+    const size_t size_z = axis_swap->size_z;
+
+    const size_t j = task_idx/axis_swap->n_tile_rows;
+    const size_t start_i = (task_idx % axis_swap->n_tile_rows)*TRANSPOSE_TILE_SIZE;
+    const size_t end_i = min_size_t(start_i + TRANSPOSE_TILE_SIZE, size_x);
+
+    const float* const input_plane = axis_swap->input_array + j*size_z;
+    float* const output_plane = axis_swap->output_array + j*size_x;
+
+    // Distances between consecutive x-values in the input and consecutive z-values in the output
+    const size_t input_stride = size_y*size_z;
+    const size_t output_stride = size_y*size_x;
+
+    size_t i, k, start_k, end_k;
+
+    for (start_k = 0; start_k < size_z; start_k += TRANSPOSE_TILE_SIZE)
+    {
+        end_k = min_size_t(start_k + TRANSPOSE_TILE_SIZE, size_z);
+
+        for (k = start_k; k < end_k; k++)
+            for (i = start_i; i < end_i; i++)
+                output_plane[k*output_stride + i] = input_plane[i*input_stride + k];
+    }
 }
 
 static void find_float_array_limits(const float* array, size_t length, float* min_value, float* max_value)
@@ -216,40 +976,118 @@ static void find_float_array_limits(const float* array, size_t length, float* mi
     assert(min_value);
     assert(max_value);
 
-    size_t i;
-    float value;
+    const size_t n_chunks = (length + LIMIT_SEARCH_CHUNK_LENGTH - 1)/LIMIT_SEARCH_CHUNK_LENGTH;
+
+    LimitSearch search;
+    search.array = array;
+    search.length = length;
+    search.chunk_min_values = (float*)malloc(sizeof(float)*n_chunks);
+    search.chunk_max_values = (float*)malloc(sizeof(float)*n_chunks);
+    check(search.chunk_min_values);
+    check(search.chunk_max_values);
+
+    // Each thread searches separate chunks of the array, and the results are combined afterwards
+    run_parallel_tasks(find_float_array_chunk_limits, &search, n_chunks, get_worker_thread_count());
+
+    size_t chunk_idx;
     float min = FLT_MAX;
     float max = -FLT_MAX;
 
-    for (i = 0; i < length; i++)
+    for (chunk_idx = 0; chunk_idx < n_chunks; chunk_idx++)
     {
-        value = array[i];
-        if (value < min)
-            min = value;
-        if (value > max)
-            max = value;
+        min = fminf(min, search.chunk_min_values[chunk_idx]);
+        max = fmaxf(max, search.chunk_max_values[chunk_idx]);
     }
 
+    free(search.chunk_min_values);
+    free(search.chunk_max_values);
+
     *min_value = min;
     *max_value = max;
 }
 
-static void scale_float_array(float* array, size_t length, float zero_value, float unity_value)
+static void find_float_array_chunk_limits(void* shared_data, size_t chunk_idx, unsigned int thread_idx)
+{
+    LimitSearch* const search = (LimitSearch*)shared_data;
+    assert(search);
+
+    const size_t start_idx = chunk_idx*LIMIT_SEARCH_CHUNK_LENGTH;
+    const size_t chunk_length = min_size_t(LIMIT_SEARCH_CHUNK_LENGTH, search->length - start_idx);
+
+    find_float_subarray_limits(search->array + start_idx, chunk_length,
+                               search->chunk_min_values + chunk_idx,
+                               search->chunk_max_values + chunk_idx);
+}
+
+static void find_float_subarray_limits(const float* array, size_t length, float* min_value, float* max_value)
 {
     assert(array);
-    assert(length > 0);
+    assert(min_value);
+    assert(max_value);
+
+    size_t i = 0;
+    float value;
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
+
+#if defined(__AVX__)
+    __m256 values;
+    __m256 min_values = _mm256_set1_ps(FLT_MAX);
+    __m256 max_values = _mm256_set1_ps(-FLT_MAX);
 
-    if (zero_value >= unity_value)
+    for (; i + 8 <= length; i += 8)
     {
-        print_warning_message("Can only scale array with unity value larger than zero value.");
-        return;
+        values = _mm256_loadu_ps(array + i);
+        min_values = _mm256_min_ps(min_values, values);
+        max_values = _mm256_max_ps(max_values, values);
+    }
+
+    float min_lanes[8];
+    float max_lanes[8];
+    _mm256_storeu_ps(min_lanes, min_values);
+    _mm256_storeu_ps(max_lanes, max_values);
+
+    for (unsigned int lane = 0; lane < 8; lane++)
+    {
+        min = fminf(min, min_lanes[lane]);
+        max = fmaxf(max, max_lanes[lane]);
     }
+#elif defined(__SSE__)
+    __m128 values;
+    __m128 min_values = _mm_set1_ps(FLT_MAX);
+    __m128 max_values = _mm_set1_ps(-FLT_MAX);
 
-    size_t i;
-    const float scale = 1.0f/(unity_value - zero_value);
+    for (; i + 4 <= length; i += 4)
+    {
+        values = _mm_loadu_ps(array + i);
+        min_values = _mm_min_ps(min_values, values);
+        max_values = _mm_max_ps(max_values, values);
+    }
+
+    float min_lanes[4];
+    float max_lanes[4];
+    _mm_storeu_ps(min_lanes, min_values);
+    _mm_storeu_ps(max_lanes, max_values);
+
+    for (unsigned int lane = 0; lane < 4; lane++)
+    {
+        min = fminf(min, min_lanes[lane]);
+        max = fmaxf(max, max_lanes[lane]);
+    }
+#endif
 
-    for (i = 0; i < length; i++)
-        array[i] = (array[i] - zero_value)*scale;
+    // Handle the remaining values (or all of them if no vector instructions are available)
+    for (; i < length; i++)
+    {
+        value = array[i];
+        if (value < min)
+            min = value;
+        if (value > max)
+            max = value;
+    }
+
+    *min_value = min;
+    *max_value = max;
 }
 
 static void clear_field(Field* field)
@@ -257,10 +1095,20 @@ static void clear_field(Field* field)
     check(field);
 
     if (field->data)
-        free(field->data);
+        free_field_data(field->data, get_field_array_length(field), field->data_is_mapped);
 
     clear_string(&field->name);
+    clear_string(&field->source_filename);
+    clear_string(&field->source_header_filename);
+    field->source_element_size = 0;
+    field->source_byte_order_is_swapped = 0;
+    field->source_is_column_major = 0;
+    field->source_is_compressed = 0;
+    memset(&field->source_configuration, 0, sizeof(FieldConfiguration));
+    memset(&field->source_reading_configuration, 0, sizeof(BinaryFileReadingConfiguration));
     field->data = NULL;
+    field->data_is_mapped = 0;
+    field->data_is_deferred = 0;
     field->type = NULL_FIELD;
     field->size_x = 0;
     field->size_y = 0;
@@ -274,4 +1122,6 @@ static void clear_field(Field* field)
     field->physical_extent_scale = 0;
     field->min_value = 0;
     field->max_value = 0;
+    field->normalization_offset = 0;
+    field->normalization_scale = 0;
 }
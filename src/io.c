@@ -1,21 +1,159 @@
 #include "io.h"
 
 #include "error.h"
+#include "threads.h"
+#include "extra_math.h"
+#include "dynamic_string.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
 #include <limits.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#if defined(__AVX__) || defined(__SSSE3__) || defined(__F16C__)
+#include <immintrin.h>
+#endif
 
+
+#define READ_ALIGNMENT 4096
+#define DEFAULT_READING_THREAD_COUNT 4
+#define DEFAULT_READING_CHUNK_SIZE (16*1024*1024)
+
+// The version must be incremented whenever the compressed format changes
+#define COMPRESSED_FILE_MAGIC "VTFPCZ01"
+#define COMPRESSED_FILE_VERSION 1
+#define COMPRESSED_FILE_BYTE_ORDER_MARK 0x01020304
+#define COMPRESSION_BLOCK_LENGTH (256*1024)
+#define COMPRESSION_TABLE_SIZE_EXPONENT 14
+#define COMPRESSION_TABLE_SIZE (1 << COMPRESSION_TABLE_SIZE_EXPONENT)
+
+
+typedef struct ChunkedRead
+{
+    int file_descriptor;
+    char* destination;
+    char** conversion_buffers;
+    size_t n_bytes;
+    size_t chunk_size;
+    size_t element_size;
+    int swap_byte_order;
+    int* chunk_failed;
+} ChunkedRead;
+
+typedef struct CompressedFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t length;
+    uint64_t block_length;
+    uint64_t n_blocks;
+} CompressedFileHeader;
+
+typedef struct BlockCompression
+{
+    const uint32_t* values;
+    size_t length;
+    size_t block_length;
+    unsigned char* compressed_data;
+    size_t max_compressed_block_size;
+    size_t* compressed_block_sizes;
+} BlockCompression;
+
+typedef struct BlockDecompression
+{
+    int file_descriptor;
+    uint32_t* values;
+    size_t length;
+    size_t block_length;
+    const uint64_t* block_offsets;
+    unsigned char** compressed_buffers;
+    int* block_failed;
+} BlockDecompression;
+
+typedef struct ValuePredictor
+{
+    uint32_t fcm_table[COMPRESSION_TABLE_SIZE];
+    uint32_t dfcm_table[COMPRESSION_TABLE_SIZE];
+    uint32_t fcm_hash;
+    uint32_t dfcm_hash;
+    uint32_t last_value;
+} ValuePredictor;
+
+typedef struct RegionRead
+{
+    int file_descriptor;
+    float* destination;
+    char** conversion_buffers;
+    char** row_buffers;
+    size_t file_shape[3];
+    size_t region_start[3];
+    size_t region_shape[3];
+    size_t region_stride[3];
+    size_t element_size;
+    int swap_byte_order;
+    int* plane_failed;
+} RegionRead;
+
+
+static void* read_chunked_binary_file(const char* filename, size_t length, size_t element_size,
+                                      int swap_byte_order, int convert_to_float,
+                                      const BinaryFileReadingConfiguration* reading_configuration);
+static void read_file_chunk(void* shared_data, size_t chunk_idx, unsigned int thread_idx);
+static void read_file_region_plane(void* shared_data, size_t plane_idx, unsigned int thread_idx);
+static int read_file_range(int file_descriptor, char* destination, size_t n_bytes, size_t file_offset);
+static int write_file_range(int file_descriptor, const char* source, size_t n_bytes);
+static int write_zeros(int file_descriptor, size_t n_bytes);
+static void swap_byte_order(void* data, size_t length, size_t element_size);
+static void convert_to_single_precision(const void* input_array, size_t length, size_t element_size, float* output_array);
+static size_t get_max_compressed_block_size(size_t block_length);
+static void compress_block(void* shared_data, size_t block_idx, unsigned int thread_idx);
+static void decompress_block(void* shared_data, size_t block_idx, unsigned int thread_idx);
+static size_t compress_values(const uint32_t* values, size_t length, unsigned char* compressed_data);
+static int decompress_values(const unsigned char* compressed_data, size_t compressed_size, size_t length, uint32_t* values);
+static void reset_value_predictor(ValuePredictor* predictor);
+static unsigned int count_leading_zero_bytes(uint32_t value);
 static char* create_string_copy(const char* string);
 static char* strip_string_in_place(char* string);
 static char** extract_lines_from_string(char* string, size_t* n_lines);
 static char* find_entry_in_header(char* header, const char* entry_name, const char* separator);
 
 
+static BinaryFileReadingConfiguration configuration = {DEFAULT_READING_THREAD_COUNT, DEFAULT_READING_CHUNK_SIZE};
+
+
+void set_binary_file_reading_thread_count(unsigned int n_threads)
+{
+    check(n_threads > 0);
+    configuration.n_reading_threads = n_threads;
+}
+
+void set_binary_file_reading_chunk_size(size_t chunk_size)
+{
+    check(chunk_size > 0);
+
+    // Round up to the nearest multiple of the alignment so that chunks start on page boundaries
+    configuration.reading_chunk_size = ((chunk_size + READ_ALIGNMENT - 1)/READ_ALIGNMENT)*READ_ALIGNMENT;
+}
+
+BinaryFileReadingConfiguration get_binary_file_reading_configuration(void)
+{
+    /*
+    Returns a copy of the current reading configuration. Reads on other threads
+    are given such a copy, taken on the thread that changes the configuration,
+    so that they never read the configuration while it is being changed.
+    */
+
+    return configuration;
+}
+
 int is_little_endian()
 {
     unsigned int i = 1;
@@ -84,46 +222,621 @@ char* read_text_file(const char* filename)
     return content;
 }
 
-void* read_binary_file(const char* filename, size_t length, size_t element_size)
+void* read_binary_file(const char* filename, size_t length, size_t element_size, int swap_byte_order,
+                       const BinaryFileReadingConfiguration* reading_configuration)
+{
+    return read_chunked_binary_file(filename, length, element_size, swap_byte_order, 0, reading_configuration);
+}
+
+float* read_float_binary_file(const char* filename, size_t length, size_t element_size, int swap_byte_order,
+                              const BinaryFileReadingConfiguration* reading_configuration)
+{
+    /*
+    Reads a binary file of 2, 4 or 8-byte floating-point values into a newly
+    allocated single precision array. Values of other precisions are converted
+    chunk by chunk, so the full array in the original precision is never held
+    in memory.
+    */
+
+    check(element_size == 2 || element_size == 4 || element_size == 8);
+
+    return (float*)read_chunked_binary_file(filename, length, element_size, swap_byte_order, 1, reading_configuration);
+}
+
+float* read_float_binary_file_region(const char* filename, size_t element_size, int swap_byte_order,
+                                     const size_t file_shape[3], const size_t region_start[3],
+                                     const size_t region_shape[3], const size_t region_stride[3],
+                                     const BinaryFileReadingConfiguration* reading_configuration)
 {
+    /*
+    Reads a box-shaped region of a binary file of 2, 4 or 8-byte floating-point
+    values, laid out as a 3D array, into a newly allocated single precision
+    array. Shapes and offsets are given with the axis varying fastest in the
+    file first, and the output keeps the same axis order. The region shape is
+    the number of values to read along each axis, and consecutive values are
+    separated by the given stride along each axis. Only the rows of the file
+    that contain values in the region are read, with planes of the region read
+    concurrently by a number of worker threads. When the region spans the full
+    fastest axis without striding, all the rows of a plane are read with a
+    single pread.
+    */
+
     check(filename);
+    check(file_shape);
+    check(region_start);
+    check(region_shape);
+    check(region_stride);
+    check(reading_configuration);
+    check(element_size == 2 || element_size == 4 || element_size == 8);
 
-    FILE* file;
-    void* data = NULL;
+    unsigned int dim;
 
-    file = fopen(filename, "rb");
+    for (dim = 0; dim < 3; dim++)
+    {
+        if (region_shape[dim] == 0 || region_stride[dim] == 0 ||
+            region_start[dim] + (region_shape[dim] - 1)*region_stride[dim] >= file_shape[dim])
+        {
+            print_error_message("Region to read from file %s is empty or exceeds the bounds of the data.", filename);
+            return NULL;
+        }
+    }
 
-    if (!file)
+    const int file_descriptor = open(filename, O_RDONLY);
+
+    if (file_descriptor < 0)
     {
         print_error_message("Could not open file %s.", filename);
         return NULL;
     }
 
-    const size_t n_bytes = length*element_size;
+    const size_t n_plane_elements = region_shape[0]*region_shape[1];
+    const size_t n_planes = region_shape[2];
+    const size_t length = n_plane_elements*n_planes;
 
-    data = malloc(n_bytes);
+    float* const data = (float*)malloc(sizeof(float)*length);
 
     if (!data)
     {
-        fclose(file);
-        print_error_message("Could not allocate %d bytes.", n_bytes);
+        close(file_descriptor);
+        print_error_message("Could not allocate %d bytes.", sizeof(float)*length);
         return NULL;
     }
 
-    size_t read_length = fread(data, element_size, length, file);
+    const unsigned int n_threads = (unsigned int)min_size_t(reading_configuration->n_reading_threads, n_planes);
 
-    fclose(file);
+    RegionRead region_read;
+    region_read.file_descriptor = file_descriptor;
+    region_read.destination = data;
+    region_read.conversion_buffers = NULL;
+    region_read.row_buffers = NULL;
+    region_read.element_size = element_size;
+    region_read.swap_byte_order = swap_byte_order;
+    region_read.plane_failed = (int*)calloc(n_planes, sizeof(int));
+    check(region_read.plane_failed);
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        region_read.file_shape[dim] = file_shape[dim];
+        region_read.region_start[dim] = region_start[dim];
+        region_read.region_shape[dim] = region_shape[dim];
+        region_read.region_stride[dim] = region_stride[dim];
+    }
+
+    unsigned int thread_idx;
+
+    // Values not in single precision are read into a per-thread buffer holding one
+    // plane of the region, and converted from there
+    if (element_size != sizeof(float))
+    {
+        region_read.conversion_buffers = (char**)malloc(sizeof(char*)*n_threads);
+        check(region_read.conversion_buffers);
+
+        for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+        {
+            region_read.conversion_buffers[thread_idx] = (char*)malloc(n_plane_elements*element_size);
+            check(region_read.conversion_buffers[thread_idx]);
+        }
+    }
+
+    // With striding along the fastest axis, each row is read in full into a
+    // per-thread buffer, and the values in the region are picked out from there
+    if (region_stride[0] > 1)
+    {
+        region_read.row_buffers = (char**)malloc(sizeof(char*)*n_threads);
+        check(region_read.row_buffers);
+
+        for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+        {
+            region_read.row_buffers[thread_idx] = (char*)malloc(((region_shape[0] - 1)*region_stride[0] + 1)*element_size);
+            check(region_read.row_buffers[thread_idx]);
+        }
+    }
+
+    const double start_time = get_wall_clock_time();
+
+    run_parallel_tasks(read_file_region_plane, &region_read, n_planes, n_threads);
+
+    const double elapsed_time = get_wall_clock_time() - start_time;
+
+    close(file_descriptor);
+
+    if (region_read.conversion_buffers)
+    {
+        for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+            free(region_read.conversion_buffers[thread_idx]);
+
+        free(region_read.conversion_buffers);
+    }
+
+    if (region_read.row_buffers)
+    {
+        for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+            free(region_read.row_buffers[thread_idx]);
+
+        free(region_read.row_buffers);
+    }
+
+    size_t plane_idx;
+    int read_failed = 0;
 
-    if (read_length != length)
+    for (plane_idx = 0; plane_idx < n_planes; plane_idx++)
+        read_failed = read_failed || region_read.plane_failed[plane_idx];
+
+    free(region_read.plane_failed);
+
+    if (read_failed)
     {
         free(data);
-        print_error_message("Could not read file %s.", filename);
+        print_error_message("Could not read region of file %s.", filename);
         return NULL;
     }
 
+    const double n_megabytes = (double)(length*element_size)/(1024.0*1024.0);
+
+    print_info_message("Read %.1f MB region from %s in %.2f s (%.1f MB/s using %u threads).",
+                       n_megabytes, filename, elapsed_time,
+                       (elapsed_time > 0) ? n_megabytes/elapsed_time : 0.0,
+                       n_threads);
+
     return data;
 }
 
+int is_compressed_float_binary_file(const char* filename)
+{
+    /*
+    Checks whether the given file starts with the magic number of the
+    compressed format written by write_compressed_float_binary_file.
+    */
+
+    check(filename);
+
+    const int file_descriptor = open(filename, O_RDONLY);
+
+    if (file_descriptor < 0)
+        return 0;
+
+    char magic[sizeof(COMPRESSED_FILE_MAGIC) - 1];
+
+    const int has_magic = read_file_range(file_descriptor, magic, sizeof(magic), 0) &&
+                          memcmp(magic, COMPRESSED_FILE_MAGIC, sizeof(magic)) == 0;
+
+    close(file_descriptor);
+
+    return has_magic;
+}
+
+int write_compressed_float_binary_file(const char* filename, const float* data, size_t length)
+{
+    /*
+    Writes the given single precision values losslessly compressed to a binary
+    file. The values are split into independent blocks that are compressed
+    concurrently, so that they can also be decompressed concurrently.
+
+    Each 32-bit value is predicted with the finite context method (FCM) and the
+    differential finite context method (DFCM) as in the FPC algorithm (Burtscher
+    and Ratanaworabhan (2009) "FPC: A High-Speed Compressor for Double-Precision
+    Floating-Point Data"). The value is XORed with the closer prediction, and
+    stored as a 4-bit code holding the choice of predictor and the number of
+    leading zero bytes of the residual, followed by the remaining residual bytes.
+    The codes of a block are stored before its residual bytes.
+
+    Returns 1 if successful and 0 otherwise.
+    */
+
+    check(filename);
+    check(data);
+    check(length > 0);
+
+    const size_t n_blocks = (length + COMPRESSION_BLOCK_LENGTH - 1)/COMPRESSION_BLOCK_LENGTH;
+
+    BlockCompression block_compression;
+    block_compression.values = (const uint32_t*)data;
+    block_compression.length = length;
+    block_compression.block_length = COMPRESSION_BLOCK_LENGTH;
+    block_compression.max_compressed_block_size = get_max_compressed_block_size(COMPRESSION_BLOCK_LENGTH);
+    block_compression.compressed_data = (unsigned char*)malloc(n_blocks*block_compression.max_compressed_block_size);
+    block_compression.compressed_block_sizes = (size_t*)malloc(sizeof(size_t)*n_blocks);
+
+    if (!block_compression.compressed_data || !block_compression.compressed_block_sizes)
+    {
+        free(block_compression.compressed_data);
+        free(block_compression.compressed_block_sizes);
+        print_error_message("Could not allocate memory for compressing %s.", filename);
+        return 0;
+    }
+
+    const double start_time = get_wall_clock_time();
+
+    run_parallel_tasks(compress_block, &block_compression, n_blocks, get_worker_thread_count());
+
+    // The file header is followed by the file offsets of the start and end of every block
+    const size_t header_size = sizeof(CompressedFileHeader) + sizeof(uint64_t)*(n_blocks + 1);
+
+    unsigned char* const header = (unsigned char*)calloc(header_size, 1);
+    check(header);
+
+    CompressedFileHeader* const file_header = (CompressedFileHeader*)header;
+    memcpy(file_header->magic, COMPRESSED_FILE_MAGIC, sizeof(file_header->magic));
+    file_header->version = COMPRESSED_FILE_VERSION;
+    file_header->byte_order_mark = COMPRESSED_FILE_BYTE_ORDER_MARK;
+    file_header->length = (uint64_t)length;
+    file_header->block_length = (uint64_t)COMPRESSION_BLOCK_LENGTH;
+    file_header->n_blocks = (uint64_t)n_blocks;
+
+    uint64_t* const block_offsets = (uint64_t*)(header + sizeof(CompressedFileHeader));
+
+    size_t block_idx;
+    size_t compressed_size = 0;
+
+    // Pack the compressed blocks contiguously
+    for (block_idx = 0; block_idx < n_blocks; block_idx++)
+    {
+        block_offsets[block_idx] = (uint64_t)(header_size + compressed_size);
+
+        memmove(block_compression.compressed_data + compressed_size,
+                block_compression.compressed_data + block_idx*block_compression.max_compressed_block_size,
+                block_compression.compressed_block_sizes[block_idx]);
+
+        compressed_size += block_compression.compressed_block_sizes[block_idx];
+    }
+
+    block_offsets[n_blocks] = (uint64_t)(header_size + compressed_size);
+
+    const double elapsed_time = get_wall_clock_time() - start_time;
+
+    const int write_succeeded = write_binary_file(filename, header, header_size, block_compression.compressed_data, compressed_size);
+
+    free(header);
+    free(block_compression.compressed_block_sizes);
+    free(block_compression.compressed_data);
+
+    if (write_succeeded)
+        print_info_message("Compressed %.1f MB to %.1f MB (ratio %.2f) in %.2f s and wrote it to %s.",
+                           (double)(sizeof(float)*length)/(1024.0*1024.0), (double)(header_size + compressed_size)/(1024.0*1024.0),
+                           (double)(sizeof(float)*length)/(double)(header_size + compressed_size), elapsed_time, filename);
+
+    return write_succeeded;
+}
+
+float* read_compressed_float_binary_file(const char* filename, size_t length)
+{
+    /*
+    Reads a file written by write_compressed_float_binary_file into a newly
+    allocated single precision array. The blocks are read and decompressed
+    concurrently, each straight into its part of the array.
+    */
+
+    check(filename);
+
+    const int file_descriptor = open(filename, O_RDONLY);
+
+    if (file_descriptor < 0)
+    {
+        print_error_message("Could not open file %s.", filename);
+        return NULL;
+    }
+
+    CompressedFileHeader file_header;
+
+    if (!read_file_range(file_descriptor, (char*)&file_header, sizeof(CompressedFileHeader), 0) ||
+        memcmp(file_header.magic, COMPRESSED_FILE_MAGIC, sizeof(file_header.magic)) != 0 ||
+        file_header.version != COMPRESSED_FILE_VERSION ||
+        file_header.byte_order_mark != COMPRESSED_FILE_BYTE_ORDER_MARK)
+    {
+        close(file_descriptor);
+        print_error_message("File %s is not a compressed file of a supported version and byte order.", filename);
+        return NULL;
+    }
+
+    const size_t n_blocks = (size_t)file_header.n_blocks;
+    const size_t block_length = (size_t)file_header.block_length;
+
+    if ((size_t)file_header.length != length || block_length == 0 ||
+        n_blocks != (length + block_length - 1)/block_length)
+    {
+        close(file_descriptor);
+        print_error_message("File %s does not contain the expected %d values.", filename, length);
+        return NULL;
+    }
+
+    uint64_t* const block_offsets = (uint64_t*)malloc(sizeof(uint64_t)*(n_blocks + 1));
+    check(block_offsets);
+
+    if (!read_file_range(file_descriptor, (char*)block_offsets, sizeof(uint64_t)*(n_blocks + 1), sizeof(CompressedFileHeader)))
+    {
+        free(block_offsets);
+        close(file_descriptor);
+        print_error_message("Could not read block offsets from %s.", filename);
+        return NULL;
+    }
+
+    const size_t max_compressed_block_size = get_max_compressed_block_size(block_length);
+
+    size_t block_idx;
+
+    // The first block starts right after the block offsets, and each block must end after it starts and fit in a buffer
+    for (block_idx = 0; block_idx < n_blocks; block_idx++)
+    {
+        if ((block_idx == 0 && block_offsets[0] != sizeof(CompressedFileHeader) + sizeof(uint64_t)*(n_blocks + 1)) ||
+            block_offsets[block_idx + 1] < block_offsets[block_idx] ||
+            block_offsets[block_idx + 1] - block_offsets[block_idx] > max_compressed_block_size)
+        {
+            free(block_offsets);
+            close(file_descriptor);
+            print_error_message("File %s has invalid block offsets.", filename);
+            return NULL;
+        }
+    }
+
+    float* const data = (float*)malloc(sizeof(float)*length);
+
+    if (!data)
+    {
+        free(block_offsets);
+        close(file_descriptor);
+        print_error_message("Could not allocate %d bytes.", sizeof(float)*length);
+        return NULL;
+    }
+
+    const unsigned int n_threads = (unsigned int)min_size_t(get_worker_thread_count(), n_blocks);
+
+    BlockDecompression block_decompression;
+    block_decompression.file_descriptor = file_descriptor;
+    block_decompression.values = (uint32_t*)data;
+    block_decompression.length = length;
+    block_decompression.block_length = block_length;
+    block_decompression.block_offsets = block_offsets;
+    block_decompression.compressed_buffers = (unsigned char**)malloc(sizeof(unsigned char*)*n_threads);
+    check(block_decompression.compressed_buffers);
+    block_decompression.block_failed = (int*)calloc(n_blocks, sizeof(int));
+    check(block_decompression.block_failed);
+
+    unsigned int thread_idx;
+
+    for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+    {
+        block_decompression.compressed_buffers[thread_idx] = (unsigned char*)malloc(max_compressed_block_size);
+        check(block_decompression.compressed_buffers[thread_idx]);
+    }
+
+    const double start_time = get_wall_clock_time();
+
+    run_parallel_tasks(decompress_block, &block_decompression, n_blocks, n_threads);
+
+    const double elapsed_time = get_wall_clock_time() - start_time;
+
+    close(file_descriptor);
+
+    for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+        free(block_decompression.compressed_buffers[thread_idx]);
+
+    free(block_decompression.compressed_buffers);
+
+    int read_failed = 0;
+
+    for (block_idx = 0; block_idx < n_blocks; block_idx++)
+        read_failed = read_failed || block_decompression.block_failed[block_idx];
+
+    free(block_decompression.block_failed);
+
+    const size_t compressed_size = (size_t)block_offsets[n_blocks];
+
+    free(block_offsets);
+
+    if (read_failed)
+    {
+        free(data);
+        print_error_message("Could not read compressed file %s.", filename);
+        return NULL;
+    }
+
+    const double n_megabytes = (double)(sizeof(float)*length)/(1024.0*1024.0);
+
+    print_info_message("Read %.1f MB (%.1f MB compressed) from %s in %.2f s (%.1f MB/s using %u threads).",
+                       n_megabytes, (double)compressed_size/(1024.0*1024.0), filename, elapsed_time,
+                       (elapsed_time > 0) ? n_megabytes/elapsed_time : 0.0,
+                       n_threads);
+
+    return data;
+}
+
+void* map_binary_file(const char* filename, size_t length, size_t element_size)
+{
+    /*
+    Maps the content of a binary file read-only into memory. The pages are
+    backed directly by the page cache, so no private copy of the data is
+    ever made as long as the mapping is not written to.
+    */
+
+    check(filename);
+
+    const size_t n_bytes = length*element_size;
+
+    if (n_bytes == 0)
+    {
+        print_error_message("Cannot map an empty range of file %s.", filename);
+        return NULL;
+    }
+
+    const int file_descriptor = open(filename, O_RDONLY);
+
+    if (file_descriptor < 0)
+    {
+        print_error_message("Could not open file %s.", filename);
+        return NULL;
+    }
+
+    struct stat file_status;
+
+    if (fstat(file_descriptor, &file_status) != 0)
+    {
+        close(file_descriptor);
+        print_error_message("Could not determine size of file %s.", filename);
+        return NULL;
+    }
+
+    if ((size_t)file_status.st_size < n_bytes)
+    {
+        close(file_descriptor);
+        print_error_message("File %s is smaller than the requested %d bytes.", filename, n_bytes);
+        return NULL;
+    }
+
+    void* const data = mmap(NULL, n_bytes, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+
+    // The mapping remains valid after the file descriptor is closed
+    close(file_descriptor);
+
+    if (data == MAP_FAILED)
+    {
+        print_error_message("Could not map file %s into memory.", filename);
+        return NULL;
+    }
+
+    // Start reading the file in the background since all of it will be needed soon
+    posix_madvise(data, n_bytes, POSIX_MADV_WILLNEED);
+
+    return data;
+}
+
+void unmap_binary_file(void* data, size_t length, size_t element_size)
+{
+    check(data);
+
+    if (munmap(data, length*element_size) != 0)
+        print_error_message("Could not unmap file data.");
+}
+
+int write_binary_file(const char* filename, const void* header, size_t header_size, const void* data, size_t data_size)
+{
+    /*
+    Writes the given header bytes followed by the given data bytes to a binary
+    file. The content is first written to a temporary file, which then replaces
+    the target file, so that a partially written file is never observed under
+    the target name. Returns 1 if successful and 0 otherwise.
+    */
+
+    check(header || header_size == 0);
+    check(data || data_size == 0);
+
+    const void* const sections[2] = {header, data};
+    const size_t section_sizes[2] = {header_size, data_size};
+
+    return write_binary_file_sections(filename, sections, section_sizes, 2);
+}
+
+int write_binary_file_sections(const char* filename, const void* const* sections, const size_t* section_sizes, size_t n_sections)
+{
+    /*
+    Like write_binary_file, but writes any number of sections of bytes after
+    each other. A NULL section is written as the given number of zero bytes,
+    which is useful for padding.
+    */
+
+    check(filename);
+    check(sections || n_sections == 0);
+    check(section_sizes || n_sections == 0);
+
+    DynamicString temporary_filename = create_string("%s.tmp", filename);
+
+    const int file_descriptor = open(temporary_filename.chars, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (file_descriptor < 0)
+    {
+        print_error_message("Could not open file %s for writing.", temporary_filename.chars);
+        clear_string(&temporary_filename);
+        return 0;
+    }
+
+    int write_succeeded = 1;
+
+    for (size_t section_idx = 0; section_idx < n_sections && write_succeeded; section_idx++)
+    {
+        write_succeeded = sections[section_idx] ?
+                          write_file_range(file_descriptor, (const char*)sections[section_idx], section_sizes[section_idx]) :
+                          write_zeros(file_descriptor, section_sizes[section_idx]);
+    }
+
+    write_succeeded = (close(file_descriptor) == 0) && write_succeeded;
+
+    if (write_succeeded)
+        write_succeeded = rename(temporary_filename.chars, filename) == 0;
+
+    if (!write_succeeded)
+    {
+        unlink(temporary_filename.chars);
+        print_error_message("Could not write file %s.", filename);
+    }
+
+    clear_string(&temporary_filename);
+
+    return write_succeeded;
+}
+
+int get_file_size_and_modification_time(const char* filename, size_t* size, int64_t* modification_time)
+{
+    /*
+    Obtains the size in bytes and the modification time in nanoseconds since
+    the epoch of the given file. Returns 0 without printing anything if the
+    file could not be examined (typically because it does not exist).
+    */
+
+    check(filename);
+    check(size);
+    check(modification_time);
+
+    struct stat file_status;
+
+    if (stat(filename, &file_status) != 0)
+        return 0;
+
+    *size = (size_t)file_status.st_size;
+
+    // The nanosecond part of the modification time is named differently on macOS
+#if defined(__APPLE__)
+    *modification_time = (int64_t)file_status.st_mtimespec.tv_sec*1000000000 + (int64_t)file_status.st_mtimespec.tv_nsec;
+#else
+    *modification_time = (int64_t)file_status.st_mtim.tv_sec*1000000000 + (int64_t)file_status.st_mtim.tv_nsec;
+#endif
+
+    return 1;
+}
+
+int has_entry_in_header(const char* header, const char* entry_name, const char* separator)
+{
+    check(header);
+    check(entry_name);
+    check(separator);
+
+    char* header_copy = create_string_copy(header);
+
+    const int has_entry = find_entry_in_header(header_copy, entry_name, separator) != NULL;
+
+    free(header_copy);
+
+    return has_entry;
+}
+
 int find_int_entry_in_header(const char* header, const char* entry_name, const char* separator)
 {
     check(header);
@@ -220,6 +933,563 @@ char find_char_entry_in_header(const char* header, const char* entry_name, const
     return entry;
 }
 
+static void* read_chunked_binary_file(const char* filename, size_t length, size_t element_size,
+                                      int swap_byte_order, int convert_to_float,
+                                      const BinaryFileReadingConfiguration* reading_configuration)
+{
+    /*
+    Reads the content of a binary file into a newly allocated array. The file
+    is split into aligned chunks that are read concurrently with pread by a
+    number of worker threads. If requested, the byte order of each element is
+    reversed by the worker thread right after reading the chunk, while it is
+    still in cache. Likewise, elements that are to be converted to single
+    precision are read into a per-thread buffer and converted from there.
+    */
+
+    check(filename);
+    check(reading_configuration);
+
+    const size_t n_bytes = length*element_size;
+
+    if (n_bytes == 0)
+    {
+        print_error_message("Cannot read an empty range of file %s.", filename);
+        return NULL;
+    }
+
+    const int file_descriptor = open(filename, O_RDONLY);
+
+    if (file_descriptor < 0)
+    {
+        print_error_message("Could not open file %s.", filename);
+        return NULL;
+    }
+
+    const int needs_conversion = convert_to_float && element_size != sizeof(float);
+    const size_t n_output_bytes = needs_conversion ? length*sizeof(float) : n_bytes;
+
+    char* const data = (char*)malloc(n_output_bytes);
+
+    if (!data)
+    {
+        close(file_descriptor);
+        print_error_message("Could not allocate %d bytes.", n_output_bytes);
+        return NULL;
+    }
+
+    const size_t chunk_size = reading_configuration->reading_chunk_size;
+    const size_t n_chunks = (n_bytes + chunk_size - 1)/chunk_size;
+    const unsigned int n_threads = (unsigned int)min_size_t(reading_configuration->n_reading_threads, n_chunks);
+
+    ChunkedRead chunked_read;
+    chunked_read.file_descriptor = file_descriptor;
+    chunked_read.destination = data;
+    chunked_read.conversion_buffers = NULL;
+    chunked_read.n_bytes = n_bytes;
+    chunked_read.chunk_size = chunk_size;
+    chunked_read.element_size = element_size;
+    chunked_read.swap_byte_order = swap_byte_order;
+    chunked_read.chunk_failed = (int*)calloc(n_chunks, sizeof(int));
+    check(chunked_read.chunk_failed);
+
+    unsigned int thread_idx;
+
+    if (needs_conversion)
+    {
+        chunked_read.conversion_buffers = (char**)malloc(sizeof(char*)*n_threads);
+        check(chunked_read.conversion_buffers);
+
+        for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+        {
+            chunked_read.conversion_buffers[thread_idx] = (char*)malloc(chunked_read.chunk_size);
+            check(chunked_read.conversion_buffers[thread_idx]);
+        }
+    }
+
+    const double start_time = get_wall_clock_time();
+
+    run_parallel_tasks(read_file_chunk, &chunked_read, n_chunks, n_threads);
+
+    const double elapsed_time = get_wall_clock_time() - start_time;
+
+    close(file_descriptor);
+
+    if (needs_conversion)
+    {
+        for (thread_idx = 0; thread_idx < n_threads; thread_idx++)
+            free(chunked_read.conversion_buffers[thread_idx]);
+
+        free(chunked_read.conversion_buffers);
+    }
+
+    size_t chunk_idx;
+    int read_failed = 0;
+
+    for (chunk_idx = 0; chunk_idx < n_chunks; chunk_idx++)
+        read_failed = read_failed || chunked_read.chunk_failed[chunk_idx];
+
+    free(chunked_read.chunk_failed);
+
+    if (read_failed)
+    {
+        free(data);
+        print_error_message("Could not read file %s.", filename);
+        return NULL;
+    }
+
+    const double n_megabytes = (double)n_bytes/(1024.0*1024.0);
+
+    print_info_message("Read %.1f MB from %s in %.2f s (%.1f MB/s using %u threads).",
+                       n_megabytes, filename, elapsed_time,
+                       (elapsed_time > 0) ? n_megabytes/elapsed_time : 0.0,
+                       n_threads);
+
+    return data;
+}
+
+static void read_file_chunk(void* shared_data, size_t chunk_idx, unsigned int thread_idx)
+{
+    ChunkedRead* const chunked_read = (ChunkedRead*)shared_data;
+    assert(chunked_read);
+
+    const size_t chunk_offset = chunk_idx*chunked_read->chunk_size;
+    const size_t chunk_size = min_size_t(chunked_read->chunk_size, chunked_read->n_bytes - chunk_offset);
+
+    const size_t element_size = chunked_read->element_size;
+
+    // Chunk sizes are multiples of the read alignment, so chunks never split an element
+    const size_t element_offset = chunk_offset/element_size;
+    const size_t n_chunk_elements = chunk_size/element_size;
+
+    char* const chunk_data = chunked_read->conversion_buffers ?
+                             chunked_read->conversion_buffers[thread_idx] :
+                             chunked_read->destination + chunk_offset;
+
+    chunked_read->chunk_failed[chunk_idx] = !read_file_range(chunked_read->file_descriptor,
+                                                             chunk_data, chunk_size, chunk_offset);
+
+    if (chunked_read->chunk_failed[chunk_idx])
+        return;
+
+    if (chunked_read->swap_byte_order)
+        swap_byte_order(chunk_data, n_chunk_elements, element_size);
+
+    if (chunked_read->conversion_buffers)
+        convert_to_single_precision(chunk_data, n_chunk_elements, element_size,
+                                    (float*)chunked_read->destination + element_offset);
+}
+
+static void read_file_region_plane(void* shared_data, size_t plane_idx, unsigned int thread_idx)
+{
+    RegionRead* const region_read = (RegionRead*)shared_data;
+    assert(region_read);
+
+    const size_t* const file_shape = region_read->file_shape;
+    const size_t* const region_start = region_read->region_start;
+    const size_t* const region_shape = region_read->region_shape;
+    const size_t* const region_stride = region_read->region_stride;
+    const size_t element_size = region_read->element_size;
+
+    const size_t n_plane_elements = region_shape[0]*region_shape[1];
+
+    float* const output_plane = region_read->destination + plane_idx*n_plane_elements;
+
+    char* const plane_data = region_read->conversion_buffers ?
+                             region_read->conversion_buffers[thread_idx] :
+                             (char*)output_plane;
+
+    // Index of the first element of the region within this plane of the file
+    const size_t first_element_idx = ((region_start[2] + plane_idx*region_stride[2])*file_shape[1] + region_start[1])*file_shape[0] + region_start[0];
+
+    // Distance between the first elements of consecutive rows of the region within the file
+    const size_t row_stride = region_stride[1]*file_shape[0];
+
+    const size_t row_size = region_shape[0]*element_size;
+    const size_t row_span_size = ((region_shape[0] - 1)*region_stride[0] + 1)*element_size;
+    size_t i, j;
+
+    if (region_shape[0] == file_shape[0] && region_stride[1] == 1)
+    {
+        region_read->plane_failed[plane_idx] = !read_file_range(region_read->file_descriptor,
+                                                                plane_data, n_plane_elements*element_size,
+                                                                first_element_idx*element_size);
+    }
+    else if (region_read->row_buffers)
+    {
+        char* const row_data = region_read->row_buffers[thread_idx];
+
+        for (j = 0; j < region_shape[1]; j++)
+        {
+            if (!read_file_range(region_read->file_descriptor,
+                                 row_data, row_span_size,
+                                 (first_element_idx + j*row_stride)*element_size))
+            {
+                region_read->plane_failed[plane_idx] = 1;
+                break;
+            }
+
+            for (i = 0; i < region_shape[0]; i++)
+                memcpy(plane_data + j*row_size + i*element_size, row_data + i*region_stride[0]*element_size, element_size);
+        }
+    }
+    else
+    {
+        for (j = 0; j < region_shape[1]; j++)
+        {
+            if (!read_file_range(region_read->file_descriptor,
+                                 plane_data + j*row_size, row_size,
+                                 (first_element_idx + j*row_stride)*element_size))
+            {
+                region_read->plane_failed[plane_idx] = 1;
+                break;
+            }
+        }
+    }
+
+    if (region_read->plane_failed[plane_idx])
+        return;
+
+    if (region_read->swap_byte_order)
+        swap_byte_order(plane_data, n_plane_elements, element_size);
+
+    if (region_read->conversion_buffers)
+        convert_to_single_precision(plane_data, n_plane_elements, element_size, output_plane);
+}
+
+static size_t get_max_compressed_block_size(size_t block_length)
+{
+    // In the worst case, every value requires its full 4 bytes in addition to its 4-bit code
+    return (block_length + 1)/2 + sizeof(uint32_t)*block_length;
+}
+
+static void compress_block(void* shared_data, size_t block_idx, unsigned int thread_idx)
+{
+    BlockCompression* const block_compression = (BlockCompression*)shared_data;
+    assert(block_compression);
+
+    const size_t block_offset = block_idx*block_compression->block_length;
+    const size_t block_length = min_size_t(block_compression->block_length, block_compression->length - block_offset);
+
+    block_compression->compressed_block_sizes[block_idx] =
+        compress_values(block_compression->values + block_offset,
+                        block_length,
+                        block_compression->compressed_data + block_idx*block_compression->max_compressed_block_size);
+}
+
+static void decompress_block(void* shared_data, size_t block_idx, unsigned int thread_idx)
+{
+    BlockDecompression* const block_decompression = (BlockDecompression*)shared_data;
+    assert(block_decompression);
+
+    const size_t block_offset = block_idx*block_decompression->block_length;
+    const size_t block_length = min_size_t(block_decompression->block_length, block_decompression->length - block_offset);
+
+    const size_t file_offset = (size_t)block_decompression->block_offsets[block_idx];
+    const size_t compressed_size = (size_t)block_decompression->block_offsets[block_idx + 1] - file_offset;
+
+    unsigned char* const compressed_data = block_decompression->compressed_buffers[thread_idx];
+
+    block_decompression->block_failed[block_idx] =
+        !read_file_range(block_decompression->file_descriptor, (char*)compressed_data, compressed_size, file_offset) ||
+        !decompress_values(compressed_data, compressed_size, block_length, block_decompression->values + block_offset);
+}
+
+static size_t compress_values(const uint32_t* values, size_t length, unsigned char* compressed_data)
+{
+    assert(values);
+    assert(compressed_data);
+
+    // Each code takes up half a byte, and the residual bytes follow all the codes
+    unsigned char* const codes = compressed_data;
+    unsigned char* residual_bytes = compressed_data + (length + 1)/2;
+
+    memset(codes, 0, (length + 1)/2);
+
+    ValuePredictor* const predictor = (ValuePredictor*)malloc(sizeof(ValuePredictor));
+    check(predictor);
+    reset_value_predictor(predictor);
+
+    size_t i;
+    unsigned int byte_idx;
+
+    for (i = 0; i < length; i++)
+    {
+        const uint32_t value = values[i];
+
+        const uint32_t fcm_residual = value ^ predictor->fcm_table[predictor->fcm_hash];
+        const uint32_t dfcm_residual = value ^ (predictor->dfcm_table[predictor->dfcm_hash] + predictor->last_value);
+
+        const unsigned int fcm_zero_bytes = count_leading_zero_bytes(fcm_residual);
+        const unsigned int dfcm_zero_bytes = count_leading_zero_bytes(dfcm_residual);
+
+        const unsigned int use_dfcm = dfcm_zero_bytes > fcm_zero_bytes;
+        const uint32_t residual = use_dfcm ? dfcm_residual : fcm_residual;
+        const unsigned int n_zero_bytes = use_dfcm ? dfcm_zero_bytes : fcm_zero_bytes;
+
+        codes[i >> 1] |= (unsigned char)(((use_dfcm << 3) | n_zero_bytes) << ((i & 1) << 2));
+
+        for (byte_idx = 0; byte_idx < 4 - n_zero_bytes; byte_idx++)
+            *(residual_bytes++) = (unsigned char)(residual >> (8*byte_idx));
+
+        // Update the predictors exactly as the decompressor will
+        const uint32_t difference = value - predictor->last_value;
+        predictor->fcm_table[predictor->fcm_hash] = value;
+        predictor->fcm_hash = ((predictor->fcm_hash << 6) ^ (value >> 22)) & (COMPRESSION_TABLE_SIZE - 1);
+        predictor->dfcm_table[predictor->dfcm_hash] = difference;
+        predictor->dfcm_hash = ((predictor->dfcm_hash << 2) ^ (difference >> 24)) & (COMPRESSION_TABLE_SIZE - 1);
+        predictor->last_value = value;
+    }
+
+    free(predictor);
+
+    return (size_t)(residual_bytes - compressed_data);
+}
+
+static int decompress_values(const unsigned char* compressed_data, size_t compressed_size, size_t length, uint32_t* values)
+{
+    assert(compressed_data);
+    assert(values);
+
+    const size_t codes_size = (length + 1)/2;
+
+    if (compressed_size < codes_size)
+        return 0;
+
+    const unsigned char* const codes = compressed_data;
+    const unsigned char* residual_bytes = compressed_data + codes_size;
+    const unsigned char* const end = compressed_data + compressed_size;
+
+    ValuePredictor* const predictor = (ValuePredictor*)malloc(sizeof(ValuePredictor));
+    check(predictor);
+    reset_value_predictor(predictor);
+
+    size_t i;
+    unsigned int byte_idx;
+    int is_valid = 1;
+
+    for (i = 0; i < length; i++)
+    {
+        const unsigned int code = (codes[i >> 1] >> ((i & 1) << 2)) & 0xF;
+        const unsigned int use_dfcm = code >> 3;
+        const unsigned int n_zero_bytes = code & 0x7;
+        const unsigned int n_residual_bytes = 4 - n_zero_bytes;
+
+        if (n_zero_bytes > 4 || residual_bytes + n_residual_bytes > end)
+        {
+            is_valid = 0;
+            break;
+        }
+
+        uint32_t residual = 0;
+
+        for (byte_idx = 0; byte_idx < n_residual_bytes; byte_idx++)
+            residual |= (uint32_t)(*(residual_bytes++)) << (8*byte_idx);
+
+        const uint32_t prediction = use_dfcm ?
+                                    predictor->dfcm_table[predictor->dfcm_hash] + predictor->last_value :
+                                    predictor->fcm_table[predictor->fcm_hash];
+
+        const uint32_t value = residual ^ prediction;
+        values[i] = value;
+
+        const uint32_t difference = value - predictor->last_value;
+        predictor->fcm_table[predictor->fcm_hash] = value;
+        predictor->fcm_hash = ((predictor->fcm_hash << 6) ^ (value >> 22)) & (COMPRESSION_TABLE_SIZE - 1);
+        predictor->dfcm_table[predictor->dfcm_hash] = difference;
+        predictor->dfcm_hash = ((predictor->dfcm_hash << 2) ^ (difference >> 24)) & (COMPRESSION_TABLE_SIZE - 1);
+        predictor->last_value = value;
+    }
+
+    free(predictor);
+
+    return is_valid && residual_bytes == end;
+}
+
+static void reset_value_predictor(ValuePredictor* predictor)
+{
+    assert(predictor);
+
+    memset(predictor->fcm_table, 0, sizeof(predictor->fcm_table));
+    memset(predictor->dfcm_table, 0, sizeof(predictor->dfcm_table));
+    predictor->fcm_hash = 0;
+    predictor->dfcm_hash = 0;
+    predictor->last_value = 0;
+}
+
+static unsigned int count_leading_zero_bytes(uint32_t value)
+{
+    return (value == 0) ? 4 : (unsigned int)__builtin_clz(value)/8;
+}
+
+static int read_file_range(int file_descriptor, char* destination, size_t n_bytes, size_t file_offset)
+{
+    assert(destination);
+
+    ssize_t n_read_bytes;
+
+    // A single pread may return fewer bytes than requested, so keep reading until the range is filled
+    while (n_bytes > 0)
+    {
+        n_read_bytes = pread(file_descriptor, destination, n_bytes, (off_t)file_offset);
+
+        if (n_read_bytes < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return 0;
+        }
+
+        // Reaching the end of the file before the range is filled means the file is too short
+        if (n_read_bytes == 0)
+            return 0;
+
+        destination += n_read_bytes;
+        n_bytes -= (size_t)n_read_bytes;
+        file_offset += (size_t)n_read_bytes;
+    }
+
+    return 1;
+}
+
+static int write_file_range(int file_descriptor, const char* source, size_t n_bytes)
+{
+    assert(source || n_bytes == 0);
+
+    ssize_t n_written_bytes;
+
+    while (n_bytes > 0)
+    {
+        n_written_bytes = write(file_descriptor, source, n_bytes);
+
+        if (n_written_bytes < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return 0;
+        }
+
+        source += n_written_bytes;
+        n_bytes -= (size_t)n_written_bytes;
+    }
+
+    return 1;
+}
+
+static int write_zeros(int file_descriptor, size_t n_bytes)
+{
+    static const char zeros[4096] = {0};
+
+    while (n_bytes > 0)
+    {
+        const size_t n_chunk_bytes = n_bytes < sizeof(zeros) ? n_bytes : sizeof(zeros);
+
+        if (!write_file_range(file_descriptor, zeros, n_chunk_bytes))
+            return 0;
+
+        n_bytes -= n_chunk_bytes;
+    }
+
+    return 1;
+}
+
+static void swap_byte_order(void* data, size_t length, size_t element_size)
+{
+    assert(data);
+    check(element_size == 2 || element_size == 4 || element_size == 8);
+
+    size_t i = 0;
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+    // Byte shuffle patterns reversing the bytes within each 2, 4 or 8 byte element
+    static const char reversed_2[16] = {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14};
+    static const char reversed_4[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+    static const char reversed_8[16] = {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8};
+
+    const char* const pattern = (element_size == 2) ? reversed_2 : ((element_size == 4) ? reversed_4 : reversed_8);
+
+    char* const bytes = (char*)data;
+    const size_t n_bytes = length*element_size;
+    size_t byte_idx = 0;
+
+#if defined(__AVX2__)
+    // The shuffle operates within each 128-bit lane, so the same pattern is used for both lanes
+    const __m256i wide_shuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)pattern));
+
+    for (; byte_idx + 32 <= n_bytes; byte_idx += 32)
+    {
+        const __m256i values = _mm256_loadu_si256((const __m256i*)(bytes + byte_idx));
+        _mm256_storeu_si256((__m256i*)(bytes + byte_idx), _mm256_shuffle_epi8(values, wide_shuffle));
+    }
+#endif
+
+    const __m128i shuffle = _mm_loadu_si128((const __m128i*)pattern);
+
+    for (; byte_idx + 16 <= n_bytes; byte_idx += 16)
+    {
+        const __m128i values = _mm_loadu_si128((const __m128i*)(bytes + byte_idx));
+        _mm_storeu_si128((__m128i*)(bytes + byte_idx), _mm_shuffle_epi8(values, shuffle));
+    }
+
+    i = byte_idx/element_size;
+#endif
+
+    // Swap the remaining elements (or all of them if no vector instructions are available)
+    if (element_size == 2)
+    {
+        uint16_t* const elements = (uint16_t*)data;
+        for (; i < length; i++)
+            elements[i] = __builtin_bswap16(elements[i]);
+    }
+    else if (element_size == 4)
+    {
+        uint32_t* const elements = (uint32_t*)data;
+        for (; i < length; i++)
+            elements[i] = __builtin_bswap32(elements[i]);
+    }
+    else
+    {
+        uint64_t* const elements = (uint64_t*)data;
+        for (; i < length; i++)
+            elements[i] = __builtin_bswap64(elements[i]);
+    }
+}
+
+static void convert_to_single_precision(const void* input_array, size_t length, size_t element_size, float* output_array)
+{
+    assert(input_array);
+    assert(output_array);
+    check(element_size == 2 || element_size == 8);
+
+    size_t i = 0;
+
+    if (element_size == 2)
+    {
+        const uint16_t* const half_values = (const uint16_t*)input_array;
+
+#if defined(__F16C__)
+        for (; i + 8 <= length; i += 8)
+            _mm256_storeu_ps(output_array + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(half_values + i))));
+#endif
+
+        for (; i < length; i++)
+            output_array[i] = half_to_float(half_values[i]);
+    }
+    else
+    {
+        const double* const double_values = (const double*)input_array;
+
+#if defined(__AVX__)
+        for (; i + 4 <= length; i += 4)
+            _mm_storeu_ps(output_array + i, _mm256_cvtpd_ps(_mm256_loadu_pd(double_values + i)));
+#endif
+
+        for (; i < length; i++)
+            output_array[i] = (float)double_values[i];
+    }
+}
+
 static char* create_string_copy(const char* string)
 {
     check(string);
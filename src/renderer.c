@@ -5,6 +5,8 @@
 #include "geometry.h"
 #include "colors.h"
 #include "fields.h"
+#include "field_loading.h"
+#include "time_series.h"
 #include "trackball.h"
 #include "transformation.h"
 #include "indicators.h"
@@ -28,6 +30,7 @@ typedef struct SingleFieldRenderingState
 static void initialize_rendering_settings(void);
 static void pre_initialize_single_field_rendering(void);
 static void post_initialize_single_field_rendering(void);
+static void activate_single_field_rendering_field(Field* field);
 
 
 static ShaderProgram rendering_shader_program;
@@ -59,6 +62,8 @@ void initialize_renderer(void)
 
     initialize_rendering_settings();
     initialize_fields();
+    initialize_field_loading();
+    initialize_time_series();
     initialize_trackball();
     initialize_transformation();
     initialize_planes();
@@ -99,6 +104,8 @@ void cleanup_renderer(void)
     cleanup_clip_planes();
     cleanup_planes();
     cleanup_transformation();
+    cleanup_time_series();
+    cleanup_field_loading();
     cleanup_fields();
     cleanup_indicators();
     destroy_shader_program(&indicator_shader_program);
@@ -155,11 +162,21 @@ void set_single_field_rendering_field(const char* field_name)
     Field* const field = get_field(field_name);
 
     set_field_texture_field(single_field_rendering_state.texture_name, field);
-    set_max_clip_plane_origin_shifts(field->halfwidth, field->halfheight, field->halfdepth);
-    set_active_bricked_field(get_field_texture_bricked_field(single_field_rendering_state.texture_name));
-    set_plane_separation(0.5f);
 
-    has_data = 1;
+    activate_single_field_rendering_field(field);
+}
+
+void set_single_field_rendering_bricked_field(BrickedField* bricked_field)
+{
+    check(single_field_rendering_state.texture_name);
+    check(bricked_field);
+
+    Field* const field = bricked_field->field;
+    check(field);
+
+    set_field_texture_bricked_field(single_field_rendering_state.texture_name, bricked_field);
+
+    activate_single_field_rendering_field(field);
 }
 
 static void initialize_rendering_settings(void)
@@ -205,3 +222,14 @@ static void post_initialize_single_field_rendering(void)
     set_view_distance(2.0f);
     update_camera_aspect_ratio(get_window_aspect_ratio());
 }
+
+static void activate_single_field_rendering_field(Field* field)
+{
+    assert(field);
+
+    set_max_clip_plane_origin_shifts(field->halfwidth, field->halfheight, field->halfdepth);
+    set_active_bricked_field(get_field_texture_bricked_field(single_field_rendering_state.texture_name));
+    set_plane_separation(0.5f);
+
+    has_data = 1;
+}
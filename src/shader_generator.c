@@ -130,12 +130,16 @@ size_t apply_scalar_field_texture_sampling_in_shader(ShaderSource* source, const
 
     Variable* const variable = create_variable(source);
 
+    // Constant bricks have no texture, and their value is supplied instead when it is non-negative
+    const char* brick_constant_value_name = "brick_constant_value";
+
     set_string(&variable->expression,
-               "    float variable_%d = texture(%s, %s).r;\n",
-               variable->number, texture_name, texture_coordinates_name);
+               "    float variable_%d = (%s >= 0.0) ? %s : texture(%s, %s).r;\n",
+               variable->number, brick_constant_value_name, brick_constant_value_name, texture_name, texture_coordinates_name);
 
     add_global_dependency(variable, texture_name);
     add_global_dependency(variable, texture_coordinates_name);
+    add_global_dependency(variable, brick_constant_value_name);
 
     return variable->number;
 }
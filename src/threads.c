@@ -0,0 +1,217 @@
+#include "threads.h"
+
+#include "error.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+
+typedef struct TaskPool
+{
+    ParallelTask task;
+    void* shared_data;
+    size_t n_tasks;
+    size_t next_task_idx;
+    pthread_mutex_t mutex;
+} TaskPool;
+
+typedef struct Worker
+{
+    TaskPool* pool;
+    unsigned int thread_idx;
+    pthread_t thread;
+} Worker;
+
+
+static void* run_worker(void* worker_ptr);
+static int acquire_next_task(TaskPool* pool, size_t* task_idx);
+static void* run_background_task(void* background_thread_ptr);
+
+
+// A count of zero means that all available processors are used
+static unsigned int worker_thread_count = 0;
+
+
+unsigned int get_available_processor_count(void)
+{
+    const long n_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n_processors > 0) ? (unsigned int)n_processors : 1;
+}
+
+void set_worker_thread_count(unsigned int n_threads)
+{
+    check(n_threads > 0);
+    worker_thread_count = n_threads;
+}
+
+unsigned int get_worker_thread_count(void)
+{
+    return (worker_thread_count > 0) ? worker_thread_count : get_available_processor_count();
+}
+
+void run_parallel_tasks(ParallelTask task, void* shared_data, size_t n_tasks, unsigned int n_threads)
+{
+    /*
+    Executes the given task function once for every task index in [0, n_tasks),
+    distributing the tasks dynamically over the given number of threads. The
+    calling thread acts as thread 0, and the function returns when all tasks
+    have completed.
+    */
+
+    check(task);
+
+    if (n_tasks == 0)
+        return;
+
+    if (n_threads > n_tasks)
+        n_threads = (unsigned int)n_tasks;
+
+    size_t task_idx;
+
+    if (n_threads <= 1)
+    {
+        for (task_idx = 0; task_idx < n_tasks; task_idx++)
+            task(shared_data, task_idx, 0);
+
+        return;
+    }
+
+    TaskPool pool;
+    pool.task = task;
+    pool.shared_data = shared_data;
+    pool.n_tasks = n_tasks;
+    pool.next_task_idx = 0;
+
+    if (pthread_mutex_init(&pool.mutex, NULL) != 0)
+        print_severe_message("Could not initialize mutex for task pool.");
+
+    Worker* const workers = (Worker*)malloc(sizeof(Worker)*n_threads);
+    check(workers);
+
+    unsigned int thread_idx;
+
+    for (thread_idx = 1; thread_idx < n_threads; thread_idx++)
+    {
+        workers[thread_idx].pool = &pool;
+        workers[thread_idx].thread_idx = thread_idx;
+
+        if (pthread_create(&workers[thread_idx].thread, NULL, run_worker, workers + thread_idx) != 0)
+            print_severe_message("Could not create worker thread.");
+    }
+
+    workers[0].pool = &pool;
+    workers[0].thread_idx = 0;
+    run_worker(workers);
+
+    for (thread_idx = 1; thread_idx < n_threads; thread_idx++)
+        pthread_join(workers[thread_idx].thread, NULL);
+
+    free(workers);
+
+    pthread_mutex_destroy(&pool.mutex);
+}
+
+void reset_background_thread(BackgroundThread* background_thread)
+{
+    check(background_thread);
+
+    background_thread->task = NULL;
+    background_thread->data = NULL;
+    background_thread->is_running = 0;
+    background_thread->has_finished = 0;
+}
+
+void start_background_thread(BackgroundThread* background_thread, BackgroundTask task, void* data)
+{
+    /*
+    Starts executing the given task function on a new thread. The background
+    thread structure must stay at the same address until the thread has been
+    joined.
+    */
+
+    check(background_thread);
+    check(task);
+    check(!background_thread->is_running);
+
+    background_thread->task = task;
+    background_thread->data = data;
+    background_thread->has_finished = 0;
+
+    if (pthread_create(&background_thread->thread, NULL, run_background_task, background_thread) != 0)
+        print_severe_message("Could not create background thread.");
+
+    background_thread->is_running = 1;
+}
+
+int background_thread_has_finished(BackgroundThread* background_thread)
+{
+    check(background_thread);
+    return background_thread->is_running && __atomic_load_n(&background_thread->has_finished, __ATOMIC_ACQUIRE);
+}
+
+void join_background_thread(BackgroundThread* background_thread)
+{
+    check(background_thread);
+    check(background_thread->is_running);
+
+    pthread_join(background_thread->thread, NULL);
+
+    reset_background_thread(background_thread);
+}
+
+double get_wall_clock_time(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + 1e-9*(double)time.tv_nsec;
+}
+
+static void* run_worker(void* worker_ptr)
+{
+    Worker* const worker = (Worker*)worker_ptr;
+    assert(worker);
+
+    TaskPool* const pool = worker->pool;
+    assert(pool);
+
+    size_t task_idx;
+
+    while (acquire_next_task(pool, &task_idx))
+        pool->task(pool->shared_data, task_idx, worker->thread_idx);
+
+    return NULL;
+}
+
+static int acquire_next_task(TaskPool* pool, size_t* task_idx)
+{
+    assert(pool);
+    assert(task_idx);
+
+    int has_task = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    if (pool->next_task_idx < pool->n_tasks)
+    {
+        *task_idx = pool->next_task_idx++;
+        has_task = 1;
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return has_task;
+}
+
+static void* run_background_task(void* background_thread_ptr)
+{
+    BackgroundThread* const background_thread = (BackgroundThread*)background_thread_ptr;
+    assert(background_thread);
+
+    background_thread->task(background_thread->data);
+
+    // Everything the task wrote becomes visible to a thread observing the flag
+    __atomic_store_n(&background_thread->has_finished, 1, __ATOMIC_RELEASE);
+
+    return NULL;
+}
@@ -0,0 +1,278 @@
+/*
+ * Time series of Bifrost snapshots are played back by keeping a ring of
+ * loadings for the frames following the current one. The loadings run on
+ * background threads, so that advancing to the next frame normally only
+ * requires transferring its already bricked data to the GPU. Whenever a frame
+ * is consumed, the loading of a new frame is started at the end of the ring.
+ */
+
+#include "time_series.h"
+
+#include "error.h"
+#include "dynamic_string.h"
+#include "field_loading.h"
+#include "threads.h"
+
+#include <string.h>
+
+
+#define MAX_TIME_SERIES_PREFETCH_COUNT 8
+
+
+typedef struct Configuration
+{
+    unsigned int prefetch_count;
+} Configuration;
+
+typedef struct TimeSeries
+{
+    int is_active;
+    DynamicString field_name;
+    DynamicString base_name_pattern;
+    unsigned int end_frame;
+    unsigned int current_frame;
+    unsigned int next_frame_to_load;
+    size_t loading_ids[MAX_TIME_SERIES_PREFETCH_COUNT];
+    unsigned int loading_frames[MAX_TIME_SERIES_PREFETCH_COUNT];
+    unsigned int first_loading_idx;
+    unsigned int n_loadings;
+    size_t last_stalled_loading_id;
+    size_t n_stalled_steps;
+    double total_stall_time;
+} TimeSeries;
+
+
+static int is_valid_frame_pattern(const char* pattern);
+static void fill_prefetch_ring(void);
+
+
+static Configuration configuration;
+
+static TimeSeries time_series;
+
+
+void initialize_time_series(void)
+{
+    configuration.prefetch_count = 3;
+
+    time_series.is_active = 0;
+    time_series.field_name = create_empty_string();
+    time_series.base_name_pattern = create_empty_string();
+    time_series.n_loadings = 0;
+}
+
+void set_time_series_prefetch_count(unsigned int prefetch_count)
+{
+    check(prefetch_count > 0);
+
+    if (prefetch_count > MAX_TIME_SERIES_PREFETCH_COUNT)
+    {
+        print_warning_message("Time series prefetch count cannot exceed %d.", MAX_TIME_SERIES_PREFETCH_COUNT);
+        prefetch_count = MAX_TIME_SERIES_PREFETCH_COUNT;
+    }
+
+    configuration.prefetch_count = prefetch_count;
+
+    if (time_series.is_active)
+        fill_prefetch_ring();
+}
+
+void start_time_series(const char* field_name, const char* base_name_pattern, unsigned int start_frame, unsigned int end_frame)
+{
+    /*
+    Starts prefetching the snapshots with frame numbers from start_frame to
+    end_frame (inclusive). The base name of the data and header file for each
+    snapshot is obtained by formatting the given pattern, which must contain a
+    single integer conversion (e.g. "snapshot_%03d"), with the frame number.
+    No frame is current until advance_time_series is called the first time.
+    */
+
+    check(field_name);
+    check(base_name_pattern);
+
+    if (!is_valid_frame_pattern(base_name_pattern))
+        print_severe_message("Time series file pattern \"%s\" must contain a single integer conversion.", base_name_pattern);
+
+    if (end_frame < start_frame)
+        print_severe_message("End frame of time series cannot be smaller than start frame.");
+
+    stop_time_series();
+
+    set_string(&time_series.field_name, "%s", field_name);
+    set_string(&time_series.base_name_pattern, "%s", base_name_pattern);
+
+    time_series.end_frame = end_frame;
+    time_series.current_frame = start_frame;
+    time_series.next_frame_to_load = start_frame;
+    time_series.first_loading_idx = 0;
+    time_series.n_loadings = 0;
+    time_series.last_stalled_loading_id = 0;
+    time_series.n_stalled_steps = 0;
+    time_series.total_stall_time = 0;
+    time_series.is_active = 1;
+
+    fill_prefetch_ring();
+}
+
+int advance_time_series(BrickedField* bricked_field, int wait)
+{
+    /*
+    Hands over the bricked field of the next frame if it has been loaded, or
+    if wait is true, after waiting for it to be loaded. Returns 1 if a bricked
+    field was handed over and 0 otherwise. Steps where the next frame was not
+    ready are counted as stalled, as a measure of how far the prefetching is
+    falling behind.
+    */
+
+    check(bricked_field);
+
+    if (!time_series.is_active || time_series.n_loadings == 0)
+        return 0;
+
+    const size_t loading_id = time_series.loading_ids[time_series.first_loading_idx];
+
+    const int is_ready = bricked_field_loading_has_finished(loading_id);
+
+    if (!is_ready)
+    {
+        // A step is only counted once even if it is attempted repeatedly
+        if (loading_id != time_series.last_stalled_loading_id)
+        {
+            time_series.n_stalled_steps++;
+            time_series.last_stalled_loading_id = loading_id;
+        }
+
+        if (!wait)
+            return 0;
+    }
+
+    const double start_time = get_wall_clock_time();
+
+    finish_loading_bricked_field(loading_id, bricked_field);
+
+    if (!is_ready)
+        time_series.total_stall_time += get_wall_clock_time() - start_time;
+
+    time_series.current_frame = time_series.loading_frames[time_series.first_loading_idx];
+
+    time_series.first_loading_idx = (time_series.first_loading_idx + 1) % MAX_TIME_SERIES_PREFETCH_COUNT;
+    time_series.n_loadings--;
+
+    fill_prefetch_ring();
+
+    return 1;
+}
+
+int time_series_has_ended(void)
+{
+    return !time_series.is_active || time_series.n_loadings == 0;
+}
+
+unsigned int get_current_time_series_frame(void)
+{
+    return time_series.current_frame;
+}
+
+void get_time_series_prefetch_status(unsigned int* n_ready_frames, unsigned int* n_loading_frames,
+                                     size_t* n_stalled_steps, double* total_stall_time)
+{
+    check(n_ready_frames);
+    check(n_loading_frames);
+    check(n_stalled_steps);
+    check(total_stall_time);
+
+    *n_ready_frames = 0;
+    *n_loading_frames = 0;
+
+    unsigned int idx;
+
+    for (idx = 0; idx < time_series.n_loadings; idx++)
+    {
+        if (bricked_field_loading_has_finished(time_series.loading_ids[(time_series.first_loading_idx + idx) % MAX_TIME_SERIES_PREFETCH_COUNT]))
+            (*n_ready_frames)++;
+        else
+            (*n_loading_frames)++;
+    }
+
+    *n_stalled_steps = time_series.n_stalled_steps;
+    *total_stall_time = time_series.total_stall_time;
+}
+
+void stop_time_series(void)
+{
+    unsigned int idx;
+
+    for (idx = 0; idx < time_series.n_loadings; idx++)
+        discard_bricked_field_loading(time_series.loading_ids[(time_series.first_loading_idx + idx) % MAX_TIME_SERIES_PREFETCH_COUNT]);
+
+    time_series.n_loadings = 0;
+    time_series.is_active = 0;
+}
+
+void cleanup_time_series(void)
+{
+    stop_time_series();
+
+    clear_string(&time_series.field_name);
+    clear_string(&time_series.base_name_pattern);
+}
+
+static int is_valid_frame_pattern(const char* pattern)
+{
+    assert(pattern);
+
+    size_t n_conversions = 0;
+    const char* character = pattern;
+
+    while ((character = strchr(character, '%')))
+    {
+        character++;
+
+        // Escaped percent signs are not conversions
+        if (*character == '%')
+        {
+            character++;
+            continue;
+        }
+
+        // Skip flags and field width
+        character += strspn(character, "0123456789-+ #");
+
+        if (*character != 'd' && *character != 'i' && *character != 'u')
+            return 0;
+
+        n_conversions++;
+    }
+
+    return n_conversions == 1;
+}
+
+static void fill_prefetch_ring(void)
+{
+    assert(time_series.is_active);
+
+    unsigned int ring_idx;
+
+    while (time_series.n_loadings < configuration.prefetch_count && time_series.next_frame_to_load <= time_series.end_frame)
+    {
+        const unsigned int frame = time_series.next_frame_to_load++;
+
+        DynamicString base_name = create_string(time_series.base_name_pattern.chars, frame);
+        DynamicString data_path = create_string("%s.raw", base_name.chars);
+        DynamicString header_path = create_string("%s.dat", base_name.chars);
+
+        // Each frame gets its own field name, so that it can coexist with the current frame while replacing it
+        DynamicString frame_field_name = create_string("%s[%u]", time_series.field_name.chars, frame);
+
+        ring_idx = (time_series.first_loading_idx + time_series.n_loadings) % MAX_TIME_SERIES_PREFETCH_COUNT;
+
+        time_series.loading_ids[ring_idx] = start_loading_bricked_field_from_bifrost_file(frame_field_name.chars, data_path.chars, header_path.chars);
+        time_series.loading_frames[ring_idx] = frame;
+        time_series.n_loadings++;
+
+        clear_string(&frame_field_name);
+        clear_string(&header_path);
+        clear_string(&data_path);
+        clear_string(&base_name);
+    }
+}
@@ -57,9 +57,14 @@ static float interior_transfer_function_node_to_texture_coordinate(unsigned int
 
 static void update_transfer_function_limit_quantities(TransferFunction* transfer_function);
 
-static void update_brick_tree_node_visibility_ratios(const TransferFunction* transfer_function, const Field* field, BrickTreeNode* node);
-static void update_sub_brick_tree_node_visibility_ratios(const TransferFunction* transfer_function, const Field* field, SubBrickTreeNode* node);
-static float compute_sub_brick_visibility_ratio(const TransferFunction* transfer_function, const Field* field, SubBrickTreeNode* node);
+static void update_brick_tree_visibility_ratios(const TransferFunction* transfer_function, BrickedField* bricked_field);
+static void update_sub_brick_tree_visibility_ratios(const TransferFunction* transfer_function, const uint8_t* visible_bins,
+                                                    const BrickedField* bricked_field, Brick* brick);
+static float compute_sub_brick_visibility_ratio(const uint8_t* visible_bins, const BrickedField* bricked_field, const Brick* brick, size_t node_idx);
+static void find_visible_value_histogram_bins(const TransferFunction* transfer_function, uint8_t* visible_bins);
+static int value_range_is_visible(const TransferFunction* transfer_function, float lower_value, float upper_value);
+static int value_is_visible(const TransferFunction* transfer_function, float value);
+static float compute_interior_alpha(const TransferFunction* transfer_function, float texture_coordinate);
 
 static void transfer_transfer_function_texture(TransferFunctionTexture* transfer_function_texture);
 
@@ -328,7 +333,38 @@ void update_visibility_ratios(const char* transfer_function_name, BrickedField*
     TransferFunctionTexture* const transfer_function_texture = get_transfer_function_texture(transfer_function_name);
     TransferFunction* const transfer_function = &transfer_function_texture->transfer_function;
 
-    update_brick_tree_node_visibility_ratios(transfer_function, bricked_field->field, bricked_field->tree);
+    update_brick_tree_visibility_ratios(transfer_function, bricked_field);
+}
+
+void update_visibility_ratios_from_opacities(const float* opacities, float lower_limit, float upper_limit,
+                                             BrickedField* bricked_field)
+{
+    /*
+    Like update_visibility_ratios, but for a transfer function given only by
+    the opacities of all its nodes and its value limits, so that no transfer
+    function texture, and hence no GL context, is needed. The opacities of the
+    lower and upper node apply to the values outside the limits.
+    */
+
+    check(opacities);
+    check(bricked_field);
+    check(bricked_field->field);
+    check(lower_limit >= 0.0f && lower_limit < upper_limit && upper_limit <= 1.0f);
+
+    TransferFunction transfer_function;
+    memset(&transfer_function, 0, sizeof(TransferFunction));
+
+    unsigned int node;
+    for (node = 0; node < TRANSFER_FUNCTION_SIZE; node++)
+        transfer_function.output[node][TF_ALPHA] = opacities[node];
+
+    transfer_function.limits.lower_limit = lower_limit;
+    transfer_function.limits.upper_limit = upper_limit;
+    transfer_function.limits.lower_visibility = opacities[TF_LOWER_NODE] > INVISIBLE_ALPHA;
+    transfer_function.limits.upper_visibility = opacities[TF_UPPER_NODE] > INVISIBLE_ALPHA;
+    update_transfer_function_limit_quantities(&transfer_function);
+
+    update_brick_tree_visibility_ratios(&transfer_function, bricked_field);
 }
 
 unsigned int texture_coordinate_to_nearest_transfer_function_node(float texture_coordinate)
@@ -404,95 +440,198 @@ static void update_transfer_function_limit_quantities(TransferFunction* transfer
                                         (1.0f - TEXTURE_COORDINATE_PAD)*transfer_function->limits.lower_limit)*transfer_function->limits.range_norm;
 }
 
-static void update_brick_tree_node_visibility_ratios(const TransferFunction* transfer_function, const Field* field, BrickTreeNode* node)
+static void update_brick_tree_visibility_ratios(const TransferFunction* transfer_function, BrickedField* bricked_field)
 {
+    /*
+    Since the nodes are stored in depth-first order, every child comes after its
+    parent in the array. Sweeping through the nodes in reverse order therefore
+    updates all the children before the parents that average them.
+    */
+
     assert(transfer_function);
-    assert(field);
-    assert(node);
+    assert(bricked_field);
 
-    if (node->brick)
-    {
-        update_sub_brick_tree_node_visibility_ratios(transfer_function, field, node->brick->tree);
-        node->visibility_ratio = node->brick->tree->visibility_ratio;
-    }
-    else
+    // The visibility of each histogram bin is found once, so that the leaves only need to count the voxels in visible bins
+    uint8_t visible_bins[VALUE_HISTOGRAM_BINS];
+    find_visible_value_histogram_bins(transfer_function, visible_bins);
+
+    // The bricks are visited in storage order, so that their histograms are read sequentially
+    size_t brick_idx;
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+        update_sub_brick_tree_visibility_ratios(transfer_function, visible_bins, bricked_field,
+                                                bricked_field->bricks + bricked_field->brick_storage_order[brick_idx]);
+
+    float* const visibility_ratios = bricked_field->tree_visibility_ratios;
+    size_t node_idx = bricked_field->n_tree_nodes;
+
+    while (node_idx-- > 0)
     {
-        assert(node->lower_child);
-        assert(node->upper_child);
+        BrickTreeNode* const node = bricked_field->tree + node_idx;
 
-        update_brick_tree_node_visibility_ratios(transfer_function, field, node->lower_child);
-        update_brick_tree_node_visibility_ratios(transfer_function, field, node->upper_child);
+        if (node->upper_child_idx == 0)
+            visibility_ratios[node_idx] = bricked_field->bricks[node->brick_idx].visibility_ratios[0];
+        else
+            visibility_ratios[node_idx] = 0.5f*(visibility_ratios[node_idx + 1] + visibility_ratios[node->upper_child_idx]);
 
-        node->visibility_ratio = 0.5f*(node->lower_child->visibility_ratio + node->upper_child->visibility_ratio);
+        node->visibility = UNDETERMINED_REGION_VISIBILITY;
     }
-
-    node->visibility = UNDETERMINED_REGION_VISIBILITY;
 }
 
-static void update_sub_brick_tree_node_visibility_ratios(const TransferFunction* transfer_function, const Field* field, SubBrickTreeNode* node)
+static void update_sub_brick_tree_visibility_ratios(const TransferFunction* transfer_function, const uint8_t* visible_bins,
+                                                    const BrickedField* bricked_field, Brick* brick)
 {
     assert(transfer_function);
-    assert(field);
-    assert(node);
+    assert(visible_bins);
+    assert(bricked_field);
+    assert(brick);
+
+    float* const visibility_ratios = brick->visibility_ratios;
+    size_t node_idx = brick->n_tree_nodes;
 
-    if (node->lower_child)
+    // All voxels of a constant brick have the same value, so every node is either fully visible or fully invisible
+    if (brick->is_constant)
     {
-        assert(node->upper_child);
+        const float visibility_ratio = value_is_visible(transfer_function, brick->constant_value) ? 1.0f : 0.0f;
 
-        update_sub_brick_tree_node_visibility_ratios(transfer_function, field, node->lower_child);
-        update_sub_brick_tree_node_visibility_ratios(transfer_function, field, node->upper_child);
+        while (node_idx-- > 0)
+        {
+            visibility_ratios[node_idx] = visibility_ratio;
+            brick->tree[node_idx].visibility = UNDETERMINED_REGION_VISIBILITY;
+        }
 
-        node->visibility_ratio = 0.5f*(node->lower_child->visibility_ratio + node->upper_child->visibility_ratio);
+        return;
     }
-    else
+
+    while (node_idx-- > 0)
     {
-        node->visibility_ratio = compute_sub_brick_visibility_ratio(transfer_function, field, node);
+        SubBrickTreeNode* const node = brick->tree + node_idx;
+
+        if (node->upper_child_idx == 0)
+        {
+            visibility_ratios[node_idx] = compute_sub_brick_visibility_ratio(visible_bins, bricked_field, brick, node_idx);
+        }
+        else
+        {
+            // The children need not be equally large, so their ratios are weighted by their share of the node along the split axis
+            const SubBrickTreeNode* const upper_child = brick->tree + node->upper_child_idx;
+            const float upper_fraction = (float)upper_child->size[node->split_axis]/(float)node->size[node->split_axis];
+
+            visibility_ratios[node_idx] = (1.0f - upper_fraction)*visibility_ratios[node_idx + 1] + upper_fraction*visibility_ratios[node->upper_child_idx];
+        }
+
+        node->visibility = UNDETERMINED_REGION_VISIBILITY;
     }
+}
+
+static float compute_sub_brick_visibility_ratio(const uint8_t* visible_bins, const BrickedField* bricked_field, const Brick* brick, size_t node_idx)
+{
+    /*
+    The fraction of visible voxels in a leaf is found from its value histogram,
+    which was built when the field was bricked, so the voxels themselves are
+    never read here.
+    */
+
+    assert(visible_bins);
+    assert(bricked_field);
+    assert(bricked_field->histogram_entries);
+    assert(brick);
+    assert(node_idx < brick->n_tree_nodes);
+
+    const SubBrickTreeNode* const node = brick->tree + node_idx;
+    const ValueHistogramEntry* const entries = bricked_field->histogram_entries;
 
-    node->visibility = UNDETERMINED_REGION_VISIBILITY;
+    // The entries of a node end where those of the next node start
+    const size_t end_idx = brick->histogram_starts[node_idx + 1];
+    size_t n_visible_voxels = 0;
+
+    size_t entry_idx;
+    for (entry_idx = brick->histogram_starts[node_idx]; entry_idx < end_idx; entry_idx++)
+        n_visible_voxels += (size_t)visible_bins[entries[entry_idx].bin]*entries[entry_idx].count;
+
+    return (float)n_visible_voxels/(float)((size_t)node->size[0]*node->size[1]*node->size[2]);
 }
 
-static float compute_sub_brick_visibility_ratio(const TransferFunction* transfer_function, const Field* field, SubBrickTreeNode* node)
+static void find_visible_value_histogram_bins(const TransferFunction* transfer_function, uint8_t* visible_bins)
 {
+    /*
+    A bin is marked as visible if any value in its range is visible, so a
+    region is only ever considered invisible if all its voxels are.
+    */
+
     assert(transfer_function);
-    assert(field);
-    assert(node);
+    assert(visible_bins);
 
-    const size_t offset = (node->offset_z*field->size_y + node->offset_y)*field->size_x + node->offset_x;
+    const float bin_width = 1.0f/(float)VALUE_HISTOGRAM_BINS;
 
-    float field_value;
-    float texture_coordinate;
-    unsigned int node_below;
-    float above_weight;
-    size_t n_visible_voxels = 0;
+    unsigned int bin;
+    for (bin = 0; bin < VALUE_HISTOGRAM_BINS; bin++)
+        visible_bins[bin] = (uint8_t)value_range_is_visible(transfer_function, (float)bin*bin_width, (float)(bin + 1)*bin_width);
+}
 
-    size_t i, j, k;
-    for (k = 0; k < node->size_z; k++)
-        for (j = 0; j < node->size_y; j++)
-            for (i = 0; i < node->size_x; i++)
-    {
-        field_value = field->data[offset + (k*field->size_y + j)*field->size_x + i];
+static int value_range_is_visible(const TransferFunction* transfer_function, float lower_value, float upper_value)
+{
+    // Determines whether any normalized value in the given closed range has an opacity above the invisibility threshold
+    assert(transfer_function);
 
-        if (field_value <= transfer_function->limits.lower_limit)
-        {
-            n_visible_voxels += transfer_function->limits.lower_visibility;
-        }
-        else if (field_value >= transfer_function->limits.upper_limit)
-        {
-            n_visible_voxels += transfer_function->limits.upper_visibility;
-        }
-        else
-        {
-            texture_coordinate = (field_value - transfer_function->limits.lower_limit)*transfer_function->limits.range_norm;
-            node_below = interior_texture_coordinate_to_lower_transfer_function_node(texture_coordinate);
-            above_weight = (texture_coordinate - interior_transfer_function_node_to_texture_coordinate(node_below))*NODE_RANGE_SIZE;
+    const ValueLimits* const limits = &transfer_function->limits;
 
-            n_visible_voxels += ((1.0f - above_weight)*transfer_function->output[node_below][TF_ALPHA] +
-                                         above_weight *transfer_function->output[node_below + 1][TF_ALPHA]) > INVISIBLE_ALPHA;
-        }
+    if ((lower_value <= limits->lower_limit && limits->lower_visibility) ||
+        (upper_value >= limits->upper_limit && limits->upper_visibility))
+        return 1;
+
+    const float start_value = fmaxf(lower_value, limits->lower_limit);
+    const float end_value = fminf(upper_value, limits->upper_limit);
+
+    if (start_value >= end_value)
+        return 0;
+
+    const float start_texture_coordinate = (start_value - limits->lower_limit)*limits->range_norm;
+    const float end_texture_coordinate = (end_value - limits->lower_limit)*limits->range_norm;
+
+    if (compute_interior_alpha(transfer_function, start_texture_coordinate) > INVISIBLE_ALPHA ||
+        compute_interior_alpha(transfer_function, end_texture_coordinate) > INVISIBLE_ALPHA)
+        return 1;
+
+    // The opacity varies linearly between nodes, so in between the ends it can only peak at a node
+    const unsigned int start_node = interior_texture_coordinate_to_lower_transfer_function_node(start_texture_coordinate);
+    const unsigned int end_node = interior_texture_coordinate_to_lower_transfer_function_node(end_texture_coordinate);
+
+    unsigned int node;
+    for (node = start_node + 1; node <= end_node && node < TRANSFER_FUNCTION_SIZE; node++)
+    {
+        if (transfer_function->output[node][TF_ALPHA] > INVISIBLE_ALPHA)
+            return 1;
     }
 
-    return (float)n_visible_voxels/(float)(node->size_x*node->size_y*node->size_z);
+    return 0;
+}
+
+static int value_is_visible(const TransferFunction* transfer_function, float value)
+{
+    // Determines whether the given normalized value has an opacity above the invisibility threshold
+    assert(transfer_function);
+
+    const ValueLimits* const limits = &transfer_function->limits;
+
+    if (value <= limits->lower_limit)
+        return (int)limits->lower_visibility;
+
+    if (value >= limits->upper_limit)
+        return (int)limits->upper_visibility;
+
+    return compute_interior_alpha(transfer_function, (value - limits->lower_limit)*limits->range_norm) > INVISIBLE_ALPHA;
+}
+
+static float compute_interior_alpha(const TransferFunction* transfer_function, float texture_coordinate)
+{
+    // Interpolates the opacity between the interior nodes surrounding the given texture coordinate
+    assert(transfer_function);
+
+    const unsigned int node_below = interior_texture_coordinate_to_lower_transfer_function_node(texture_coordinate);
+    const float above_weight = (texture_coordinate - interior_transfer_function_node_to_texture_coordinate(node_below))*NODE_RANGE_SIZE;
+
+    return (1.0f - above_weight)*transfer_function->output[node_below][TF_ALPHA] +
+                   above_weight *transfer_function->output[node_below + 1][TF_ALPHA];
 }
 
 static void transfer_transfer_function_texture(TransferFunctionTexture* transfer_function_texture)
@@ -277,6 +277,31 @@ float get_component_of_vector_from_model_point_to_camera(const Vector3f* point,
         camera.position.a[component] - point->a[component]*get_model_scale(component) : camera.look_axis.a[component];
 }
 
+float get_projected_length_in_pixels(const Vector3f* model_point, float length)
+{
+    /*
+    Returns the approximate number of pixels covered on screen by a line
+    segment of the given length in world space, located at the given point in
+    model space and oriented perpendicular to the look axis.
+    */
+
+    assert(model_point);
+
+    const Vector4f homogeneous_point = create_vector4f(model_point->a[0], model_point->a[1], model_point->a[2], 1.0f);
+    const Vector4f clip_point = multiply_matrix4f_vector4f(&transformation.MVP_matrix, &homogeneous_point);
+
+    // The clip space w-coordinate is the depth for perspective projection and unity for orthographic projection.
+    // Points closer than the near plane are treated as lying on it.
+    const float w = fmaxf(clip_point.a[3], (transformation.projection.type == PERSPECTIVE_PROJECTION) ?
+                                           transformation.projection.near_plane_distance : 1.0f);
+
+    int width, height;
+    get_window_shape_in_pixels(&width, &height);
+
+    // The vertical scale of the projection matrix maps view space lengths to normalized device coordinates in [-1, 1]
+    return 0.5f*(float)height*transformation.projection.matrix.a[5]*length/w;
+}
+
 void enable_camera_control(void)
 {
     camera_controller.state = CONTROL;
@@ -79,6 +79,7 @@ typedef struct Configuration
     float plane_separation_multiplier;
     float lower_visibility_threshold;
     float upper_visibility_threshold;
+    float lod_pixel_threshold;
     int draw_field_outline;
     int draw_brick_outline;
     int draw_sub_brick_outline;
@@ -95,10 +96,12 @@ static void update_vertex_array_object(void);
 
 static void generate_shader_code_for_planes(void);
 
-static void draw_brick_tree_nodes(BrickTreeNode* node);
+static void draw_brick_tree_nodes(const BrickedField* bricked_field, uint32_t node_idx);
+static int lod_brick_is_sufficient(const BrickedField* bricked_field, const BrickTreeNode* node, const LODBrick* lod_brick);
+static void draw_lod_brick(const BrickTreeNode* node, const LODBrick* lod_brick);
 static void draw_brick(const Brick* brick);
-static void draw_sub_brick_tree_nodes(SubBrickTreeNode* node);
-static void draw_sub_brick(const SubBrickTreeNode* node);
+static void draw_sub_brick_tree_nodes(const Brick* brick, uint32_t node_idx);
+static void draw_sub_brick(const Vector3f* spatial_offset, const Vector3f* spatial_extent);
 static void draw_plane_faces(unsigned int n_planes);
 
 static void sync_plane_separation(void);
@@ -170,7 +173,8 @@ static const GLuint orientation_permutations[9] = {0, 1, 2,  // Cycle 0
 
 static Uniform brick_offset_uniform;
 static Uniform brick_extent_uniform;
-static Uniform pad_fractions_uniform;
+static Uniform texture_offset_uniform;
+static Uniform texture_extent_uniform;
 static Uniform subbrick_offset_uniform;
 static Uniform subbrick_extent_uniform;
 
@@ -181,6 +185,8 @@ static Uniform orientation_uniform;
 
 static Uniform sampling_correction_uniform;
 
+static Uniform brick_constant_value_uniform;
+
 static size_t position_variable_number;
 static size_t tex_coord_variable_number;
 
@@ -202,6 +208,7 @@ void initialize_planes(void)
 
     configuration.lower_visibility_threshold = 0.0f;
     configuration.upper_visibility_threshold = 0.9f;
+    configuration.lod_pixel_threshold = 1.0f;
     configuration.draw_field_outline = 1;
     configuration.draw_brick_outline = 0;
     configuration.draw_sub_brick_outline = 0;
@@ -219,7 +226,8 @@ void initialize_planes(void)
 
     initialize_uniform(&brick_offset_uniform, "brick_offset");
     initialize_uniform(&brick_extent_uniform, "brick_extent");
-    initialize_uniform(&pad_fractions_uniform, "pad_fractions");
+    initialize_uniform(&texture_offset_uniform, "brick_texture_offset");
+    initialize_uniform(&texture_extent_uniform, "brick_texture_extent");
     initialize_uniform(&subbrick_offset_uniform, "sub_brick_offset");
     initialize_uniform(&subbrick_extent_uniform, "sub_brick_extent");
 
@@ -230,6 +238,8 @@ void initialize_planes(void)
 
     initialize_uniform(&sampling_correction_uniform, "sampling_correction");
 
+    initialize_uniform(&brick_constant_value_uniform, "brick_constant_value");
+
     generate_shader_code_for_planes();
 }
 
@@ -247,7 +257,8 @@ void load_planes(void)
 
     load_uniform(active_shader_program, &brick_offset_uniform);
     load_uniform(active_shader_program, &brick_extent_uniform);
-    load_uniform(active_shader_program, &pad_fractions_uniform);
+    load_uniform(active_shader_program, &texture_offset_uniform);
+    load_uniform(active_shader_program, &texture_extent_uniform);
     load_uniform(active_shader_program, &subbrick_offset_uniform);
     load_uniform(active_shader_program, &subbrick_extent_uniform);
 
@@ -258,6 +269,8 @@ void load_planes(void)
 
     load_uniform(active_shader_program, &sampling_correction_uniform);
 
+    load_uniform(active_shader_program, &brick_constant_value_uniform);
+
     glUseProgram(active_shader_program->id);
     abort_on_GL_error("Could not use shader program for setting view aligned planes uniforms");
 
@@ -296,6 +309,12 @@ void set_upper_visibility_threshold(float threshold)
     configuration.upper_visibility_threshold = threshold;
 }
 
+void set_lod_pixel_threshold(float threshold)
+{
+    check(threshold >= 0.0f);
+    configuration.lod_pixel_threshold = threshold;
+}
+
 void toggle_field_outline_drawing(void)
 {
     configuration.draw_field_outline = !configuration.draw_field_outline;
@@ -388,8 +407,6 @@ void draw_active_bricked_field(void)
     if (configuration.draw_field_outline)
         draw_field_boundary_indicator(bricked_field, active_bricked_field.current_back_corner_idx, INDICATOR_BACK_PASS);
 
-    BrickTreeNode* node = bricked_field->tree;
-
     glUseProgram(active_shader_program->id);
     abort_on_GL_error("Could not use shader program for drawing bricked field");
 
@@ -401,7 +418,7 @@ void draw_active_bricked_field(void)
     glActiveTexture(GL_TEXTURE0);
     abort_on_GL_error("Could not set active texture unit for drawing bricked field");
 
-    draw_brick_tree_nodes(node);
+    draw_brick_tree_nodes(bricked_field, 0);
 
     glBindVertexArray(0);
 
@@ -490,7 +507,8 @@ void cleanup_planes(void)
 
     destroy_uniform(&brick_offset_uniform);
     destroy_uniform(&brick_extent_uniform);
-    destroy_uniform(&pad_fractions_uniform);
+    destroy_uniform(&texture_offset_uniform);
+    destroy_uniform(&texture_extent_uniform);
     destroy_uniform(&subbrick_offset_uniform);
     destroy_uniform(&subbrick_extent_uniform);
 
@@ -501,6 +519,8 @@ void cleanup_planes(void)
 
     destroy_uniform(&sampling_correction_uniform);
 
+    destroy_uniform(&brick_constant_value_uniform);
+
     active_bricked_field.bricked_field = NULL;
     active_shader_program = NULL;
 }
@@ -651,7 +671,8 @@ static void generate_shader_code_for_planes(void)
 
     const char* brick_offset_name = brick_offset_uniform.name.chars;
     const char* brick_extent_name = brick_extent_uniform.name.chars;
-    const char* pad_fractions_name = pad_fractions_uniform.name.chars;
+    const char* texture_offset_name = texture_offset_uniform.name.chars;
+    const char* texture_extent_name = texture_extent_uniform.name.chars;
     const char* sub_brick_offset_name = subbrick_offset_uniform.name.chars;
     const char* sub_brick_extent_name = subbrick_extent_uniform.name.chars;
 
@@ -662,6 +683,8 @@ static void generate_shader_code_for_planes(void)
 
     const char* sampling_correction_name = sampling_correction_uniform.name.chars;
 
+    const char* brick_constant_value_name = brick_constant_value_uniform.name.chars;
+
     const char* look_axis_name = get_camera_look_axis_name();
 
     add_vertex_input_in_shader(&active_shader_program->vertex_shader_source, "uint", vertex_idx_name, 0);
@@ -677,7 +700,8 @@ static void generate_shader_code_for_planes(void)
 
     add_uniform_in_shader(&active_shader_program->vertex_shader_source, "vec3", brick_offset_name);
     add_uniform_in_shader(&active_shader_program->vertex_shader_source, "vec3", brick_extent_name);
-    add_uniform_in_shader(&active_shader_program->vertex_shader_source, "vec3", pad_fractions_name);
+    add_uniform_in_shader(&active_shader_program->vertex_shader_source, "vec3", texture_offset_name);
+    add_uniform_in_shader(&active_shader_program->vertex_shader_source, "vec3", texture_extent_name);
     add_uniform_in_shader(&active_shader_program->vertex_shader_source, "vec3", sub_brick_offset_name);
     add_uniform_in_shader(&active_shader_program->vertex_shader_source, "vec3", sub_brick_extent_name);
 
@@ -756,21 +780,20 @@ static void generate_shader_code_for_planes(void)
     DynamicString tex_coord_code = create_string(
     "\n    vec3 tex_coord;"
     "\n    vec3 position_within_brick = (variable_%d.xyz - %s)/%s;"
-    "\n    vec3 scale = vec3(1.0) - 2.0*%s;"
     "\n    for (uint component = 0; component < 3; component++)"
     "\n    {"
     "\n        uint permuted_component = %s[3*%s + component];"
-    "\n        tex_coord[component] = scale[permuted_component]*position_within_brick[permuted_component] + %s[permuted_component];"
+    "\n        tex_coord[component] = %s[permuted_component]*position_within_brick[permuted_component] + %s[permuted_component];"
     "\n    }",
     position_variable_number, brick_offset_name, brick_extent_name,
-    pad_fractions_name,
     orientation_permutations_name, orientation_name,
-    pad_fractions_name);
+    texture_extent_name, texture_offset_name);
 
     global_dependencies = create_list();
     append_string_to_list(&global_dependencies, brick_offset_name);
     append_string_to_list(&global_dependencies, brick_extent_name);
-    append_string_to_list(&global_dependencies, pad_fractions_name);
+    append_string_to_list(&global_dependencies, texture_offset_name);
+    append_string_to_list(&global_dependencies, texture_extent_name);
     append_string_to_list(&global_dependencies, orientation_permutations_name);
     append_string_to_list(&global_dependencies, orientation_name);
 
@@ -790,32 +813,49 @@ static void generate_shader_code_for_planes(void)
     add_input_in_shader(&active_shader_program->fragment_shader_source, "vec3", "out_tex_coord");
 
     add_uniform_in_shader(&active_shader_program->fragment_shader_source, "float", sampling_correction_name);
+
+    add_uniform_in_shader(&active_shader_program->fragment_shader_source, "float", brick_constant_value_name);
 }
 
-static void draw_brick_tree_nodes(BrickTreeNode* node)
+static void draw_brick_tree_nodes(const BrickedField* bricked_field, uint32_t node_idx)
 {
-    assert(node);
+    assert(bricked_field);
+
+    BrickTreeNode* const node = bricked_field->tree + node_idx;
 
     // If the brick is invisible, stop traversal of this branch
-    if (node->visibility_ratio <= configuration.lower_visibility_threshold)
+    if (bricked_field->tree_visibility_ratios[node_idx] <= configuration.lower_visibility_threshold)
     {
         node->visibility = REGION_INVISIBLE;
         return;
     }
 
-    if (node->brick)
+    const uint32_t lod_brick_idx = bricked_field->tree_lod_brick_indices[node_idx];
+    const LODBrick* const lod_brick = (lod_brick_idx != NO_LOD_BRICK) ? bricked_field->lod_bricks + lod_brick_idx : NULL;
+
+    if (lod_brick && lod_brick_is_sufficient(bricked_field, node, lod_brick))
     {
-        draw_brick(node->brick);
+        // The downsampled node is drawn instead of the bricks below it
+        draw_lod_brick(node, lod_brick);
+        node->visibility = REGION_VISIBLE;
+    }
+    else if (node->upper_child_idx == 0)
+    {
+        draw_brick(bricked_field->bricks + node->brick_idx);
         node->visibility = REGION_VISIBLE;
     }
     else
     {
-        assert(node->lower_child);
-        assert(node->upper_child);
+        // The lower child is stored directly after its parent
+        const uint32_t lower_child_idx = node_idx + 1;
+        const uint32_t upper_child_idx = node->upper_child_idx;
+
+        BrickTreeNode* const lower_child = bricked_field->tree + lower_child_idx;
+        BrickTreeNode* const upper_child = bricked_field->tree + upper_child_idx;
 
         // Bricks that are completely clipped away do not have to be drawn
-        const int lower_is_clipped = axis_aligned_box_in_clipped_region(&node->lower_child->spatial_offset, &node->lower_child->spatial_extent);
-        const int upper_is_clipped = axis_aligned_box_in_clipped_region(&node->upper_child->spatial_offset, &node->upper_child->spatial_extent);
+        const int lower_is_clipped = axis_aligned_box_in_clipped_region(&lower_child->spatial_offset, &lower_child->spatial_extent);
+        const int upper_is_clipped = axis_aligned_box_in_clipped_region(&upper_child->spatial_offset, &upper_child->spatial_extent);
 
         // In order to determine whether the upper or lower child should be drawn first,
         // we can compute the vector going from the a point on the plane separating the
@@ -825,35 +865,108 @@ static void draw_brick_tree_nodes(BrickTreeNode* node)
         // this amounts to comparing the corresponding component of the camera position
         // and (e.g.) the upper child offset.
 
-        if (get_component_of_vector_from_model_point_to_camera(&node->upper_child->spatial_offset, node->split_axis) >= 0)
+        if (get_component_of_vector_from_model_point_to_camera(&upper_child->spatial_offset, node->split_axis) >= 0)
         {
             if (!lower_is_clipped)
-                draw_brick_tree_nodes(node->lower_child);
+                draw_brick_tree_nodes(bricked_field, lower_child_idx);
             else
-                node->lower_child->visibility = REGION_CLIPPED;
+                lower_child->visibility = REGION_CLIPPED;
 
             if (!upper_is_clipped)
-                draw_brick_tree_nodes(node->upper_child);
+                draw_brick_tree_nodes(bricked_field, upper_child_idx);
             else
-                node->upper_child->visibility = REGION_CLIPPED;
+                upper_child->visibility = REGION_CLIPPED;
         }
         else
         {
             if (!upper_is_clipped)
-                draw_brick_tree_nodes(node->upper_child);
+                draw_brick_tree_nodes(bricked_field, upper_child_idx);
             else
-                node->upper_child->visibility = REGION_CLIPPED;
+                upper_child->visibility = REGION_CLIPPED;
 
             if (!lower_is_clipped)
-                draw_brick_tree_nodes(node->lower_child);
+                draw_brick_tree_nodes(bricked_field, lower_child_idx);
             else
-                node->lower_child->visibility = REGION_CLIPPED;
+                lower_child->visibility = REGION_CLIPPED;
         }
 
         node->visibility = UNDETERMINED_REGION_VISIBILITY;
     }
 }
 
+static int lod_brick_is_sufficient(const BrickedField* bricked_field, const BrickTreeNode* node, const LODBrick* lod_brick)
+{
+    /*
+    The LOD brick of a node is sufficient if its voxels project to no more
+    than the LOD pixel threshold at the point of the node closest to the
+    camera, since the full resolution bricks would then be undersampled.
+    */
+
+    assert(bricked_field);
+    assert(node);
+    assert(lod_brick);
+    assert(active_bricked_field.current_camera_position);
+
+    const Field* const field = bricked_field->field;
+
+    Vector3f closest_point;
+    float model_scale;
+    float max_voxel_extent = 0;
+    unsigned int dim;
+
+    for (dim = 0; dim < 3; dim++)
+    {
+        model_scale = get_model_scale(dim);
+
+        closest_point.a[dim] = fminf(fmaxf(active_bricked_field.current_camera_position->a[dim]/model_scale, node->spatial_offset.a[dim]),
+                                     node->spatial_offset.a[dim] + node->spatial_extent.a[dim]);
+
+        max_voxel_extent = fmaxf(max_voxel_extent, ((dim == 0) ? field->voxel_width : (dim == 1) ? field->voxel_height : field->voxel_depth)*model_scale);
+    }
+
+    // Each level doubles the voxel extent
+    const size_t lod_factor = pow2_size_t(lod_brick->level);
+    const float lod_voxel_extent = (float)lod_factor*max_voxel_extent;
+
+    return get_projected_length_in_pixels(&closest_point, lod_voxel_extent) <= configuration.lod_pixel_threshold;
+}
+
+static void draw_lod_brick(const BrickTreeNode* node, const LODBrick* lod_brick)
+{
+    assert(node);
+    assert(lod_brick);
+
+    // The data of LOD bricks has x varying fastest
+    glUniform1ui(orientation_uniform.location, (GLuint)ORIENTED_ZYX);
+
+    glUniform3f(brick_offset_uniform.location,
+                node->spatial_offset.a[0],
+                node->spatial_offset.a[1],
+                node->spatial_offset.a[2]);
+
+    glUniform3f(brick_extent_uniform.location,
+                node->spatial_extent.a[0],
+                node->spatial_extent.a[1],
+                node->spatial_extent.a[2]);
+
+    glUniform3f(texture_offset_uniform.location,
+                lod_brick->texture_offset.a[0],
+                lod_brick->texture_offset.a[1],
+                lod_brick->texture_offset.a[2]);
+
+    glUniform3f(texture_extent_uniform.location,
+                lod_brick->texture_extent.a[0],
+                lod_brick->texture_extent.a[1],
+                lod_brick->texture_extent.a[2]);
+
+    glUniform1f(brick_constant_value_uniform.location, -1.0f);
+
+    glBindTexture(GL_TEXTURE_3D, lod_brick->texture_id);
+    abort_on_GL_error("Could not bind 3D texture for drawing LOD brick");
+
+    draw_sub_brick(&node->spatial_offset, &node->spatial_extent);
+}
+
 static void draw_brick(const Brick* brick)
 {
     assert(brick);
@@ -873,23 +986,34 @@ static void draw_brick(const Brick* brick)
                 brick->spatial_extent.a[1],
                 brick->spatial_extent.a[2]);
 
-    // Update brick pad fractions
-    glUniform3f(pad_fractions_uniform.location,
+    // The region of the texture inside the padding is drawn
+    glUniform3f(texture_offset_uniform.location,
                 brick->pad_fractions.a[0],
                 brick->pad_fractions.a[1],
                 brick->pad_fractions.a[2]);
 
+    glUniform3f(texture_extent_uniform.location,
+                1.0f - 2.0f*brick->pad_fractions.a[0],
+                1.0f - 2.0f*brick->pad_fractions.a[1],
+                1.0f - 2.0f*brick->pad_fractions.a[2]);
+
+    // A non-negative value tells the shader that the brick is constant and has no texture to sample
+    glUniform1f(brick_constant_value_uniform.location, brick->is_constant ? brick->constant_value : -1.0f);
+
     glBindTexture(GL_TEXTURE_3D, brick->texture_id);
     abort_on_GL_error("Could not bind 3D texture for drawing brick");
 
-    draw_sub_brick_tree_nodes(brick->tree);
+    draw_sub_brick_tree_nodes(brick, 0);
 }
 
-static void draw_sub_brick_tree_nodes(SubBrickTreeNode* node)
+static void draw_sub_brick_tree_nodes(const Brick* brick, uint32_t node_idx)
 {
-    assert(node);
+    assert(brick);
 
-    if (node->visibility_ratio <= configuration.lower_visibility_threshold)
+    SubBrickTreeNode* const node = brick->tree + node_idx;
+    const float visibility_ratio = brick->visibility_ratios[node_idx];
+
+    if (visibility_ratio <= configuration.lower_visibility_threshold)
     {
         // If the sub brick is invisible, stop traversal of this branch
         node->visibility = REGION_INVISIBLE;
@@ -897,38 +1021,47 @@ static void draw_sub_brick_tree_nodes(SubBrickTreeNode* node)
     }
 
     // If the sub brick is not sufficiently visible and it has children, traverse these recursively
-    if (node->visibility_ratio < configuration.upper_visibility_threshold && node->lower_child)
+    if (visibility_ratio < configuration.upper_visibility_threshold && node->upper_child_idx != 0)
     {
-        assert(node->upper_child);
+        const uint32_t lower_child_idx = node_idx + 1;
+        const uint32_t upper_child_idx = node->upper_child_idx;
+
+        SubBrickTreeNode* const lower_child = brick->tree + lower_child_idx;
+        SubBrickTreeNode* const upper_child = brick->tree + upper_child_idx;
+
+        Vector3f lower_offset, lower_extent;
+        Vector3f upper_offset, upper_extent;
+        get_sub_brick_tree_node_box(active_bricked_field.bricked_field, brick, lower_child, &lower_offset, &lower_extent);
+        get_sub_brick_tree_node_box(active_bricked_field.bricked_field, brick, upper_child, &upper_offset, &upper_extent);
 
         // Sub bricks that are completely clipped away do not have to be drawn
-        const int lower_is_clipped = axis_aligned_box_in_clipped_region(&node->lower_child->spatial_offset, &node->lower_child->spatial_extent);
-        const int upper_is_clipped = axis_aligned_box_in_clipped_region(&node->upper_child->spatial_offset, &node->upper_child->spatial_extent);
+        const int lower_is_clipped = axis_aligned_box_in_clipped_region(&lower_offset, &lower_extent);
+        const int upper_is_clipped = axis_aligned_box_in_clipped_region(&upper_offset, &upper_extent);
 
         // Make sure to draw the children in the correct order (back to front)
-        if (get_component_of_vector_from_model_point_to_camera(&node->upper_child->spatial_offset, node->split_axis) >= 0)
+        if (get_component_of_vector_from_model_point_to_camera(&upper_offset, node->split_axis) >= 0)
         {
             if (!lower_is_clipped)
-                draw_sub_brick_tree_nodes(node->lower_child);
+                draw_sub_brick_tree_nodes(brick, lower_child_idx);
             else
-                node->lower_child->visibility = REGION_CLIPPED;
+                lower_child->visibility = REGION_CLIPPED;
 
             if (!upper_is_clipped)
-                draw_sub_brick_tree_nodes(node->upper_child);
+                draw_sub_brick_tree_nodes(brick, upper_child_idx);
             else
-                node->upper_child->visibility = REGION_CLIPPED;
+                upper_child->visibility = REGION_CLIPPED;
         }
         else
         {
             if (!upper_is_clipped)
-                draw_sub_brick_tree_nodes(node->upper_child);
+                draw_sub_brick_tree_nodes(brick, upper_child_idx);
             else
-                node->upper_child->visibility = REGION_CLIPPED;
+                upper_child->visibility = REGION_CLIPPED;
 
             if (!lower_is_clipped)
-                draw_sub_brick_tree_nodes(node->lower_child);
+                draw_sub_brick_tree_nodes(brick, lower_child_idx);
             else
-                node->lower_child->visibility = REGION_CLIPPED;
+                lower_child->visibility = REGION_CLIPPED;
         }
 
         node->visibility = UNDETERMINED_REGION_VISIBILITY;
@@ -936,27 +1069,31 @@ static void draw_sub_brick_tree_nodes(SubBrickTreeNode* node)
     else
     {
         // If the sub brick is sufficiently visible or is a leaf node, draw it
-        draw_sub_brick(node);
+        Vector3f spatial_offset, spatial_extent;
+        get_sub_brick_tree_node_box(active_bricked_field.bricked_field, brick, node, &spatial_offset, &spatial_extent);
+
+        draw_sub_brick(&spatial_offset, &spatial_extent);
         node->visibility = REGION_VISIBLE;
     }
 }
 
-static void draw_sub_brick(const SubBrickTreeNode* node)
+static void draw_sub_brick(const Vector3f* spatial_offset, const Vector3f* spatial_extent)
 {
-    assert(node);
+    assert(spatial_offset);
+    assert(spatial_extent);
     assert(active_bricked_field.current_look_axis);
 
     // Update offset to first sub brick corner
     glUniform3f(subbrick_offset_uniform.location,
-                node->spatial_offset.a[0],
-                node->spatial_offset.a[1],
-                node->spatial_offset.a[2]);
+                spatial_offset->a[0],
+                spatial_offset->a[1],
+                spatial_offset->a[2]);
 
     // Update sub brick extent
     glUniform3f(subbrick_extent_uniform.location,
-                node->spatial_extent.a[0],
-                node->spatial_extent.a[1],
-                node->spatial_extent.a[2]);
+                spatial_extent->a[0],
+                spatial_extent->a[1],
+                spatial_extent->a[2]);
 
     /*
     Project sub brick corners onto the look axis and find the one
@@ -974,25 +1111,34 @@ static void draw_sub_brick(const SubBrickTreeNode* node)
     Back corner
     */
 
-    const float plane_dist_offset = dot3f(&node->spatial_offset, active_bricked_field.current_look_axis);
+    const float plane_dist_offset = dot3f(spatial_offset, active_bricked_field.current_look_axis);
 
-    const Vector3f scaled_back_corner = multiplied_vector3f(corners + active_bricked_field.current_back_corner_idx, &node->spatial_extent);
+    const Vector3f scaled_back_corner = multiplied_vector3f(corners + active_bricked_field.current_back_corner_idx, spatial_extent);
     float back_plane_dist = dot3f(&scaled_back_corner, active_bricked_field.current_look_axis) + plane_dist_offset;
 
-    const Vector3f scaled_front_corner = multiplied_vector3f(corners + active_bricked_field.current_front_corner_idx, &node->spatial_extent);
+    const Vector3f scaled_front_corner = multiplied_vector3f(corners + active_bricked_field.current_front_corner_idx, spatial_extent);
     float front_plane_dist = dot3f(&scaled_front_corner, active_bricked_field.current_look_axis) + plane_dist_offset;
 
     // Offset start distance by half a plane spacing so that the first plane gets a non-zero area
     back_plane_dist += 0.5f*plane_separation.value;
 
-    glUniform1f(back_plane_dist_uniform.location, (GLfloat)back_plane_dist);
+    // Determine number of planes needed to traverse the region from back to front along the view axis
+    unsigned int n_remaining_planes = (unsigned int)((front_plane_dist - back_plane_dist)/plane_separation.value) + 1;
+    unsigned int n_planes;
+
+    // Regions larger than a brick, like those of LOD bricks, may need more planes than the stack holds, and are
+    // then drawn in several batches
+    do
+    {
+        n_planes = uimin(n_remaining_planes, plane_stack.n_planes);
 
-    // Determine number of planes needed to traverse the brick from back to front along the view axis.
-    // Also make sure it doesn't exceed the total number of available planes due to round-off errors.
-    const unsigned int n_required_planes = uimin((unsigned int)((front_plane_dist - back_plane_dist)/plane_separation.value) + 1,
-                                                 plane_stack.n_planes);
+        glUniform1f(back_plane_dist_uniform.location, (GLfloat)back_plane_dist);
+        draw_plane_faces(n_planes);
 
-    draw_plane_faces(n_required_planes);
+        back_plane_dist += (float)n_planes*plane_separation.value;
+        n_remaining_planes -= n_planes;
+    }
+    while (n_remaining_planes > 0);
 }
 
 static void draw_plane_faces(unsigned int n_planes)
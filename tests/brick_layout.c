@@ -0,0 +1,257 @@
+/*
+ * Checks that the data of every brick holds the normalized values of the padded
+ * region of the field it covers, laid out according to the orientation of the
+ * brick. The bricks of a 13x11x9 field are small and irregular, so that the
+ * values of bricks of all three orientations are transposed both in whole
+ * register blocks and in leftover rows and columns of various lengths.
+ */
+
+#include "fields.h"
+#include "bricks.h"
+#include "io.h"
+#include "dynamic_string.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+
+#define FIELD_SIZE_X 13
+#define FIELD_SIZE_Y 11
+#define FIELD_SIZE_Z 9
+
+
+typedef struct BrickingSetup
+{
+    unsigned int brick_size_exponent;
+    unsigned int kernel_size;
+} BrickingSetup;
+
+
+static float* create_field_values(void);
+static int write_bifrost_files(const char* data_filename, const char* header_filename, const float* values);
+static int check_brick_layouts(const BrickedField* bricked_field, const float* values, unsigned int orientation_counts[3]);
+static float* create_cycled_layout_copy(const BrickedField* bricked_field, const Brick* brick, const float* values,
+                                        size_t padded_size[3]);
+
+
+int main(void)
+{
+    // Padded brick sizes range from 1 to 8 voxels along each axis for these setups
+    static const BrickingSetup setups[] = {{3, 1}, {3, 2}};
+
+    const size_t n_setups = sizeof(setups)/sizeof(setups[0]);
+
+    char directory_name[] = "/tmp/vortek_test_XXXXXX";
+
+    if (!mkdtemp(directory_name))
+    {
+        fprintf(stderr, "Could not create temporary directory.\n");
+        return EXIT_FAILURE;
+    }
+
+    DynamicString data_filename = create_string("%s/field.raw", directory_name);
+    DynamicString header_filename = create_string("%s/field.dat", directory_name);
+
+    float* const values = create_field_values();
+
+    int passed = write_bifrost_files(data_filename.chars, header_filename.chars, values);
+
+    if (!passed)
+        fprintf(stderr, "Could not write test files.\n");
+
+    if (passed)
+    {
+        initialize_fields();
+        initialize_bricks();
+
+        Field* const field = get_field(create_field_from_bifrost_file("field", data_filename.chars, header_filename.chars));
+
+        unsigned int orientation_counts[3] = {0, 0, 0};
+        size_t setup_idx;
+
+        for (setup_idx = 0; setup_idx < n_setups; setup_idx++)
+        {
+            set_brick_size_exponent(setups[setup_idx].brick_size_exponent);
+            set_bricked_field_kernel_size(setups[setup_idx].kernel_size);
+
+            const BrickingConfiguration bricking_configuration = get_bricking_configuration();
+
+            BrickedField bricked_field;
+            reset_bricked_field(&bricked_field);
+            build_bricked_field(&bricked_field, field, &bricking_configuration);
+
+            if (!check_brick_layouts(&bricked_field, values, orientation_counts))
+            {
+                fprintf(stderr, "Bricks have the wrong data with brick size exponent %u and kernel size %u.\n",
+                        setups[setup_idx].brick_size_exponent, setups[setup_idx].kernel_size);
+                passed = 0;
+            }
+
+            destroy_bricked_field(&bricked_field);
+        }
+
+        if (orientation_counts[0] == 0 || orientation_counts[1] == 0 || orientation_counts[2] == 0)
+        {
+            fprintf(stderr, "Not all brick orientations were checked.\n");
+            passed = 0;
+        }
+
+        cleanup_fields();
+    }
+
+    unlink(header_filename.chars);
+    unlink(data_filename.chars);
+    rmdir(directory_name);
+
+    clear_string(&header_filename);
+    clear_string(&data_filename);
+    free(values);
+
+    printf("brick_layout: %s\n", passed ? "passed" : "FAILED");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static float* create_field_values(void)
+{
+    // Every voxel gets a distinct value, so that any misplaced value is detected
+    float* const values = (float*)malloc(sizeof(float)*FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z);
+
+    if (!values)
+    {
+        fprintf(stderr, "Could not allocate memory for field values.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t idx;
+
+    for (idx = 0; idx < FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z; idx++)
+        values[idx] = (float)idx + 0.25f*sinf((float)idx);
+
+    return values;
+}
+
+static int write_bifrost_files(const char* data_filename, const char* header_filename, const float* values)
+{
+    DynamicString header = create_string("element_kind: f\n"
+                                         "element_size: %zu\n"
+                                         "endianness: l\n"
+                                         "dimensions: 3\n"
+                                         "order: C\n"
+                                         "x_size: %d\n"
+                                         "y_size: %d\n"
+                                         "z_size: %d\n"
+                                         "dx: 1.0\n"
+                                         "dy: 1.0\n"
+                                         "dz: 1.0\n",
+                                         sizeof(float), FIELD_SIZE_X, FIELD_SIZE_Y, FIELD_SIZE_Z);
+
+    const int succeeded = write_binary_file(header_filename, NULL, 0, header.chars, strlen(header.chars)) &&
+                          write_binary_file(data_filename, NULL, 0, values, sizeof(float)*FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z);
+
+    clear_string(&header);
+
+    return succeeded;
+}
+
+static int check_brick_layouts(const BrickedField* bricked_field, const float* values, unsigned int orientation_counts[3])
+{
+    if (bricked_field->data_type != BRICK_DATA_FLOAT32)
+    {
+        fprintf(stderr, "Bricks should hold single precision values.\n");
+        return 0;
+    }
+
+    size_t brick_idx;
+    size_t padded_size[3];
+    size_t idx;
+    int passed = 1;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+    {
+        const Brick* const brick = bricked_field->bricks + brick_idx;
+
+        if (!brick->data)
+        {
+            fprintf(stderr, "Brick %zu has no data.\n", brick_idx);
+            passed = 0;
+            continue;
+        }
+
+        float* const expected_values = create_cycled_layout_copy(bricked_field, brick, values, padded_size);
+
+        size_t n_mismatching_values = 0;
+
+        for (idx = 0; idx < padded_size[0]*padded_size[1]*padded_size[2]; idx++)
+            n_mismatching_values += ((const float*)brick->data)[idx] != expected_values[idx];
+
+        free(expected_values);
+
+        if (n_mismatching_values > 0)
+        {
+            fprintf(stderr, "%zu values of brick %zu with orientation %d and padded size (%zu, %zu, %zu) are wrong.\n",
+                    n_mismatching_values, brick_idx, (int)brick->orientation, padded_size[0], padded_size[1], padded_size[2]);
+            passed = 0;
+        }
+
+        orientation_counts[brick->orientation]++;
+    }
+
+    return passed;
+}
+
+static float* create_cycled_layout_copy(const BrickedField* bricked_field, const Brick* brick, const float* values,
+                                        size_t padded_size[3])
+{
+    /*
+    Copies the normalized values of the padded region covered by the given
+    brick one by one into a newly allocated array. The x, y and z-axis vary
+    from fastest to slowest for orientation 0, y, z and x for orientation 1
+    and z, x and y for orientation 2. The padded size along the x, y and
+    z-axis is returned in the given array.
+    */
+
+    const Field* const field = bricked_field->field;
+    const size_t pad_size = bricked_field->pad_size;
+    const unsigned int orientation = (unsigned int)brick->orientation;
+
+    // The padded sizes of the brick are listed from fastest to slowest varying, so they are reordered here
+    padded_size[0] = brick->padded_size[(3 - orientation) % 3];
+    padded_size[1] = brick->padded_size[(4 - orientation) % 3];
+    padded_size[2] = brick->padded_size[(5 - orientation) % 3];
+
+    float* const copy = (float*)malloc(sizeof(float)*padded_size[0]*padded_size[1]*padded_size[2]);
+
+    if (!copy)
+    {
+        fprintf(stderr, "Could not allocate memory for brick values.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t i, j, k;
+    size_t coordinates[3];
+    size_t copy_idx;
+
+    for (k = 0; k < padded_size[2]; k++)
+        for (j = 0; j < padded_size[1]; j++)
+            for (i = 0; i < padded_size[0]; i++)
+            {
+                coordinates[0] = i;
+                coordinates[1] = j;
+                coordinates[2] = k;
+
+                // Position of the voxel among the axes of the brick ordered from fastest to slowest varying
+                copy_idx = (coordinates[(2 + orientation) % 3]*padded_size[(1 + orientation) % 3] +
+                            coordinates[(1 + orientation) % 3])*padded_size[orientation] + coordinates[orientation];
+
+                const size_t field_idx = ((brick->offset_z - pad_size + k)*field->size_y + brick->offset_y - pad_size + j)*field->size_x +
+                                         brick->offset_x - pad_size + i;
+
+                copy[copy_idx] = (values[field_idx] - field->normalization_offset)*field->normalization_scale;
+            }
+
+    return copy;
+}
@@ -0,0 +1,179 @@
+/*
+ * Checks that a field loaded from a compressed Bifrost file can be bricked
+ * again after its data has been released. A compressed file cannot be streamed
+ * slab by slab, so the field must instead be bricked anew from its existing
+ * bricks, and the new bricks must hold the original values.
+ */
+
+#include "fields.h"
+#include "bricks.h"
+#include "io.h"
+#include "dynamic_string.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+
+#define FIELD_SIZE_X 40
+#define FIELD_SIZE_Y 36
+#define FIELD_SIZE_Z 30
+#define FIRST_BRICK_SIZE_EXPONENT 4
+#define SECOND_BRICK_SIZE_EXPONENT 5
+// Largest allowed difference between an original and a rebricked value, relative to the value range
+#define RELATIVE_TOLERANCE 1e-5f
+
+
+static float* create_field_values(void);
+static int write_bifrost_files(const char* data_filename, const char* header_filename, const float* values);
+static size_t count_mismatching_values(const BrickedField* bricked_field, const float* values, float tolerance);
+
+
+int main(void)
+{
+    char directory_name[] = "/tmp/vortek_test_XXXXXX";
+
+    if (!mkdtemp(directory_name))
+    {
+        fprintf(stderr, "Could not create temporary directory.\n");
+        return EXIT_FAILURE;
+    }
+
+    DynamicString data_filename = create_string("%s/field.raw", directory_name);
+    DynamicString header_filename = create_string("%s/field.dat", directory_name);
+    DynamicString compressed_data_filename = create_string("%s/compressed_field.raw", directory_name);
+
+    float* const values = create_field_values();
+
+    int passed = write_bifrost_files(data_filename.chars, header_filename.chars, values) &&
+                 compress_bifrost_file(data_filename.chars, header_filename.chars, compressed_data_filename.chars);
+
+    if (!passed)
+        fprintf(stderr, "Could not write test files.\n");
+
+    if (passed)
+    {
+        initialize_fields();
+        initialize_bricks();
+
+        set_field_data_release(1);
+        set_brick_size_exponent(FIRST_BRICK_SIZE_EXPONENT);
+
+        Field* const field = get_field(create_field_from_bifrost_file("compressed_field", compressed_data_filename.chars,
+                                                                      header_filename.chars));
+
+        const float tolerance = RELATIVE_TOLERANCE*(field->max_value - field->min_value);
+
+        const BrickingConfiguration bricking_configuration = get_bricking_configuration();
+
+        BrickedField bricked_field;
+        reset_bricked_field(&bricked_field);
+        build_bricked_field(&bricked_field, field, &bricking_configuration);
+
+        if (!field->source_is_compressed || field->data || field_values_can_be_read(field))
+        {
+            fprintf(stderr, "The released field should only be readable from its bricks.\n");
+            passed = 0;
+        }
+
+        if (count_mismatching_values(&bricked_field, values, tolerance) > 0)
+        {
+            fprintf(stderr, "The bricks of the compressed field do not hold the original values.\n");
+            passed = 0;
+        }
+
+        // A different brick size requires all the values to be redistributed between the bricks
+        set_brick_size_exponent(SECOND_BRICK_SIZE_EXPONENT);
+
+        BrickedField rebricked_field;
+        reset_bricked_field(&rebricked_field);
+        rebuild_bricked_field(&rebricked_field, &bricked_field);
+
+        const size_t n_mismatching_values = count_mismatching_values(&rebricked_field, values, tolerance);
+
+        if (n_mismatching_values > 0)
+        {
+            fprintf(stderr, "%zu values differ from the original values after bricking the released field again.\n", n_mismatching_values);
+            passed = 0;
+        }
+
+        destroy_bricked_field(&rebricked_field);
+        destroy_bricked_field(&bricked_field);
+        cleanup_fields();
+    }
+
+    unlink(compressed_data_filename.chars);
+    unlink(header_filename.chars);
+    unlink(data_filename.chars);
+    rmdir(directory_name);
+
+    clear_string(&compressed_data_filename);
+    clear_string(&header_filename);
+    clear_string(&data_filename);
+    free(values);
+
+    printf("compressed_field_release: %s\n", passed ? "passed" : "FAILED");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static float* create_field_values(void)
+{
+    // A smooth field with some variation along every axis, stored with x varying fastest
+    float* const values = (float*)malloc(sizeof(float)*FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z);
+
+    if (!values)
+    {
+        fprintf(stderr, "Could not allocate memory for field values.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t i, j, k;
+
+    for (k = 0; k < FIELD_SIZE_Z; k++)
+        for (j = 0; j < FIELD_SIZE_Y; j++)
+            for (i = 0; i < FIELD_SIZE_X; i++)
+                values[(k*FIELD_SIZE_Y + j)*FIELD_SIZE_X + i] = sinf(0.3f*(float)i)*cosf(0.2f*(float)j) + 0.05f*(float)k;
+
+    return values;
+}
+
+static int write_bifrost_files(const char* data_filename, const char* header_filename, const float* values)
+{
+    DynamicString header = create_string("element_kind: f\n"
+                                         "element_size: %zu\n"
+                                         "endianness: l\n"
+                                         "dimensions: 3\n"
+                                         "order: C\n"
+                                         "x_size: %d\n"
+                                         "y_size: %d\n"
+                                         "z_size: %d\n"
+                                         "dx: 1.0\n"
+                                         "dy: 1.0\n"
+                                         "dz: 1.0\n",
+                                         sizeof(float), FIELD_SIZE_X, FIELD_SIZE_Y, FIELD_SIZE_Z);
+
+    const int succeeded = write_binary_file(header_filename, NULL, 0, header.chars, strlen(header.chars)) &&
+                          write_binary_file(data_filename, NULL, 0, values, sizeof(float)*FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z);
+
+    clear_string(&header);
+
+    return succeeded;
+}
+
+static size_t count_mismatching_values(const BrickedField* bricked_field, const float* values, float tolerance)
+{
+    float* const bricked_values = read_bricked_field_slab(bricked_field, 0, FIELD_SIZE_Z);
+
+    size_t idx;
+    size_t n_mismatching_values = 0;
+
+    for (idx = 0; idx < FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z; idx++)
+        n_mismatching_values += fabsf(bricked_values[idx] - values[idx]) > tolerance;
+
+    free(bricked_values);
+
+    return n_mismatching_values;
+}
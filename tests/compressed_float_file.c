@@ -0,0 +1,347 @@
+/*
+ * Checks that compressed float files reproduce every bit of the written values,
+ * including NaN payloads, infinities, denormals and signed zeros, also when the
+ * last block is only partially filled. Also checks that files whose block
+ * offset table has been corrupted are rejected instead of being read.
+ */
+
+#include "io.h"
+#include "dynamic_string.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+
+// Spans two full compression blocks and a partial last block with the current block length of 256*1024 values
+#define MULTI_BLOCK_LENGTH (2*256*1024 + 12345)
+#define SPECIAL_VALUES_LENGTH 1000
+
+// Layout of the compressed file header that precedes the block offsets
+#define BLOCK_LENGTH_POSITION 24
+#define BLOCK_COUNT_POSITION 32
+#define BLOCK_OFFSETS_POSITION 40
+
+
+static float* create_random_values(size_t length);
+static float* create_smooth_values(size_t length);
+static float* create_special_values(size_t length);
+static int check_round_trip(const char* filename, const char* description, const float* values, size_t length);
+static int check_partial_last_block(const char* filename, size_t length);
+static int check_corrupted_block_offsets(const char* filename, const char* corrupted_filename, size_t length);
+static int write_corrupted_copy(const char* corrupted_filename, const unsigned char* content, size_t content_size,
+                                size_t position, uint64_t value);
+static unsigned char* read_whole_file(const char* filename, size_t* size);
+static uint64_t read_uint64(const unsigned char* content, size_t position);
+
+
+int main(void)
+{
+    char directory_name[] = "/tmp/vortek_test_XXXXXX";
+
+    if (!mkdtemp(directory_name))
+    {
+        fprintf(stderr, "Could not create temporary directory.\n");
+        return EXIT_FAILURE;
+    }
+
+    DynamicString filename = create_string("%s/values.raw", directory_name);
+    DynamicString corrupted_filename = create_string("%s/corrupted_values.raw", directory_name);
+
+    float* const random_values = create_random_values(MULTI_BLOCK_LENGTH);
+    float* const smooth_values = create_smooth_values(MULTI_BLOCK_LENGTH);
+    float* const special_values = create_special_values(SPECIAL_VALUES_LENGTH);
+
+    int passed = 1;
+
+    passed = check_round_trip(filename.chars, "random", random_values, MULTI_BLOCK_LENGTH) && passed;
+    passed = check_round_trip(filename.chars, "special", special_values, SPECIAL_VALUES_LENGTH) && passed;
+    passed = check_round_trip(filename.chars, "smooth", smooth_values, MULTI_BLOCK_LENGTH) && passed;
+
+    // The last written file holds the smooth values
+    passed = check_partial_last_block(filename.chars, MULTI_BLOCK_LENGTH) && passed;
+    passed = check_corrupted_block_offsets(filename.chars, corrupted_filename.chars, MULTI_BLOCK_LENGTH) && passed;
+
+    unlink(corrupted_filename.chars);
+    unlink(filename.chars);
+    rmdir(directory_name);
+
+    clear_string(&corrupted_filename);
+    clear_string(&filename);
+    free(special_values);
+    free(smooth_values);
+    free(random_values);
+
+    printf("compressed_float_file: %s\n", passed ? "passed" : "FAILED");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static float* create_random_values(size_t length)
+{
+    // Arbitrary bit patterns, which include NaNs with all kinds of payloads and are hard to predict
+    float* const values = (float*)malloc(sizeof(float)*length);
+
+    if (!values)
+    {
+        fprintf(stderr, "Could not allocate memory for values.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t state = 2463534242u;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        memcpy(values + i, &state, sizeof(float));
+    }
+
+    return values;
+}
+
+static float* create_smooth_values(size_t length)
+{
+    // Slowly varying values, which the predictors of the compressor are designed for
+    float* const values = (float*)malloc(sizeof(float)*length);
+
+    if (!values)
+    {
+        fprintf(stderr, "Could not allocate memory for values.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t i;
+
+    for (i = 0; i < length; i++)
+        values[i] = 100.0f*sinf(0.001f*(float)i) + 0.01f*cosf(0.37f*(float)i);
+
+    return values;
+}
+
+static float* create_special_values(size_t length)
+{
+    // Special bit patterns interleaved with ordinary values
+    static const uint32_t special_bits[] = {0x7fc00000u,  // Quiet NaN
+                                            0xffc00000u,  // Negative quiet NaN
+                                            0x7f800001u,  // Signalling NaN
+                                            0x7fbfffffu,  // Signalling NaN with the largest payload
+                                            0x7f800000u,  // Positive infinity
+                                            0xff800000u,  // Negative infinity
+                                            0x00000001u,  // Smallest positive denormal
+                                            0x007fffffu,  // Largest positive denormal
+                                            0x80000001u,  // Smallest negative denormal
+                                            0x807fffffu,  // Largest negative denormal
+                                            0x80000000u,  // Negative zero
+                                            0x00000000u,  // Positive zero
+                                            0x00800000u,  // Smallest positive normal
+                                            0x7f7fffffu}; // Largest finite value
+
+    const size_t n_special_values = sizeof(special_bits)/sizeof(special_bits[0]);
+
+    float* const values = (float*)malloc(sizeof(float)*length);
+
+    if (!values)
+    {
+        fprintf(stderr, "Could not allocate memory for values.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        if (i % 3 == 2)
+            values[i] = 0.5f*(float)i;
+        else
+            memcpy(values + i, special_bits + (i*7 % n_special_values), sizeof(float));
+    }
+
+    return values;
+}
+
+static int check_round_trip(const char* filename, const char* description, const float* values, size_t length)
+{
+    if (!write_compressed_float_binary_file(filename, values, length))
+    {
+        fprintf(stderr, "Could not write compressed %s values.\n", description);
+        return 0;
+    }
+
+    if (!is_compressed_float_binary_file(filename))
+    {
+        fprintf(stderr, "The file with %s values is not recognized as compressed.\n", description);
+        return 0;
+    }
+
+    float* const read_values = read_compressed_float_binary_file(filename, length);
+
+    if (!read_values)
+    {
+        fprintf(stderr, "Could not read compressed %s values.\n", description);
+        return 0;
+    }
+
+    size_t i;
+    size_t n_mismatching_values = 0;
+
+    // Values are compared bit by bit, since NaNs never compare equal and zeros compare equal regardless of sign
+    for (i = 0; i < length; i++)
+        n_mismatching_values += memcmp(read_values + i, values + i, sizeof(float)) != 0;
+
+    free(read_values);
+
+    if (n_mismatching_values > 0)
+    {
+        fprintf(stderr, "%zu of %zu %s values differ after compression.\n", n_mismatching_values, length, description);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int check_partial_last_block(const char* filename, size_t length)
+{
+    size_t size;
+    unsigned char* const content = read_whole_file(filename, &size);
+
+    if (!content)
+        return 0;
+
+    const uint64_t block_length = (size >= BLOCK_OFFSETS_POSITION) ? read_uint64(content, BLOCK_LENGTH_POSITION) : 0;
+    const uint64_t n_blocks = (size >= BLOCK_OFFSETS_POSITION) ? read_uint64(content, BLOCK_COUNT_POSITION) : 0;
+
+    free(content);
+
+    if (block_length == 0 || length % block_length == 0 || n_blocks < 2)
+    {
+        fprintf(stderr, "The test values should span several blocks with a partial last block.\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+static int check_corrupted_block_offsets(const char* filename, const char* corrupted_filename, size_t length)
+{
+    size_t size;
+    unsigned char* const content = read_whole_file(filename, &size);
+
+    if (!content)
+        return 0;
+
+    const size_t n_blocks = (size_t)read_uint64(content, BLOCK_COUNT_POSITION);
+    const uint64_t first_offset = read_uint64(content, BLOCK_OFFSETS_POSITION);
+    const uint64_t second_offset = read_uint64(content, BLOCK_OFFSETS_POSITION + sizeof(uint64_t));
+
+    // Position of the offset to corrupt, and the corrupted offset
+    const size_t positions[] = {BLOCK_OFFSETS_POSITION,
+                                BLOCK_OFFSETS_POSITION,
+                                BLOCK_OFFSETS_POSITION + sizeof(uint64_t),
+                                BLOCK_OFFSETS_POSITION + sizeof(uint64_t),
+                                BLOCK_OFFSETS_POSITION + sizeof(uint64_t)*n_blocks};
+    const uint64_t corrupted_offsets[] = {first_offset + 4,           // First block does not start after the offsets
+                                          first_offset - 8,           // First block starts within the offsets
+                                          first_offset - 1,           // Block ends before it starts
+                                          second_offset + (1 << 30),  // Block is larger than any compressed block can be
+                                          (uint64_t)size + 64};       // Last block ends beyond the end of the file
+    const char* const descriptions[] = {"a shifted first block",
+                                        "a first block overlapping the offsets",
+                                        "a block ending before it starts",
+                                        "an oversized block",
+                                        "a block ending beyond the file"};
+
+    const size_t n_corruptions = sizeof(positions)/sizeof(positions[0]);
+
+    size_t corruption_idx;
+    int passed = 1;
+
+    for (corruption_idx = 0; corruption_idx < n_corruptions; corruption_idx++)
+    {
+        if (!write_corrupted_copy(corrupted_filename, content, size, positions[corruption_idx], corrupted_offsets[corruption_idx]))
+        {
+            passed = 0;
+            continue;
+        }
+
+        float* const read_values = read_compressed_float_binary_file(corrupted_filename, length);
+
+        if (read_values)
+        {
+            fprintf(stderr, "A compressed file with %s was read.\n", descriptions[corruption_idx]);
+            free(read_values);
+            passed = 0;
+        }
+    }
+
+    free(content);
+
+    return passed;
+}
+
+static int write_corrupted_copy(const char* corrupted_filename, const unsigned char* content, size_t content_size,
+                                size_t position, uint64_t value)
+{
+    unsigned char* const corrupted_content = (unsigned char*)malloc(content_size);
+
+    if (!corrupted_content)
+    {
+        fprintf(stderr, "Could not allocate memory for file content.\n");
+        return 0;
+    }
+
+    memcpy(corrupted_content, content, content_size);
+    memcpy(corrupted_content + position, &value, sizeof(uint64_t));
+
+    const int succeeded = write_binary_file(corrupted_filename, NULL, 0, corrupted_content, content_size);
+
+    free(corrupted_content);
+
+    if (!succeeded)
+        fprintf(stderr, "Could not write corrupted file.\n");
+
+    return succeeded;
+}
+
+static unsigned char* read_whole_file(const char* filename, size_t* size)
+{
+    FILE* const file = fopen(filename, "rb");
+
+    if (!file)
+    {
+        fprintf(stderr, "Could not open %s.\n", filename);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char* const content = (file_size > 0) ? (unsigned char*)malloc((size_t)file_size) : NULL;
+
+    if (!content || fread(content, 1, (size_t)file_size, file) != (size_t)file_size)
+    {
+        fprintf(stderr, "Could not read %s.\n", filename);
+        free(content);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+
+    *size = (size_t)file_size;
+
+    return content;
+}
+
+static uint64_t read_uint64(const unsigned char* content, size_t position)
+{
+    uint64_t value;
+    memcpy(&value, content + position, sizeof(uint64_t));
+    return value;
+}
@@ -0,0 +1,261 @@
+/*
+ * Checks the conversions between single and half precision values used for
+ * half precision brick data. Every half value must survive a round trip, values
+ * on and next to every rounding boundary must round to nearest with ties to
+ * even, and when the F16C instructions are available, the scalar conversions
+ * must agree with them, since bricks are converted with the instructions where
+ * possible and with the scalar code for the remaining values.
+ */
+
+#include "extra_math.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+
+#define HALF_SIGN_BIT 0x8000u
+#define HALF_QUIET_BIT 0x0200u
+#define HALF_POSITIVE_INFINITY 0x7C00u
+// Value that the largest finite half value would be followed by if the exponent range were unbounded
+#define HALF_OVERFLOW_VALUE 65536.0f
+// Number of single precision mantissa bits below the last mantissa bit of a normal half value
+#define DISCARDED_MANTISSA_BITS 13
+
+
+static int check_round_trips(void);
+static int check_rounding_boundaries(void);
+static int check_rounding(float value, uint16_t expected_half);
+static int half_is_nan(uint16_t half);
+static int float_is_nan(float value);
+static uint32_t get_float_bits(float value);
+static float create_float(uint32_t bits);
+#if defined(__F16C__)
+static int check_against_f16c(void);
+#endif
+
+
+int main(void)
+{
+    int passed = 1;
+
+    passed = check_round_trips() && passed;
+    passed = check_rounding_boundaries() && passed;
+#if defined(__F16C__)
+    passed = check_against_f16c() && passed;
+#else
+    printf("half_conversion: F16C instructions not available, skipping comparison\n");
+#endif
+
+    printf("half_conversion: %s\n", passed ? "passed" : "FAILED");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int check_round_trips(void)
+{
+    // Every half value must convert back to itself, except that signalling NaNs become quiet
+    uint32_t half;
+    size_t n_failures = 0;
+
+    for (half = 0; half <= UINT16_MAX; half++)
+    {
+        const float value = half_to_float((uint16_t)half);
+        const uint16_t expected_half = (uint16_t)(half_is_nan((uint16_t)half) ? (half | HALF_QUIET_BIT) : half);
+        const uint16_t converted_half = float_to_half(value);
+
+        if (converted_half != expected_half)
+        {
+            if (n_failures < 10)
+                fprintf(stderr, "Half 0x%04x converted to %.9g and back to 0x%04x.\n", (unsigned int)half, value, (unsigned int)converted_half);
+
+            n_failures++;
+        }
+
+        // NaNs are also NaNs in single precision, and other values must be exact
+        if (half_is_nan((uint16_t)half) != float_is_nan(value))
+        {
+            fprintf(stderr, "Half 0x%04x converted to %.9g, which differs in being NaN.\n", (unsigned int)half, value);
+            n_failures++;
+        }
+    }
+
+    if (n_failures > 0)
+        fprintf(stderr, "%zu half values did not survive a round trip.\n", n_failures);
+
+    return n_failures == 0;
+}
+
+static int check_rounding_boundaries(void)
+{
+    /*
+    The midpoint between two adjacent half values is exactly representable in
+    single precision, so it and its neighbouring single precision values test
+    rounding to nearest with ties to even. The pairs include the smallest
+    subnormal and zero, where values underflow, and the largest finite value
+    and infinity, where values overflow.
+    */
+
+    uint32_t half;
+    int passed = 1;
+
+    for (half = 0; half < HALF_POSITIVE_INFINITY; half++)
+    {
+        const uint16_t lower_half = (uint16_t)half;
+        const uint16_t upper_half = (uint16_t)(half + 1);
+
+        const float lower_value = half_to_float(lower_half);
+        const float upper_value = (upper_half == HALF_POSITIVE_INFINITY) ? HALF_OVERFLOW_VALUE : half_to_float(upper_half);
+        const float midpoint = 0.5f*(lower_value + upper_value);
+
+        const uint16_t even_half = (lower_half & 1u) ? upper_half : lower_half;
+
+        const float below_midpoint = nextafterf(midpoint, 0.0f);
+        const float above_midpoint = nextafterf(midpoint, INFINITY);
+
+        passed = check_rounding(midpoint, even_half) && passed;
+        passed = check_rounding(below_midpoint, lower_half) && passed;
+        passed = check_rounding(above_midpoint, upper_half) && passed;
+
+        // Negative values round the same way as their magnitudes
+        passed = check_rounding(-midpoint, (uint16_t)(even_half | HALF_SIGN_BIT)) && passed;
+        passed = check_rounding(-below_midpoint, (uint16_t)(lower_half | HALF_SIGN_BIT)) && passed;
+        passed = check_rounding(-above_midpoint, (uint16_t)(upper_half | HALF_SIGN_BIT)) && passed;
+    }
+
+    passed = check_rounding(INFINITY, HALF_POSITIVE_INFINITY) && passed;
+    passed = check_rounding(-INFINITY, (uint16_t)(HALF_POSITIVE_INFINITY | HALF_SIGN_BIT)) && passed;
+    passed = check_rounding(create_float(0x7F7FFFFFu), HALF_POSITIVE_INFINITY) && passed;
+    passed = check_rounding(create_float(0x00000001u), 0) && passed;
+    passed = check_rounding(create_float(0x80000001u), HALF_SIGN_BIT) && passed;
+
+    if (!passed)
+        fprintf(stderr, "Single precision values on or next to rounding boundaries were rounded incorrectly.\n");
+
+    return passed;
+}
+
+static int check_rounding(float value, uint16_t expected_half)
+{
+    const uint16_t half = float_to_half(value);
+
+    if (half != expected_half)
+    {
+        fprintf(stderr, "%.9g (0x%08x) converted to half 0x%04x instead of 0x%04x.\n",
+                value, (unsigned int)get_float_bits(value), (unsigned int)half, (unsigned int)expected_half);
+        return 0;
+    }
+
+#if defined(__F16C__)
+    const uint16_t half_from_instruction = (uint16_t)_cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+
+    if (half_from_instruction != expected_half)
+    {
+        fprintf(stderr, "%.9g (0x%08x) converted to half 0x%04x with F16C instead of 0x%04x.\n",
+                value, (unsigned int)get_float_bits(value), (unsigned int)half_from_instruction, (unsigned int)expected_half);
+        return 0;
+    }
+#endif
+
+    return 1;
+}
+
+#if defined(__F16C__)
+static int check_against_f16c(void)
+{
+    /*
+    Every combination of sign, exponent and the mantissa bits kept in a
+    normal half value is combined with the discarded bits that lie on and
+    next to the rounding boundaries of normal values. The boundaries of
+    subnormal values are covered by check_rounding_boundaries.
+    */
+
+    static const uint32_t discarded_bits[] = {0x0000u, 0x0001u, 0x0FFFu, 0x1000u, 0x1001u, 0x1FFFu};
+
+    const size_t n_discarded_bits = sizeof(discarded_bits)/sizeof(discarded_bits[0]);
+
+    uint32_t kept_bits;
+    size_t discarded_bits_idx;
+    uint32_t half;
+    size_t n_failures = 0;
+
+    for (kept_bits = 0; kept_bits < (1u << (32 - DISCARDED_MANTISSA_BITS)); kept_bits++)
+    {
+        for (discarded_bits_idx = 0; discarded_bits_idx < n_discarded_bits; discarded_bits_idx++)
+        {
+            const uint32_t bits = (kept_bits << DISCARDED_MANTISSA_BITS) | discarded_bits[discarded_bits_idx];
+            const float value = create_float(bits);
+            const uint16_t half_from_instruction = (uint16_t)_cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT);
+            const uint16_t half_from_scalar_code = float_to_half(value);
+
+            // NaN payloads are allowed to differ as long as the sign is kept
+            if (half_from_scalar_code != half_from_instruction &&
+                !(half_is_nan(half_from_scalar_code) && half_is_nan(half_from_instruction) &&
+                  (half_from_scalar_code & HALF_SIGN_BIT) == (half_from_instruction & HALF_SIGN_BIT)))
+            {
+                if (n_failures < 10)
+                    fprintf(stderr, "%.9g (0x%08x) converted to half 0x%04x, but F16C gives 0x%04x.\n",
+                            value, (unsigned int)bits, (unsigned int)half_from_scalar_code, (unsigned int)half_from_instruction);
+
+                n_failures++;
+            }
+        }
+    }
+
+    for (half = 0; half <= UINT16_MAX; half++)
+    {
+        const float value_from_instruction = _cvtsh_ss((unsigned short)half);
+        const float value_from_scalar_code = half_to_float((uint16_t)half);
+
+        const int values_differ = half_is_nan((uint16_t)half) ?
+                                  !float_is_nan(value_from_scalar_code) || !float_is_nan(value_from_instruction) ||
+                                  (get_float_bits(value_from_scalar_code) >> 31) != (get_float_bits(value_from_instruction) >> 31) :
+                                  get_float_bits(value_from_scalar_code) != get_float_bits(value_from_instruction);
+
+        if (values_differ)
+        {
+            if (n_failures < 10)
+                fprintf(stderr, "Half 0x%04x converted to %.9g, but F16C gives %.9g.\n",
+                        (unsigned int)half, value_from_scalar_code, value_from_instruction);
+
+            n_failures++;
+        }
+    }
+
+    if (n_failures > 0)
+        fprintf(stderr, "%zu conversions disagree with the F16C instructions.\n", n_failures);
+
+    return n_failures == 0;
+}
+#endif
+
+static int half_is_nan(uint16_t half)
+{
+    return (half & 0x7C00u) == 0x7C00u && (half & 0x03FFu) != 0;
+}
+
+static int float_is_nan(float value)
+{
+    // Checked on the bits, since NaN checks may be optimized away when fast math is enabled
+    return (get_float_bits(value) & 0x7FFFFFFFu) > 0x7F800000u;
+}
+
+static uint32_t get_float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    return bits;
+}
+
+static float create_float(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
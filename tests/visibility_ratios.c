@@ -0,0 +1,326 @@
+/*
+ * Checks the visibility ratios that sub brick tree leaves get from their value
+ * histograms against a voxel by voxel scan of the leaves. The ratio of a leaf
+ * may overestimate the fraction of visible voxels, since a partly visible
+ * histogram bin counts as visible, but never underestimate it. In particular,
+ * a leaf with a visible voxel must never get a ratio of zero, which would make
+ * it culled. The transfer functions include step edges that fall inside a
+ * histogram bin and value limits other than [0, 1].
+ */
+
+#include "fields.h"
+#include "bricks.h"
+#include "transfer_functions.h"
+#include "io.h"
+#include "dynamic_string.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+
+#define FIELD_SIZE_X 40
+#define FIELD_SIZE_Y 36
+#define FIELD_SIZE_Z 30
+#define BRICK_SIZE_EXPONENT 4
+// The padded region of the first brick, which is made constant so that a constant brick is checked too
+#define CONSTANT_REGION_SIZE 16
+#define CONSTANT_VALUE 0.3f
+
+#define TF_SIZE 256
+#define INVISIBLE_OPACITY 1e-6f
+// Number of sampled values per histogram bin when finding which bins contain a visible value
+#define SAMPLES_PER_BIN 64
+
+
+typedef struct TransferFunctionCase
+{
+    const char* description;
+    float lower_limit;
+    float upper_limit;
+    unsigned int first_visible_node; // Interior nodes in this range get the opacity below
+    unsigned int last_visible_node;
+    float opacity;
+    float lower_opacity; // Opacity below the lower limit
+    float upper_opacity; // Opacity above the upper limit
+} TransferFunctionCase;
+
+
+static float* create_field_values(void);
+static int write_bifrost_files(const char* data_filename, const char* header_filename, const float* values);
+static void create_opacities(const TransferFunctionCase* tf_case, float* opacities);
+static int value_is_visible(const TransferFunctionCase* tf_case, const float* opacities, float value);
+static void find_bins_with_visible_values(const TransferFunctionCase* tf_case, const float* opacities, int* bin_is_visible);
+static int check_leaf_visibility_ratios(BrickedField* bricked_field, const TransferFunctionCase* tf_case);
+
+
+int main(void)
+{
+    static const TransferFunctionCase tf_cases[] = {
+        {"a band of visible values",               0.0f,    1.0f,    60,  90,  0.5f, 0.0f, 0.0f},
+        {"a single visible node",                  0.0f,    1.0f,    128, 128, 1.0f, 0.0f, 0.0f},
+        {"a band within narrowed limits",          0.25f,   0.55f,   40,  200, 0.8f, 0.0f, 0.0f},
+        {"a step up inside a bin",                 0.3011f, 0.6987f, 100, 254, 1.0f, 0.0f, 1.0f},
+        {"values below a limit inside a bin",      0.5012f, 0.9f,    1,   0,   0.0f, 1.0f, 0.0f},
+        {"values above a limit inside a bin",      0.1f,    0.4987f, 1,   0,   0.0f, 0.0f, 0.7f},
+        {"only values outside narrowed limits",    0.4f,    0.6f,    1,   0,   0.0f, 0.6f, 0.6f},
+        {"no visible values",                      0.0f,    1.0f,    1,   0,   0.0f, 0.0f, 0.0f},
+        {"all values visible",                     0.0f,    1.0f,    1,   254, 1.0f, 1.0f, 1.0f}};
+
+    static const enum brick_data_type data_types[] = {BRICK_DATA_FLOAT32, BRICK_DATA_UINT8};
+
+    const size_t n_tf_cases = sizeof(tf_cases)/sizeof(tf_cases[0]);
+    const size_t n_data_types = sizeof(data_types)/sizeof(data_types[0]);
+
+    char directory_name[] = "/tmp/vortek_test_XXXXXX";
+
+    if (!mkdtemp(directory_name))
+    {
+        fprintf(stderr, "Could not create temporary directory.\n");
+        return EXIT_FAILURE;
+    }
+
+    DynamicString data_filename = create_string("%s/field.raw", directory_name);
+    DynamicString header_filename = create_string("%s/field.dat", directory_name);
+
+    float* const values = create_field_values();
+
+    int passed = write_bifrost_files(data_filename.chars, header_filename.chars, values);
+
+    if (!passed)
+        fprintf(stderr, "Could not write test files.\n");
+
+    if (passed)
+    {
+        initialize_fields();
+        initialize_bricks();
+        set_brick_size_exponent(BRICK_SIZE_EXPONENT);
+
+        Field* const field = get_field(create_field_from_bifrost_file("field", data_filename.chars, header_filename.chars));
+
+        size_t data_type_idx, tf_case_idx;
+
+        for (data_type_idx = 0; data_type_idx < n_data_types; data_type_idx++)
+        {
+            set_brick_data_type(data_types[data_type_idx]);
+
+            const BrickingConfiguration bricking_configuration = get_bricking_configuration();
+
+            BrickedField bricked_field;
+            reset_bricked_field(&bricked_field);
+            build_bricked_field(&bricked_field, field, &bricking_configuration);
+
+            if (!bricked_field.bricks[0].is_constant)
+            {
+                fprintf(stderr, "The first brick should be constant.\n");
+                passed = 0;
+            }
+
+            for (tf_case_idx = 0; tf_case_idx < n_tf_cases; tf_case_idx++)
+            {
+                if (!check_leaf_visibility_ratios(&bricked_field, tf_cases + tf_case_idx))
+                {
+                    fprintf(stderr, "Wrong visibility ratios for %s with brick data type %d.\n",
+                            tf_cases[tf_case_idx].description, (int)data_types[data_type_idx]);
+                    passed = 0;
+                }
+            }
+
+            destroy_bricked_field(&bricked_field);
+        }
+
+        cleanup_fields();
+    }
+
+    unlink(header_filename.chars);
+    unlink(data_filename.chars);
+    rmdir(directory_name);
+
+    clear_string(&header_filename);
+    clear_string(&data_filename);
+    free(values);
+
+    printf("visibility_ratios: %s\n", passed ? "passed" : "FAILED");
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static float* create_field_values(void)
+{
+    // Smooth values in [0, 1] that vary along every axis, with a constant corner region
+    float* const values = (float*)malloc(sizeof(float)*FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z);
+
+    if (!values)
+    {
+        fprintf(stderr, "Could not allocate memory for field values.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t i, j, k;
+
+    for (k = 0; k < FIELD_SIZE_Z; k++)
+        for (j = 0; j < FIELD_SIZE_Y; j++)
+            for (i = 0; i < FIELD_SIZE_X; i++)
+            {
+                values[(k*FIELD_SIZE_Y + j)*FIELD_SIZE_X + i] =
+                    (i < CONSTANT_REGION_SIZE && j < CONSTANT_REGION_SIZE && k < CONSTANT_REGION_SIZE) ?
+                    CONSTANT_VALUE :
+                    0.5f + 0.25f*sinf(0.37f*(float)i)*cosf(0.23f*(float)j) + 0.25f*sinf(0.41f*(float)k + 0.1f*(float)i);
+            }
+
+    // The extreme values make the normalization leave the values unchanged
+    values[FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z - 2] = 0.0f;
+    values[FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z - 1] = 1.0f;
+
+    return values;
+}
+
+static int write_bifrost_files(const char* data_filename, const char* header_filename, const float* values)
+{
+    DynamicString header = create_string("element_kind: f\n"
+                                         "element_size: %zu\n"
+                                         "endianness: l\n"
+                                         "dimensions: 3\n"
+                                         "order: C\n"
+                                         "x_size: %d\n"
+                                         "y_size: %d\n"
+                                         "z_size: %d\n"
+                                         "dx: 1.0\n"
+                                         "dy: 1.0\n"
+                                         "dz: 1.0\n",
+                                         sizeof(float), FIELD_SIZE_X, FIELD_SIZE_Y, FIELD_SIZE_Z);
+
+    const int succeeded = write_binary_file(header_filename, NULL, 0, header.chars, strlen(header.chars)) &&
+                          write_binary_file(data_filename, NULL, 0, values, sizeof(float)*FIELD_SIZE_X*FIELD_SIZE_Y*FIELD_SIZE_Z);
+
+    clear_string(&header);
+
+    return succeeded;
+}
+
+static void create_opacities(const TransferFunctionCase* tf_case, float* opacities)
+{
+    unsigned int node;
+
+    for (node = TF_START_NODE; node <= TF_END_NODE; node++)
+        opacities[node] = (node >= tf_case->first_visible_node && node <= tf_case->last_visible_node) ? tf_case->opacity : 0.0f;
+
+    opacities[0] = tf_case->lower_opacity;
+    opacities[TF_SIZE - 1] = tf_case->upper_opacity;
+}
+
+static int value_is_visible(const TransferFunctionCase* tf_case, const float* opacities, float value)
+{
+    // The opacity varies linearly between the interior nodes, which are evenly spread between the limits
+    if (value <= tf_case->lower_limit)
+        return opacities[0] > INVISIBLE_OPACITY;
+
+    if (value >= tf_case->upper_limit)
+        return opacities[TF_SIZE - 1] > INVISIBLE_OPACITY;
+
+    const double node_position = TF_START_NODE + (double)(TF_END_NODE - TF_START_NODE)*(value - tf_case->lower_limit)/
+                                                 (tf_case->upper_limit - tf_case->lower_limit);
+
+    const unsigned int node_below = (unsigned int)node_position;
+    const double above_weight = node_position - node_below;
+
+    return (1.0 - above_weight)*opacities[node_below] + above_weight*opacities[node_below + 1] > INVISIBLE_OPACITY;
+}
+
+static void find_bins_with_visible_values(const TransferFunctionCase* tf_case, const float* opacities, int* bin_is_visible)
+{
+    // The opacity can only peak at a node, so sampling the bins densely and at every node finds all visible values
+    unsigned int bin, sample, node;
+
+    for (bin = 0; bin < VALUE_HISTOGRAM_BINS; bin++)
+    {
+        const float bin_start = (float)bin/(float)VALUE_HISTOGRAM_BINS;
+        const float bin_end = (float)(bin + 1)/(float)VALUE_HISTOGRAM_BINS;
+
+        bin_is_visible[bin] = 0;
+
+        for (sample = 0; sample <= SAMPLES_PER_BIN; sample++)
+            bin_is_visible[bin] = bin_is_visible[bin] ||
+                                  value_is_visible(tf_case, opacities, bin_start + (bin_end - bin_start)*(float)sample/(float)SAMPLES_PER_BIN);
+
+        for (node = TF_START_NODE; node <= TF_END_NODE; node++)
+        {
+            const float node_value = tf_case->lower_limit + (tf_case->upper_limit - tf_case->lower_limit)*
+                                                            (float)(node - TF_START_NODE)/(float)(TF_END_NODE - TF_START_NODE);
+
+            if (node_value >= bin_start && node_value <= bin_end)
+                bin_is_visible[bin] = bin_is_visible[bin] || opacities[node] > INVISIBLE_OPACITY;
+        }
+    }
+}
+
+static int check_leaf_visibility_ratios(BrickedField* bricked_field, const TransferFunctionCase* tf_case)
+{
+    float opacities[TF_SIZE];
+    int bin_is_visible[VALUE_HISTOGRAM_BINS];
+
+    create_opacities(tf_case, opacities);
+    find_bins_with_visible_values(tf_case, opacities, bin_is_visible);
+
+    update_visibility_ratios_from_opacities(opacities, tf_case->lower_limit, tf_case->upper_limit, bricked_field);
+
+    const size_t pad_size = bricked_field->pad_size;
+
+    size_t brick_idx, node_idx;
+    size_t i, j, k;
+    size_t strides[3];
+    size_t n_underestimates = 0;
+    size_t n_overestimates = 0;
+    size_t n_culled_visible_leaves = 0;
+
+    for (brick_idx = 0; brick_idx < bricked_field->n_bricks; brick_idx++)
+    {
+        const Brick* const brick = bricked_field->bricks + brick_idx;
+        get_brick_data_strides(brick, strides);
+
+        for (node_idx = 0; node_idx < brick->n_tree_nodes; node_idx++)
+        {
+            const SubBrickTreeNode* const node = brick->tree + node_idx;
+
+            if (node->upper_child_idx != 0)
+                continue;
+
+            size_t n_visible_voxels = 0;
+            size_t n_voxels_in_visible_bins = 0;
+
+            for (k = 0; k < node->size[2]; k++)
+                for (j = 0; j < node->size[1]; j++)
+                    for (i = 0; i < node->size[0]; i++)
+                    {
+                        const float value = get_brick_data_value(bricked_field, brick,
+                                                                 (node->offset[0] + i + pad_size)*strides[0] +
+                                                                 (node->offset[1] + j + pad_size)*strides[1] +
+                                                                 (node->offset[2] + k + pad_size)*strides[2]);
+
+                        const float clamped_bin = fminf(fmaxf(value*(float)VALUE_HISTOGRAM_BINS, 0.0f), (float)(VALUE_HISTOGRAM_BINS - 1));
+                        const int bin = (int)clamped_bin;
+
+                        n_visible_voxels += (size_t)value_is_visible(tf_case, opacities, value);
+                        n_voxels_in_visible_bins += (size_t)bin_is_visible[bin];
+                    }
+
+            const double n_voxels = (double)node->size[0]*node->size[1]*node->size[2];
+            const double n_voxels_from_ratio = brick->visibility_ratios[node_idx]*n_voxels;
+
+            n_underestimates += n_voxels_from_ratio < (double)n_visible_voxels - 0.5;
+            n_overestimates += n_voxels_from_ratio > (double)n_voxels_in_visible_bins + 0.5;
+            n_culled_visible_leaves += n_visible_voxels > 0 && brick->visibility_ratios[node_idx] <= 0.0f;
+        }
+    }
+
+    if (n_underestimates > 0 || n_overestimates > 0 || n_culled_visible_leaves > 0)
+    {
+        fprintf(stderr, "%zu leaves have too low, %zu too high and %zu zero visibility ratios despite visible voxels.\n",
+                n_underestimates, n_overestimates, n_culled_visible_leaves);
+        return 0;
+    }
+
+    return 1;
+}